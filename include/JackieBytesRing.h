@@ -0,0 +1,185 @@
+#ifndef JACKIE_BYTES_RING_H_
+#define JACKIE_BYTES_RING_H_
+
+#include <cassert>
+#include <cstring>
+#include "geco-namesapces.h"
+#include "geco-malloc-interface.h"
+
+GECO_NET_BEGIN_NSPACE
+
+///====================================================
+/// One slab of contiguous bytes that hands out variable-length records in fifo order,
+/// so small records sit next to each other instead of one per fixed-size cell.
+/// 1. Allocate() carves the next record at the write cursor, a record never wraps,
+///     the unusable tail of the slab becomes a padding record instead
+/// 2. Release() can come in any order, it only marks the record free. The release
+///     cursor then sweeps over every free record at the front of the ring
+/// 3. Shrink() lets a record be allocated at its max size, filled, then cut down to
+///     what was written. the cut off bytes go back to write cursor if it is the latest
+///     record, otherwise they stay behind as padding until release cursor passes
+/// 4. Repack() does the same for a whole batch of the latest records, it moves their
+///     data down next to each other so none of them keeps a max size footprint
+/// 5. not thread safe, one thread (recv thread) allocates and releases
+///=======================================================
+template <unsigned int nSize = 1024 * 1024>
+class JackieBytesRing
+{
+    private:
+    struct Record
+    {
+        unsigned int size; /// header included, always a multiple of sizeof(Record)
+        unsigned int released;
+    };
+
+    char *m_pBuffer;
+    unsigned int m_nSize;
+    unsigned int m_nIn; /// write cursor
+    unsigned int m_nOut; /// release cursor, oldest record still in use
+    unsigned int m_nUsed; /// bytes between the two cursors, paddings included
+
+    static unsigned int RecordSize(unsigned int dataSize)
+    {
+        return (sizeof(Record) + dataSize + sizeof(Record) - 1) & ~(unsigned int)(sizeof(Record) - 1);
+    }
+
+    public:
+    JackieBytesRing() : m_pBuffer(0), m_nSize(RecordSize(nSize - sizeof(Record))),
+        m_nIn(0), m_nOut(0), m_nUsed(0)
+    {
+        m_pBuffer = (char*)gMallocEx(m_nSize, __FILE__, __LINE__);
+    }
+    ~JackieBytesRing()
+    {
+        if (0 != m_pBuffer) { gFreeEx(m_pBuffer, __FILE__, __LINE__); m_pBuffer = 0; }
+    }
+
+    void Clear(void) { m_nIn = m_nOut = m_nUsed = 0; }
+    unsigned int Capacity(void) const { return m_nSize; }
+    unsigned int Size(void) const { return m_nUsed; }
+    bool IsEmpty(void) const { return m_nUsed == 0; }
+    bool Owns(const char *data) const { return data >= m_pBuffer && data < m_pBuffer + m_nSize; }
+
+    /// true if @count records of up to @dataSize bytes each can be allocated
+    /// back to back right now, wrap included
+    bool HasRoomFor(unsigned int count, unsigned int dataSize) const
+    {
+        unsigned int need = count * RecordSize(dataSize);
+        if (m_nUsed == 0) return need <= m_nSize;
+        if (m_nIn > m_nOut || (m_nIn == m_nOut && m_nUsed < m_nSize))
+        {
+            /// free bytes are [m_nIn, end) and [0, m_nOut), records do not span both
+            return need <= m_nSize - m_nIn || need <= m_nOut;
+        }
+        return need <= m_nOut - m_nIn;
+    }
+
+    /// returns 0 when there is no contiguous room for @dataSize bytes
+    char* Allocate(unsigned int dataSize)
+    {
+        unsigned int size = RecordSize(dataSize);
+        if (m_nUsed == 0) m_nIn = m_nOut = 0;
+
+        if (m_nIn >= m_nOut && m_nUsed < m_nSize)
+        {
+            unsigned int tail = m_nSize - m_nIn;
+            if (size > tail)
+            {
+                /// not enough at the end, wrap if front has room
+                if (size > m_nOut) return 0;
+                Record *padding = (Record*)(m_pBuffer + m_nIn);
+                padding->size = tail;
+                padding->released = 1;
+                m_nUsed += tail;
+                m_nIn = 0;
+            }
+        }
+        if (m_nSize - m_nUsed < size) return 0;
+        if (m_nIn < m_nOut && m_nOut - m_nIn < size) return 0;
+
+        Record *record = (Record*)(m_pBuffer + m_nIn);
+        record->size = size;
+        record->released = 0;
+        m_nIn += size;
+        if (m_nIn == m_nSize) m_nIn = 0;
+        m_nUsed += size;
+        return (char*)(record + 1);
+    }
+
+    /// @dataSize 0 gives the whole record back, as if it was released at once
+    void Shrink(char *data, unsigned int dataSize)
+    {
+        assert(Owns(data));
+        Record *record = (Record*)data - 1;
+        assert(record->released == 0);
+        unsigned int size = dataSize == 0 ? 0 : RecordSize(dataSize);
+        assert(size <= record->size);
+        if (size == record->size) return;
+
+        unsigned int end = (unsigned int)((char*)record - m_pBuffer) + record->size;
+        if ((end == m_nSize ? 0 : end) == m_nIn)
+        {
+            /// latest record, just move write cursor back
+            m_nIn = end - (record->size - size);
+            m_nUsed -= record->size - size;
+            record->size = size;
+            return;
+        }
+        if (size == 0)
+        {
+            Release(data);
+            return;
+        }
+        Record *rest = (Record*)((char*)record + size);
+        rest->size = record->size - size;
+        rest->released = 1;
+        record->size = size;
+    }
+
+    /// @datas are the latest @count records, allocated one after another at max size.
+    /// each is cut down to @dataSizes and moved right behind the one before it, @datas
+    /// point to where the data went afterwards, 0 for a size of 0
+    void Repack(char **datas, const unsigned int *dataSizes, int count)
+    {
+        assert(count > 0 && Owns(datas[0]));
+        /// give the whole batch back, paddings included, and allocate it again packed.
+        /// every record lands at or below where it was, so moving them in order never
+        /// writes over one still to move. older records keep the ring from resetting
+        /// to the start of slab, unless there were none and the batch started there
+        unsigned int start = (unsigned int)(datas[0] - sizeof(Record) - m_pBuffer);
+        m_nUsed -= m_nIn > start ? m_nIn - start : m_nSize - start + m_nIn;
+        m_nIn = start;
+        for (int i = 0; i < count; i++)
+        {
+            if (dataSizes[i] == 0)
+            {
+                datas[i] = 0;
+                continue;
+            }
+            char *data = Allocate(dataSizes[i]);
+            assert(data != 0);
+            if (data != datas[i]) memmove(data, datas[i], dataSizes[i]);
+            datas[i] = data;
+        }
+    }
+
+    void Release(char *data)
+    {
+        assert(Owns(data));
+        Record *record = (Record*)data - 1;
+        assert(record->released == 0);
+        record->released = 1;
+
+        /// sweep release cursor over every freed record at the front
+        while (m_nUsed > 0)
+        {
+            Record *oldest = (Record*)(m_pBuffer + m_nOut);
+            if (oldest->released == 0) break;
+            m_nOut += oldest->size;
+            if (m_nOut == m_nSize) m_nOut = 0;
+            m_nUsed -= oldest->size;
+        }
+    }
+};
+GECO_NET_END_NSPACE
+#endif
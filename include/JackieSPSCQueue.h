@@ -70,6 +70,41 @@ class JackieSPSCQueue
         }
         return true;
     }
+    /// push @count elements with one index update so that consumer
+    /// sees the whole batch at once, will spin until there is room for all of them
+    /// will walways return true;
+    bool PushTail(const elementType* buffer, unsigned int count)
+    {
+        unsigned int m_len = m_ElementSize * count;
+        assert(m_len <= m_nSize);
+
+        /// Ensure that we sample the m_nOut index -before- we start putting bytes into the UnlockQueue.
+        do
+        {
+#ifdef _WIN32
+            MemoryBarrier();
+#else
+            __sync_synchronize();
+#endif
+        } while (m_nSize - m_nIn + m_nOut < m_len);
+
+        /// first put the data starting from fifo->in to buffer end 
+        unsigned int l = m_nSize - (m_nIn  & (m_nSize - 1));
+        l = m_len < l ? m_len : l;
+
+        memcpy(m_pBuffer + (m_nIn & (m_nSize - 1)), buffer, l);
+        /// then put the rest (if any) at the beginning of the buffer 
+        memcpy(m_pBuffer, (const char*)buffer + l, m_len - l);
+
+        /// Ensure that we add the bytes to the kfifo -before- we update the fifo->in index.
+#ifdef _WIN32
+        MemoryBarrier();
+#else
+        __sync_synchronize();
+#endif
+        m_nIn += m_len;
+        return true;
+    }
     bool PopHead(elementType& buffer)
     {
         unsigned int  m_len = 0;
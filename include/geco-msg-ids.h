@@ -423,10 +423,17 @@ enum MsgEnum : unsigned char
     ID_NAT_REQUEST_BOUND_ADDRESSES,
     ID_NAT_RESPOND_BOUND_ADDRESSES,
     ID_FCM2_UPDATE_USER_CONTEXT,
-    ID_RESERVED_3,
-    ID_RESERVED_4,
-    ID_RESERVED_5,
-    ID_RESERVED_6,
+    /// Header(1), OfflineMesageID(16), probe size(2), nonce(4), Pad(to probe size), sent to a connected system
+    /// by packetization layer path mtu discovery (internal use only)
+    ID_PATH_MTU_PROBE,
+    /// Header(1), OfflineMesageID(16), probe size(2), nonce(4), tells the prober that probe made it (internal use only)
+    ID_PATH_MTU_PROBE_REPLY,
+    /// Header(1), OfflineMesageID(16), sender guid(8), group address, reliability(1), sequence(4),
+    /// user data, one datagram sent to a multicast group (internal use only)
+    ID_MULTICAST_DATA,
+    /// Header(1) only, wakes up a recv thread blocked in poll() or recvfrom(), sent when its
+    /// shm ring gets data or the thread is told to stop. dropped as too short (internal use only)
+    ID_RECV_WAKEUP,
     ID_RESERVED_7,
     ID_RESERVED_8,
     ID_RESERVED_9,
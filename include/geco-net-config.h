@@ -152,6 +152,21 @@
 #ifndef USE_SLIDING_WINDOW_CONGESTION_CONTROL
 #define USE_SLIDING_WINDOW_CONGESTION_CONTROL 1
 #endif
+/// Congestion window of a new connection in datagrams of its mtu
+#ifndef GECO_CC_INITIAL_WINDOW
+#define GECO_CC_INITIAL_WINDOW 4
+#endif
+/// Retransmission timeout in us before the first rtt sample and the bounds
+/// it is kept in afterwards (RFC 6298). naks resend most losses long before it fires
+#ifndef GECO_CC_INITIAL_RTO_US
+#define GECO_CC_INITIAL_RTO_US 1000000
+#endif
+#ifndef GECO_CC_MIN_RTO_US
+#define GECO_CC_MIN_RTO_US 100000
+#endif
+#ifndef GECO_CC_MAX_RTO_US
+#define GECO_CC_MAX_RTO_US 3000000
+#endif
 
 /// When a large message is arriving, preallocate the memory for the entire block
 /// This results in large messages not taking up time to reassembly with memcpy, but is 
@@ -223,11 +238,348 @@
 #endif
 
 #ifndef GECO_SO_SNDBUF_SIZE
-#define GECO_SO_SNDBUF_SIZE 1024*256; //256KB
+#define GECO_SO_SNDBUF_SIZE (1024*256) //256KB
 #endif
 
+/// SO_RCVBUF every socket starts with and never shrinks below
 #ifndef GECO_SO_REVBUF_SIZE
-#define GECO_SO_REVBUF_SIZE 1024*256; //256KB
+#define GECO_SO_REVBUF_SIZE (1024*256) //256KB
+#endif
+
+/// Define to 1 to turn on SO_RXQ_OVFL so every recv reads how many datagrams kernel
+/// has dropped on the socket because its buffer was full, see berkley_socket_t::GetKernelDropped().
+/// SO_RCVBUF then adapts: doubled when drops show up, halved after a quiet while
+#ifndef GECO_ENABLE_RXQ_OVFL
+#define GECO_ENABLE_RXQ_OVFL 1
+#endif
+
+/// Ceiling SO_RCVBUF may grow to, kernel also caps it at net.core.rmem_max
+/// unless process has CAP_NET_ADMIN (SO_RCVBUFFORCE)
+#ifndef GECO_SO_REVBUF_MAX_SIZE
+#define GECO_SO_REVBUF_MAX_SIZE (1024*1024*16) //16MB
+#endif
+
+/// How often in ms recv thread looks at the drop counter to resize SO_RCVBUF
+#ifndef GECO_SO_REVBUF_ADJUST_INTERVAL_MS
+#define GECO_SO_REVBUF_ADJUST_INTERVAL_MS 1000
+#endif
+
+/// Intervals in a row without drops before SO_RCVBUF is halved again
+#ifndef GECO_SO_REVBUF_SHRINK_INTERVALS
+#define GECO_SO_REVBUF_SHRINK_INTERVALS 30
+#endif
+
+/// Define to 1 to mark every datagram ECT(0) and read the ECN bits of received ones,
+/// so CE marks from ECN capable switches reach the congestion control before losses do
+#ifndef GECO_ENABLE_ECN
+#define GECO_ENABLE_ECN 1
+#endif
+
+/// Define to 1 to stamp each datagram to a connected system with a departure time
+/// (SO_TXTIME) paced from its congestion window and rtt, so kernel spreads the datagrams
+/// of one update cycle over time instead of bursting them. Needs fq qdisc on the egress
+/// interface (tc qdisc replace dev eth0 root fq), other qdiscs send them straight away
+#ifndef GECO_ENABLE_TXTIME
+#define GECO_ENABLE_TXTIME 0
+#endif
+/// Max time in us a datagram may be stamped ahead of now, one network update cycle.
+/// Pacing never queues further ahead than this, the rest goes out at the horizon
+#ifndef GECO_TXTIME_HORIZON_US
+#define GECO_TXTIME_HORIZON_US 10000
+#endif
+/// Pacing rate is this percentage of congestion window per rtt, above 100 so
+/// pacing itself never keeps the window from being filled
+#ifndef GECO_TXTIME_PACING_GAIN_PERCENT
+#define GECO_TXTIME_PACING_GAIN_PERCENT 125
+#endif
+/// Max time in us a buffered message waits for others to share its datagram.
+/// a full datagram or an UNBUFFERED_IMMEDIATELY_SEND message flushes earlier
+#ifndef GECO_SEND_AGGREGATION_DELAY_US
+#define GECO_SEND_AGGREGATION_DELAY_US 1000
+#endif
+/// Max time in us a received datagram waits to be acked, all datagrams received
+/// meanwhile are acked together as ranges. holes are nak'ed without waiting
+#ifndef GECO_ACK_DELAY_US
+#define GECO_ACK_DELAY_US 1000
+#endif
+/// Acks are never resent, so every ack range also rides in the next this many ack
+/// datagrams. one lost ack then does not leave its datagrams waiting for rto
+#ifndef GECO_ACK_REPEATS
+#define GECO_ACK_REPEATS 2
+#endif
+/// Idle time in us after the last ack before the ranges still to repeat go out on
+/// their own, at the end of a burst no further ack would carry them
+#ifndef GECO_ACK_REPEAT_DELAY_US
+#define GECO_ACK_REPEAT_DELAY_US 5000
+#endif
+/// Sent datagrams remembered for acks and naks, power of 2. no more than this many
+/// datagrams of one connection are ever in flight, a slot is reused only once acked
+#ifndef GECO_DATAGRAM_HISTORY_SIZE
+#define GECO_DATAGRAM_HISTORY_SIZE 512
+#endif
+/// Reliable message indexes ahead of the oldest missing one that duplicates are
+/// detected for, power of 2 and multiple of 32
+#ifndef GECO_RELIABLE_WINDOW_SIZE
+#define GECO_RELIABLE_WINDOW_SIZE 8192
+#endif
+
+/// Define to 1 to send every datagram with DF set (IP_PMTUDISC_PROBE) and search
+/// the path mtu of each connection with padded probes (packetization layer PMTUD)
+#ifndef GECO_ENABLE_PLPMTUD
+#define GECO_ENABLE_PLPMTUD 1
+#endif
+/// How long to wait for the reply of one path mtu probe before it counts as lost
+#ifndef GECO_PLPMTUD_PROBE_TIMEOUT_MS
+#define GECO_PLPMTUD_PROBE_TIMEOUT_MS 500
+#endif
+/// A probe size is taken as too big for the path after this many lost probes
+#ifndef GECO_PLPMTUD_MAX_PROBES
+#define GECO_PLPMTUD_MAX_PROBES 3
+#endif
+/// Search stops when confirmed size and too-big size are closer than this
+#ifndef GECO_PLPMTUD_SEARCH_GRANULARITY
+#define GECO_PLPMTUD_SEARCH_GRANULARITY 16
+#endif
+/// Retransmission timeouts in a row that took datagrams bigger than the handshake
+/// size with them before the path counts as a black hole for them, MTUSize then
+/// drops back to the handshake size and the search starts over
+#ifndef GECO_PLPMTUD_BLACK_HOLE_TIMEOUTS
+#define GECO_PLPMTUD_BLACK_HOLE_TIMEOUTS 3
+#endif
+/// After a search stops, try a bigger size again after this long, paths change
+#ifndef GECO_PLPMTUD_RAISE_INTERVAL_MS
+#define GECO_PLPMTUD_RAISE_INTERVAL_MS 600000
+#endif
+/// Slots of the path mtu cache keyed by destination prefix (ipv4 /24, ipv6 /64),
+/// must be power of 2
+#ifndef GECO_PLPMTUD_CACHE_SIZE
+#define GECO_PLPMTUD_CACHE_SIZE 256
+#endif
+/// Cached path mtu older than this is ignored
+#ifndef GECO_PLPMTUD_CACHE_TIMEOUT_MS
+#define GECO_PLPMTUD_CACHE_TIMEOUT_MS 600000
+#endif
+
+/// Slots that remember the last sequence of UNRELIABLE_SEQUENCED multicast data per
+/// sender and group, must be power of 2. Colliding senders take turns on one slot
+#ifndef GECO_MULTICAST_SENDERS_SIZE
+#define GECO_MULTICAST_SENDERS_SIZE 64
+#endif
+
+/// Multicast groups one socket can be a member of at once
+#ifndef GECO_MULTICAST_GROUPS_SIZE
+#define GECO_MULTICAST_GROUPS_SIZE 8
+#endif
+
+/// Biggest socket_binding_params_t::maxMTUSize a socket may be bound with, 9000 byte
+/// jumbo frames. Sockets left at the default keep MAXIMUM_MTU_SIZE buffers
+#ifndef GECO_MAX_JUMBO_MTU_SIZE
+#define GECO_MAX_JUMBO_MTU_SIZE 9000
+#endif
+
+/// Max number of datagrams that recv thread pulls out of kernel with one recvmmsg() call.
+/// Define to 1 to always use the one-recvfrom()-per-datagram path. Platforms without
+/// recvmmsg() default to 1 so recv thread does not allocate params it can never fill
+#ifndef GECO_RECV_BATCH_SIZE
+#if defined(__linux__) && !defined(ANDROID)
+#define GECO_RECV_BATCH_SIZE 32
+#else
+#define GECO_RECV_BATCH_SIZE 1
+#endif
+#endif
+
+/// Max number of datagrams network thread gathers per socket during one update cycle
+/// before it sends them with one sendmmsg() call. Define to 1 to send every datagram
+/// with its own sendto(). Platforms without sendmmsg() default to 1
+#ifndef GECO_SEND_BATCH_SIZE
+#if defined(__linux__) && !defined(ANDROID)
+#define GECO_SEND_BATCH_SIZE 64
+#else
+#define GECO_SEND_BATCH_SIZE 1
+#endif
+#endif
+
+/// Define to 1 to let berkley_socket_t::SendSegmented() hand all segments of a split message
+/// to kernel in one UDP_SEGMENT (linux >= 4.18) buffer. When kernel or NIC does not support it,
+/// it falls back to user space split at the first failure
+#ifndef GECO_ENABLE_UDP_GSO
+#define GECO_ENABLE_UDP_GSO 1
+#endif
+
+/// Define to 1 to turn on SO_ZEROCOPY (linux >= 5.0 for udp) on every bound socket
+/// and send big segmented buffers with MSG_ZEROCOPY
+#ifndef GECO_ENABLE_ZEROCOPY
+#define GECO_ENABLE_ZEROCOPY 0
+#endif
+
+/// MSG_ZEROCOPY is only used for buffers at least this big, below it page
+/// pinning and completion reaping cost more than the copy itself
+#ifndef GECO_ZEROCOPY_MIN_BYTES
+#define GECO_ZEROCOPY_MIN_BYTES 16384
+#endif
+
+/// Define to 1 to turn on UDP_GRO (linux >= 5.0) on every bound socket so that kernel
+/// hands recv thread several same-flow datagrams in one coalesced buffer. Recv thread then
+/// splits it into per-datagram recv params that point into that shared buffer
+#ifndef GECO_ENABLE_UDP_GRO
+#define GECO_ENABLE_UDP_GRO 0
+#endif
+
+/// Size of one coalesced gro buffer, kernel never coalesces beyond a 64KB udp payload
+#ifndef GECO_GRO_BUFFER_SIZE
+#define GECO_GRO_BUFFER_SIZE 65535
+#endif
+
+/// Number of gro buffers recv thread fills with one recvmmsg() call
+#ifndef GECO_GRO_BATCH_SIZE
+#define GECO_GRO_BATCH_SIZE 4
+#endif
+
+/// Bytes of the per-socket ring recv thread packs received datagrams into back to back,
+/// recv thread waits for network thread to release records once it is full.
+/// MUST hold at least GECO_RECV_BATCH_SIZE max mtu datagrams
+#ifndef GECO_RECV_RING_SIZE
+#define GECO_RECV_RING_SIZE 1024*1024
+#endif
+
+/// Define to 1 to turn on SO_TIMESTAMPNS on every bound socket so that recv_params_t::timeRead
+/// is the time kernel got the datagram instead of the time recv thread got round to it.
+/// Only recvmmsg() and io_uring paths read the stamp, plain recvfrom() keeps the old behaviour
+#ifndef GECO_ENABLE_RECV_TIMESTAMPS
+#define GECO_ENABLE_RECV_TIMESTAMPS 1
+#endif
+
+/// Define to 1 to turn on IP_PKTINFO / IPV6_RECVPKTINFO on a socket bound to INADDR_ANY
+/// or in6addr_any. One such socket then learns the local addr of every datagram and
+/// replies from it, so a multi-homed host needs no socket per local ip
+#ifndef GECO_ENABLE_PKTINFO
+#define GECO_ENABLE_PKTINFO 1
+#endif
+
+/// Define to 1 to let one reactor thread wait on all binded sockets with epoll (linux only)
+/// instead of running one blocking recv thread per socket. Sockets are then always non-blocking
+/// and stop_recv_thread() wakes the reactor up with an eventfd instead of sending to itself
+#ifndef GECO_USE_EPOLL_REACTOR
+#define GECO_USE_EPOLL_REACTOR 0
+#endif
+#if GECO_USE_EPOLL_REACTOR == 1 && !defined(__linux__)
+#undef GECO_USE_EPOLL_REACTOR
+#define GECO_USE_EPOLL_REACTOR 0
+#endif
+
+/// Max time in ms reactor thread blocks in epoll_wait()
+#ifndef GECO_REACTOR_WAIT_MS
+#define GECO_REACTOR_WAIT_MS 10
+#endif
+
+/// Recv cycles (batches of GECO_RECV_BATCH_SIZE) reactor runs on one ready socket before
+/// the others get their turn, a socket with more waiting is requeued behind them
+#ifndef GECO_REACTOR_CYCLES_PER_WAKEUP
+#define GECO_REACTOR_CYCLES_PER_WAKEUP 8
+#endif
+
+/// USE_SINGLE_THREAD only: datagrams poll_once() reads at most per call, what it
+/// takes when asked for budget 0 and what fetch_packet() passes it
+#ifndef GECO_POLL_ONCE_BUDGET
+#define GECO_POLL_ONCE_BUDGET 1024
+#endif
+/// USE_SINGLE_THREAD only: most next_deadline_ms() returns, reliability layer
+/// resends and acks are not tracked one by one and get this resolution
+#ifndef GECO_EVENT_LOOP_MAX_WAIT_MS
+#define GECO_EVENT_LOOP_MAX_WAIT_MS 10
+#endif
+
+/// Define to 1 to let socket_binding_params_t::connectedPeerSockets open a connect()ed
+/// socket per CONNECTED remote system on the port of the shared one (linux only, it needs
+/// SO_REUSEPORT and poll()). Kernel then routes its sends once and demuxes its datagrams early
+#ifndef GECO_ENABLE_PEER_SOCKETS
+#if defined(__linux__) && !defined(ANDROID)
+#define GECO_ENABLE_PEER_SOCKETS 1
+#else
+#define GECO_ENABLE_PEER_SOCKETS 0
+#endif
+#endif
+/// Max connected sockets next to one shared socket, remote systems beyond it keep
+/// sending through the shared one
+#ifndef GECO_MAX_PEER_SOCKETS
+#define GECO_MAX_PEER_SOCKETS 64
+#endif
+
+/// Define to 1 to move the traffic of a CONNECTED remote system on the same host
+/// (loopback or same boot id, agreed on in the handshake) onto a shared memory ring pair
+/// and off the kernel (linux only). Recv thread reads the rings next to the peer sockets,
+/// so it needs GECO_ENABLE_PEER_SOCKETS and does not go with GECO_USE_EPOLL_REACTOR.
+/// The host id then rides in the connection handshake, both ends MUST agree on it
+#ifndef GECO_ENABLE_SHM_TRANSPORT
+#define GECO_ENABLE_SHM_TRANSPORT 0
+#endif
+#if GECO_ENABLE_SHM_TRANSPORT == 1 && (!defined(__linux__) || GECO_ENABLE_PEER_SOCKETS == 0 || GECO_USE_EPOLL_REACTOR == 1)
+#undef GECO_ENABLE_SHM_TRANSPORT
+#define GECO_ENABLE_SHM_TRANSPORT 0
+#endif
+/// Datagrams one direction of a shm channel holds before new ones are dropped, MUST be power of 2.
+/// Every slot takes GECO_MAX_JUMBO_MTU_SIZE bytes so both ends agree on the layout
+#ifndef GECO_SHM_TRANSPORT_SLOTS
+#define GECO_SHM_TRANSPORT_SLOTS 256
+#endif
+
+/// Define to 1 to let AllocJIS() hand out io_uring sockets (linux 6.0+, raw syscalls, no liburing).
+/// Kernel support is probed at runtime, older kernels silently get berkley sockets
+#ifndef GECO_ENABLE_IO_URING
+#define GECO_ENABLE_IO_URING 0
+#endif
+#if GECO_ENABLE_IO_URING == 1 && !defined(__linux__)
+#undef GECO_ENABLE_IO_URING
+#define GECO_ENABLE_IO_URING 0
+#endif
+
+/// Provided buffers kept armed per io_uring socket for multishot recvmsg, MUST be power of 2
+#ifndef GECO_IO_URING_BUFFERS
+#define GECO_IO_URING_BUFFERS 256
+#endif
+
+/// Define to 1 to let a kernel thread poll io_uring send queue, so sends need no syscall
+/// while it is awake. Costs one busy kernel thread per socket
+#ifndef GECO_IO_URING_SQPOLL
+#define GECO_IO_URING_SQPOLL 0
+#endif
+
+/// Egress batches per io_uring socket. Sends complete asynchronously, network thread
+/// fills the next batch while kernel still sends the others. If all of them are still
+/// in flight at flush, that batch goes out through plain sendmmsg()
+#ifndef GECO_IO_URING_SEND_BANKS
+#define GECO_IO_URING_SEND_BANKS 4
+#endif
+
+/// Datagrams one virtual_transceiver_t holds before virtual_network_t drops new ones,
+/// the in-process counterpart of a full socket buffer
+#ifndef GECO_VIRTUAL_NETWORK_INBOX_SIZE
+#define GECO_VIRTUAL_NETWORK_INBOX_SIZE 4096
+#endif
+
+/// Hash buckets virtual_network_t spreads its endpoints over, MUST be power of 2
+#ifndef GECO_VIRTUAL_NETWORK_BUCKETS
+#define GECO_VIRTUAL_NETWORK_BUCKETS 4096
+#endif
+
+/// Define to 1 to let socket_binding_params_t::unixSocketDir bind AF_UNIX SOCK_DGRAM sockets
+/// for services on the same host, they skip ip and udp processing and checksums
+#ifndef GECO_ENABLE_UNIX_SOCKETS
+#if defined(_WIN32)
+#define GECO_ENABLE_UNIX_SOCKETS 0
+#else
+#define GECO_ENABLE_UNIX_SOCKETS 1
+#endif
+#endif
+/// Port unix_transceiver_t starts from when asked for port 0
+#ifndef GECO_UNIX_SOCKET_FIRST_PORT
+#define GECO_UNIX_SOCKET_FIRST_PORT 49152
+#endif
+
+/// Host unix socket paths show up as, so dir/port never equals a real udp peer.
+/// Default is in 240.0.0.0/4, reserved and never the source of a real datagram
+#ifndef GECO_UNIX_SOCKET_HOST
+#define GECO_UNIX_SOCKET_HOST "240.0.0.1"
 #endif
 
 #define GECO_STATIC_FACTORY_DELC(TYPE)\
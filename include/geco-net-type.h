@@ -40,6 +40,7 @@ struct  network_address_t;
 struct  guid_t;
 class network_socket_t;
 class transport_layer_t;
+class virtual_network_t;
 
 //////////////////////////////////////////////////////////////////////////
 /// @Internal Defines the default maximum transfer unit.
@@ -248,6 +249,40 @@ struct GECO_EXPORT socket_binding_params_t
     /// XBOX only: set IPPROTO_VDP if you want to use VDP.
     /// If enabled, this socket does not support broadcast to 255.255.255.255
     unsigned int extraSocketOptions;
+
+    /// Linux only: open this many sockets on the same port with SO_REUSEPORT,
+    /// each of them has its own recv thread so that recv scales over cores.
+    /// default is 1 (no fan-out)
+    uint reusePortSockets;
+
+    /// Linux only: with @reusePortSockets > 1, attach a reuseport CBPF program so that
+    /// datagrams of a given client address always land on the same socket of the group
+    bool reusePortAffinity;
+
+    /// Bind on this in-process network instead of the kernel, see virtual_network_t.
+    /// default is 0 (real socket)
+    virtual_network_t* virtualNetwork;
+
+    /// Bind an AF_UNIX datagram socket at unixSocketDir/port instead of udp, every app
+    /// on this host sharing the dir reaches it as GECO_UNIX_SOCKET_HOST:port. Port 0 takes the first
+    /// free one from GECO_UNIX_SOCKET_FIRST_PORT. default is 0 (udp socket)
+    const char* unixSocketDir;
+
+    /// Linux only: open a connect()ed socket on this port for every remote system that
+    /// becomes CONNECTED, meant for a few long-lived busy links such as server to server.
+    /// The socket is then bound with SO_REUSEPORT. default is false
+    bool connectedPeerSockets;
+
+    /// Linux only: attach a classic BPF program that drops in kernel every datagram that is
+    /// too short, or neither connected data nor a known offline message with the offline
+    /// magic in place, so floods of junk never cost a recvfrom(). default is false
+    bool recvPrefilter;
+
+    /// Biggest datagram this socket sends and receives, handshake pads the first
+    /// connection request up to it and the path mtu search never goes beyond it.
+    /// Raise it to 9000 on jumbo frame networks, receive buffers of this socket are
+    /// sized by it. Capped to GECO_MAX_JUMBO_MTU_SIZE, default is MAXIMUM_MTU_SIZE
+    ushort maxMTUSize;
 };
 
 /// Network address for a system Corresponds to a network address
@@ -856,8 +891,29 @@ struct GECO_EXPORT remote_system_t
     Time connectionTime;
     guid_t guid;
     int MTUSize;
+    /// packetization layer path mtu discovery, MTUSize follows confirmed
+    struct PathMtuSearch
+    {
+        ushort base; /// size the handshake made it with, black holes fall back to it
+        ushort confirmed; /// largest size the remote system has replied
+        ushort tooBig; /// smallest size lost GECO_PLPMTUD_MAX_PROBES times
+        ushort probing; /// size of the probe in flight, 0 if none
+        uint nonce; /// echoed back by replies to probes of size probing
+        uchar probesLost; /// lost probes of size probing so far
+        bool finished; /// tooBig - confirmed is under GECO_PLPMTUD_SEARCH_GRANULARITY
+        TimeMS nextProbeTime;
+    } pathMtu;
     // Reference counted socket to send back on
     network_socket_t* socket2use;
+    /// local addr to send from when socket2use is bound to the wildcard addr,
+    /// goes to send_params_t::senderINetAddress. JACKIE_NULL_ADDRESS otherwise
+    network_address_t address2use;
+    /// connected socket dedicated to this system, 0 if none. socket2use points at it
+    /// while it is open and goes back to sharedSocket when it is closed
+    network_socket_t* peerSocket;
+    network_socket_t* sharedSocket;
+    /// loopback addr or same host id in the handshake, its traffic can go through shm
+    bool sameHost;
     system_index_t remoteSystemIndex;
 
 #if ENABLE_SECURE_HAND_SHAKE==1
@@ -899,6 +955,7 @@ struct GECO_EXPORT cmd_t
         /* BCS_USE_USER_SOCKET, BCS_REBIND_SOCKET_ADDRESS, BCS_RPC, BCS_RPC_SHIFT,*/
         BCS_ADD_2_BANNED_LIST,
         BCS_CONEECT,
+        BCS_MULTICAST_SEND,
         BCS_DO_NOTHING,
     } commandID;
 
@@ -0,0 +1,102 @@
+#ifndef GECO_SHM_TRANSPORT_H_
+#define GECO_SHM_TRANSPORT_H_
+
+#include "geco-export.h"
+#include "geco-net-config.h"
+#include "geco-net-type.h"
+#include "network_socket_t.h"
+
+#if GECO_ENABLE_SHM_TRANSPORT == 1
+GECO_NET_BEGIN_NSPACE
+
+/// one direction of a shm channel, single producer and single consumer.
+/// head and tail sit on their own cache lines so both ends do not fight over one
+struct shm_ring_t
+{
+    volatile uint head; /// next slot to read, only written by consumer
+    char headPad[64 - sizeof(uint)];
+    volatile uint tail; /// next slot to write, only written by producer
+    char tailPad[64 - sizeof(uint)];
+};
+
+/// what both processes map, GECO_SHM_TRANSPORT_SLOTS slots per ring follow it,
+/// ring 0 first. every slot is a uint length and GECO_MAX_JUMBO_MTU_SIZE bytes
+struct shm_segment_t
+{
+    volatile uint magic;
+    /// 1 while the side has the segment mapped, side 0 is the lower guid
+    volatile uint attached[2];
+    /// 1 while the side is about to block in poll(), the other side rings its doorbell then
+    volatile uint waiting[2];
+    char pad[64 - 5 * sizeof(uint)];
+    shm_ring_t rings[2];
+};
+
+///====================================================
+/// Endpoint of a shared memory channel between two apps on the same host,
+/// what a berkley_socket_t sends and receives through once BindShm() has attached it.
+/// 1. both ends open the same POSIX shm segment named after both guids,
+///     side of the lower guid transmits on ring 0 and receives on ring 1
+/// 2. until the other end has attached, datagrams go through @udp like before
+/// 3. there is no fd to poll, so a recv thread about to block calls ArmDoorbell()
+///     and the sender answers with an ID_RECV_WAKEUP datagram to its udp socket that wakes
+///     poll() up. IsOfflineRecvParams() drops it as too short
+/// 4. a full ring drops the datagram like a full socket buffer would. so does
+///     recv side for one longer than mtu, both are only counted
+/// 5. send from network thread only, recv from recv thread only
+///=======================================================
+class GECO_EXPORT shm_transceiver_t : public transceiver_t
+{
+    private:
+    shm_segment_t *segment;
+    char *txSlots;
+    char *rxSlots;
+    uint side;
+    char name[64];
+    network_address_t remoteAddress;
+    /// the shared socket of this index, carries the doorbell and the traffic
+    /// the other end is not ready to take from the ring yet
+    berkley_socket_t *udp;
+    ushort maxMTUSize;
+
+    /// full ring, counted by network thread
+    uint datagramsDropped;
+    /// longer than mtu, counted by recv thread
+    uint datagramsTooBig;
+
+    inline char* Slot(char *slots, uint i) const
+    {
+        return slots + (i & (GECO_SHM_TRANSPORT_SLOTS - 1)) * (sizeof(uint) + GECO_MAX_JUMBO_MTU_SIZE);
+    }
+    void SendUdp(const char *data, int length);
+
+    public:
+    shm_transceiver_t();
+    virtual ~shm_transceiver_t();
+
+    /// map the segment of @localGuid and @remoteGuid, creating it if we are the first.
+    /// datagrams received are reported as sent from @remote, never longer than @mtu
+    bool Open(const guid_t &localGuid, const guid_t &remoteGuid, const network_address_t &remote,
+        berkley_socket_t *udp, ushort mtu);
+    /// detach, the last end out unlinks the segment
+    void Close(void);
+    inline bool IsOpen(void) const { return segment != 0; }
+    inline bool IsRemoteAttached(void) const { return segment != 0 && segment->attached[side ^ 1] != 0; }
+    inline uint GetDatagramsDropped(void) const { return datagramsDropped; }
+    inline uint GetDatagramsTooBig(void) const { return datagramsTooBig; }
+
+    /// tell the other end to ring our doorbell on its next send,
+    /// false if something is already waiting and recv thread must not block
+    bool ArmDoorbell(void);
+    void DisarmDoorbell(void);
+
+    virtual int JackieINetSendTo(const char *data, int length, const network_address_t &systemAddress) override;
+    virtual int JackieINetRecvFrom(char *dataOut, int capacity, network_address_t *senderOut, bool calledFromMainThread) override;
+    virtual bool IsFork(const network_address_t &systemAddress) const override;
+
+    /// same for every process of this host until it reboots, 0 if it cannot be told
+    static ulonglong GetHostId(void);
+};
+GECO_NET_END_NSPACE
+#endif
+#endif
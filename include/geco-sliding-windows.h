@@ -6,23 +6,32 @@ http://www.ssfnet.org/Exchange/tcp/tcpTutorialNotes.html
 cwnd=max bytes allowed on wire at once
 
 Start:
-cwnd=mtu
+cwnd=GECO_CC_INITIAL_WINDOW*mtu
 ssthresh=unlimited
 
 Slow start:
-On ack cwnd*=2
+On ack cwnd+=bytes acked, which doubles cwnd every rtt
 
 congestion avoidance:
 On ack during new period
 cwnd+=mtu*mtu/cwnd
 
-on loss or duplicate ack during period:
+on nak or ECN CE echo during period:
+sshtresh=cwnd/2
+cwnd=ssthresh
+This stays in congestion avoidance
+
+on retransmission timeout:
 sshtresh=cwnd/2
 cwnd=MTU
+rto*=2
 This reenters slow start
 
 If cwnd < ssthresh, then use slow start
 else use congestion avoidance
+
+A period ends once everything sent before the last back off is acked or lost,
+so a burst of losses halves cwnd only once.
 */
 #include "geco-basic-type.h"
 #include "geco-time.h"
@@ -32,13 +41,75 @@ else use congestion avoidance
 const  ushort UDP_HEADER_SIZE = 28; ///IP HEADER 20 + UDP HEADER 8 = 28 BYTES
 
 GECO_NET_BEGIN_NSPACE
-class JackieSlidingWindows
+
+/// what transport_layer_t asks before and tells after sending data datagrams of
+/// one connection. bytes are whole datagrams on wire, UDP_HEADER_SIZE included.
+/// acks and naks themselves are never counted. implement it and hand it to
+/// transport_layer_t::SetCongestionController() to drop in another algorithm
+class GECO_EXPORT congestion_controller_t
 {
+    public:
+    virtual ~congestion_controller_t() { }
+
+    /// connection starts over with datagrams of at most @mtu bytes
+    virtual void Reset(ushort mtu) = 0;
+    /// false if @bytes more must wait for acks or losses to free the window
+    virtual bool CanSend(uint bytes) const = 0;
+    virtual void OnSend(uint bytes, TimeUS timeUS) = 0;
+    /// datagram of @bytes sent at @sendTimeUS is acked at @timeUS
+    virtual void OnAck(uint bytes, TimeUS sendTimeUS, TimeUS timeUS) = 0;
+    /// datagram of @bytes sent at @sendTimeUS is nak'ed, or @timedOut without an ack
+    virtual void OnLoss(uint bytes, TimeUS sendTimeUS, TimeUS timeUS, bool timedOut) = 0;
+    /// remote system echoed new CE marks, nothing is lost but queues are building
+    virtual void OnCongestionEvent(TimeUS timeUS) = 0;
+
+    /// bytes allowed in flight, also what pacing spreads over one rtt
+    virtual uint GetCongestionWindow(void) const = 0;
+    virtual uint GetBytesInFlight(void) const = 0;
+    /// 0 until the first rtt sample
+    virtual TimeUS GetSmoothedRtt(void) const = 0;
+    /// how long the oldest datagram in flight waits for its ack before it is lost
+    virtual TimeUS GetRto(void) const = 0;
+};
+
+/// window based slow start and congestion avoidance as described above,
+/// rtt and rto estimated as in RFC 6298
+class GECO_EXPORT JackieSlidingWindows : public congestion_controller_t
+{
+    private:
+    uint mtu;
+    uint cwnd;
+    uint ssthresh;
+    uint bytesInFlight;
+    /// bytes acked since cwnd last grew by one mtu in congestion avoidance
+    uint bytesAckedInPeriod;
+    TimeUS srtt;
+    TimeUS rttVar;
+    TimeUS rto;
+    /// when cwnd last backed off, losses of datagrams sent before it are the same event
+    TimeUS backOffTime;
+    bool backedOff;
+
+    void BackOff(TimeUS timeUS);
+
     public:
     JackieSlidingWindows();
-    ~JackieSlidingWindows();
+    virtual ~JackieSlidingWindows();
+
+    virtual void Reset(ushort mtu);
+    virtual bool CanSend(uint bytes) const;
+    virtual void OnSend(uint bytes, TimeUS timeUS);
+    virtual void OnAck(uint bytes, TimeUS sendTimeUS, TimeUS timeUS);
+    virtual void OnLoss(uint bytes, TimeUS sendTimeUS, TimeUS timeUS, bool timedOut);
+    virtual void OnCongestionEvent(TimeUS timeUS);
+
+    virtual uint GetCongestionWindow(void) const { return cwnd; }
+    virtual uint GetBytesInFlight(void) const { return bytesInFlight; }
+    virtual TimeUS GetSmoothedRtt(void) const { return srtt; }
+    virtual TimeUS GetRto(void) const { return rto; }
+    uint GetSsthresh(void) const { return ssthresh; }
+    bool IsInSlowStart(void) const { return cwnd < ssthresh; }
 };
 GECO_NET_END_NSPACE
 
 #endif // JackieSlidingWindows_h__
-
@@ -52,6 +52,14 @@
 #define select__ select
 #   endif
 
+/// batched datagram syscalls are only available on linux (kernel >= 2.6.33)
+#   if defined(__linux__) && !defined(ANDROID)
+#define recvmmsg__ recvmmsg
+#define sendmmsg__ sendmmsg
+#define sendmsg__ sendmsg
+#define recvmsg__ recvmsg
+#   endif
+
 #define accept__ accept
 #define connect__ connect
 #define socket__ socket
@@ -75,6 +75,38 @@ typedef int socklen_t;
 #include <fcntl.h>
 #include <pthread.h>
 
+#   if defined(__linux__) && !defined(ANDROID)
+#include <netinet/udp.h>
+#include <linux/errqueue.h>
+#include <linux/filter.h>
+/// keep building against older glibc and kernel headers, berkley_socket_t
+/// falls back at runtime when kernel does not know these options
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+#ifndef SO_REUSEPORT
+#define SO_REUSEPORT 15
+#endif
+#ifndef SO_ATTACH_REUSEPORT_CBPF
+#define SO_ATTACH_REUSEPORT_CBPF 51
+#endif
+#ifndef UDP_GRO
+#define UDP_GRO 104
+#endif
+#ifndef SO_ZEROCOPY
+#define SO_ZEROCOPY 60
+#endif
+#ifndef MSG_ZEROCOPY
+#define MSG_ZEROCOPY 0x4000000
+#endif
+#ifndef SO_EE_ORIGIN_ZEROCOPY
+#define SO_EE_ORIGIN_ZEROCOPY 5
+#endif
+#ifndef SO_EE_CODE_ZEROCOPY_COPIED
+#define SO_EE_CODE_ZEROCOPY_COPIED 1
+#endif
+#   endif
+
 #   ifdef __native_client__
 #include "ppapi/cpp/private/net_address_private.h"
 #include "ppapi/c/pp_bool.h"
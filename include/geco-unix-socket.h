@@ -0,0 +1,58 @@
+#ifndef GECO_UNIX_SOCKET_H_
+#define GECO_UNIX_SOCKET_H_
+
+#include "geco-export.h"
+#include "geco-net-config.h"
+#include "geco-net-type.h"
+#include "network_socket_t.h"
+
+#if GECO_ENABLE_UNIX_SOCKETS == 1
+#include <sys/un.h>
+
+GECO_NET_BEGIN_NSPACE
+///====================================================
+/// AF_UNIX SOCK_DGRAM endpoint a berkley_socket_t sends and receives through
+/// once BindUnix() has attached it, for services on the same host.
+/// 1. bound at dir/port, a path in the same dir is GECO_UNIX_SOCKET_HOST:port to the rest
+///     of the library, so connect, reply and lookup by network_address_t are unchanged
+///     and never mixed up with udp peers on loopback. sends to other hosts are dropped
+/// 2. datagrams from a path outside dir cannot be answered and are dropped, like
+///     ones bigger than mtu. any local process can send them, so they are only counted
+/// 3. its fd is what the owning socket polls, so recv threads and the reactor work as usual
+///=======================================================
+class GECO_EXPORT unix_transceiver_t : public transceiver_t
+{
+    private:
+    socket_fd_t fd;
+    char dir[sizeof(((sockaddr_un*)0)->sun_path)];
+    size_t dirLength;
+    sockaddr_un boundPath;
+    ushort maxMTUSize;
+    uint datagramsDropped;
+
+    /// GECO_UNIX_SOCKET_HOST, port 0
+    network_address_t host;
+
+    /// false if dir/@port does not fit into sun_path
+    bool ToPath(ushort port, sockaddr_un &path) const;
+    /// false if @path is not dir/port
+    bool FromPath(const sockaddr_un &path, socklen_t length, network_address_t &address) const;
+    /// unlink @path if nobody is reading it any longer, false if it is in use
+    bool RemoveStalePath(const sockaddr_un &path) const;
+
+    public:
+    unix_transceiver_t();
+    virtual ~unix_transceiver_t();
+
+    /// port of @address picks the path, 0 takes the first free one and fills it in
+    socket_binding_result_t Bind(const char *dir, network_address_t &address, bool isNonBlocking, ushort mtu);
+    inline socket_fd_t GetFd(void) const { return fd; }
+    inline uint GetDatagramsDropped(void) const { return datagramsDropped; }
+
+    virtual int JackieINetSendTo(const char *data, int length, const network_address_t &systemAddress) override;
+    virtual int JackieINetRecvFrom(char *dataOut, int capacity, network_address_t *senderOut, bool calledFromMainThread) override;
+    virtual bool IsFork(const network_address_t &systemAddress) const override;
+};
+GECO_NET_END_NSPACE
+#endif
+#endif
@@ -0,0 +1,107 @@
+#ifndef GECO_VIRTUAL_NETWORK_H_
+#define GECO_VIRTUAL_NETWORK_H_
+
+#include "geco-export.h"
+#include "geco-net-config.h"
+#include "geco-net-type.h"
+#include "network_socket_t.h"
+#include "JackieArraryQueue.h"
+#include "JackieArrayList.h"
+#include "JackieSimpleMutex.h"
+#include "JackieWaitEvent.h"
+
+GECO_NET_BEGIN_NSPACE
+class virtual_network_t;
+
+/// one datagram sitting in a virtual inbox, payload follows the header in one block
+struct GECO_EXPORT virtual_datagram_t
+{
+    network_address_t sender;
+    int length;
+    char *data;
+};
+
+///====================================================
+/// Endpoint of a virtual_network_t, what a berkley_socket_t sends and receives
+/// through instead of the kernel once BindVirtual() has attached it.
+/// 1. any thread can send, virtual_network_t copies the datagram into
+///     the inbox of the endpoint it is addressed to
+/// 2. only the recv thread of the owning socket receives. a blocking one
+///     waits up to GECO_REACTOR_WAIT_MS per call so it still sees endThreads
+///=======================================================
+class GECO_EXPORT virtual_transceiver_t : public transceiver_t
+{
+    friend class virtual_network_t;
+
+    private:
+    virtual_network_t *network;
+    network_address_t address;
+    bool isNonBlocking;
+
+    JackieSimpleMutex inboxMutex;
+    JackieArraryQueue<virtual_datagram_t*> inbox;
+    JackieWaitEvent inboxEvent;
+
+    /// called by virtual_network_t with its table locked, takes @datagram,
+    /// false if inbox is full and it is freed
+    bool Push(virtual_datagram_t *datagram);
+
+    public:
+    virtual_transceiver_t();
+    virtual ~virtual_transceiver_t();
+
+    inline const network_address_t& GetAddress(void) const { return address; }
+    inline virtual_network_t* GetNetwork(void) const { return network; }
+
+    virtual int JackieINetSendTo(const char *data, int length, const network_address_t &systemAddress) override;
+    virtual int JackieINetRecvFrom(char *dataOut, int capacity, network_address_t *senderOut, bool calledFromMainThread) override;
+    virtual bool IsFork(const network_address_t &systemAddress) const override;
+};
+
+///====================================================
+/// In-process network that routes datagrams between network_application_t
+/// instances by network_address_t, no socket and no syscall involved.
+/// Lets one process run a server against thousands of simulated clients
+/// for scaling and profiling without kernel cpu hiding our own hot spots.
+/// 1. put it into socket_binding_params_t::virtualNetwork before Startup(),
+///     every socket of that app then lives on this network only
+/// 2. port 0 gets the next free port, host left empty means 127.0.0.1
+/// 3. datagram to an address nobody is bound to is dropped like real udp
+/// 4. virtual sockets have no fd, so they need recv threads or
+///     USE_SINGLE_THREAD, not GECO_USE_EPOLL_REACTOR
+/// 5. thread safe, must outlive every app attached to it
+///=======================================================
+class GECO_EXPORT virtual_network_t
+{
+    private:
+    JackieSimpleMutex endpointsMutex;
+    JackieArrayList<virtual_transceiver_t*> endpoints[GECO_VIRTUAL_NETWORK_BUCKETS];
+    uint endpointsSize;
+    ushort nextPort;
+
+    uint datagramsDelivered;
+    uint datagramsDropped;
+
+    virtual_transceiver_t* Find(const network_address_t &address) const;
+
+    public:
+    virtual_network_t();
+    ~virtual_network_t();
+
+    /// returns 0 if @address is already taken or no port is left,
+    /// @address has its port filled when it was 0
+    virtual_transceiver_t* Attach(network_address_t &address, bool isNonBlocking);
+    void Detach(virtual_transceiver_t *endpoint);
+
+    /// copies @data into the inbox of the endpoint bound to @receiver,
+    /// returns @length like sendto() even when datagram is dropped
+    int Route(const network_address_t &sender, const char *data, int length,
+        const network_address_t &receiver);
+    bool Contains(const network_address_t &address);
+
+    inline uint GetEndpointsSize(void) const { return endpointsSize; }
+    inline uint GetDatagramsDelivered(void) const { return datagramsDelivered; }
+    inline uint GetDatagramsDropped(void) const { return datagramsDropped; }
+};
+GECO_NET_END_NSPACE
+#endif
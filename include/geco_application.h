@@ -73,6 +73,7 @@
 #include "JackieArrayList.h"
 #include "JackieSPSCQueue.h"
 #include "JackieMemoryPool.h"
+#include "JackieBytesRing.h"
 #include "geco-random-seed-creator.h"
 #include "network_socket_t.h"
 #if ENABLE_SECURE_HAND_SHAKE == 1
@@ -86,6 +87,7 @@ GECO_NET_BEGIN_NSPACE
 
 JACKIE_THREAD_DECLARATION(RunNetworkUpdateCycleLoop);
 JACKIE_THREAD_DECLARATION(RunRecvCycleLoop);
+JACKIE_THREAD_DECLARATION(RunReactorCycleLoop);
 JACKIE_THREAD_DECLARATION(UDTConnect);
 
 struct network_plugin_t;
@@ -106,6 +108,8 @@ class GECO_EXPORT network_application_t  //: public IServerApplication
     geco_bit_stream_t sendBitStream;
 
     guid_t myGuid;
+    /// sent in the handshake to tell same host systems, 0 if unknown
+    ulonglong myHostId;
     network_address_t localIPAddrs[MAX_COUNT_LOCAL_IP_ADDR];
     network_address_t firstExternalID;
 
@@ -140,11 +144,37 @@ class GECO_EXPORT network_application_t  //: public IServerApplication
     /// Use a hash, with binaryAddress plus port mod length as the index
     JackieRemoteIndex **remoteSystemLookup;
 
+    /// path mtu confirmed by the latest connection to each destination prefix,
+    /// direct mapped by hash of the prefix, only touched by network thread.
+    /// new connections to the same network start their handshake and search at it
+    struct path_mtu_cache_t
+    {
+        network_address_t prefix;
+        ushort mtu; /// 0 if the slot is empty
+        TimeMS updateTime;
+    };
+    path_mtu_cache_t pathMtuCache[GECO_PLPMTUD_CACHE_SIZE];
+
+    /// last sequence of UNRELIABLE_SEQUENCED multicast data seen per sender and group,
+    /// direct mapped by hash of both, only touched by network thread
+    struct multicast_sender_t
+    {
+        guid_t guid; /// JACKIE_NULL_GUID if the slot is empty
+        network_address_t group;
+        uint sequence;
+    };
+    multicast_sender_t multicastSenders[GECO_MULTICAST_SENDERS_SIZE];
+    /// stamped on every multicast datagram we send, only touched by network thread
+    uint multicastSequence;
+
     public:
     bool(*recvHandler)(recv_params_t*);
     void(*userUpdateThreadPtr)(network_application_t *, void *);
     void *userUpdateThreadData;
     bool(*incomeDatagramEventHandler)(recv_params_t *);
+    /// gives every new connection its own congestion control, 0 keeps the default.
+    /// what it returns must come from OP_NEW, the connection frees it
+    congestion_controller_t*(*congestionControllerFactory)(const guid_t&, const network_address_t&);
 
     public:
     /// temporary variables used in IsOfflineRecvParams() in this class
@@ -206,6 +236,38 @@ class GECO_EXPORT network_application_t  //: public IServerApplication
     /// in Multi-threads app, used only by recv thread to alloc and dealloc JISRecvParams
     /// via anpothe
     JackieMemoryPool<recv_params_t>* JISRecvParamsPool;
+    /// per socket pool of coalesced gro buffers, only touched by recv thread
+    JackieMemoryPool<recv_gro_buffer_t, 8, 2>* JISGROBufferPool;
+    /// per socket ring the bytes of received datagrams are packed into, only touched by
+    /// recv thread. network thread just reads them until the params come back
+    JackieBytesRing<GECO_RECV_RING_SIZE>* JISRecvBufferRing;
+#if GECO_ENABLE_PEER_SOCKETS == 1
+    /// connected sockets opened by OpenPeerSocket(), per index of the shared socket they
+    /// sit next to. network thread adds and removes them, recv thread copies them out,
+    /// both under @mutex. @size mirrors sockets.Size() so recv thread can peek without locking.
+    /// a removed socket waits in @retired, only touched by network thread, until recv thread
+    /// echoes @retiredCount of its removal in @retiredSeen and its recv params are processed
+    struct retired_peer_t
+    {
+        berkley_socket_t* sock;
+        uint seq;
+    };
+    struct peer_sockets_t
+    {
+        JackieSimpleMutex mutex;
+        JackieArrayList<berkley_socket_t*, 8> sockets;
+        volatile uint size;
+        volatile uint retiredCount;
+        volatile uint retiredSeen;
+        JackieArrayList<retired_peer_t, 8> retired;
+        peer_sockets_t() : size(0), retiredCount(0), retiredSeen(0) { }
+    };
+    peer_sockets_t* JISPeerSockets;
+#endif
+    /// bumped whenever a socket with an fd comes or goes, or changes its fd, after startup()
+    volatile uint pollFdsVersion;
+    /// socket poll_once() reads first, moves on by one every call
+    uint pollOnceIndex;
     //MemoryPool<JISRecvParams, 512, 8> JISRecvParamsPool;
     JackieMemoryPool<cmd_t> commandPool;
 
@@ -285,6 +347,14 @@ class GECO_EXPORT network_application_t  //: public IServerApplication
     void ClearSocketQueryOutputs(void);
     void ClearAllRecvParamsQs(void);
 
+    /// per socket setup after a successful bind
+    void InitBindedSocket(berkley_socket_t* sock, uint userIndex);
+    /// bind the other @bindLocalSocket.reusePortSockets - 1 sockets of a SO_REUSEPORT
+    /// group on the port @first got, all of them share @userIndex
+    bool BindReusePortGroup(berkley_socket_t* first,
+        berkley_socket_binding_params_t* berkleyBindParams,
+        const socket_binding_params_t& bindLocalSocket, uint userIndex);
+
     void ProcessOneRecvParam(recv_params_t* recvParams);
     void IsOfflineRecvParams(recv_params_t* recvParams,
         bool* isOfflinerecvParams);
@@ -295,6 +365,29 @@ class GECO_EXPORT network_application_t  //: public IServerApplication
     void ProcessConnectionRequestQ(TimeUS& timeUS, TimeMS& timeMS);	/// @Done
     void AdjustTimestamp(network_packet_t*& incomePacket) const;
 
+    /// Only called by network update thread. Datagrams sent by SendBatched() are
+    /// gathered per socket and go out with one syscall in FlushAllEgressBatches() at the
+    /// end of RunNetworkUpdateCycleOnce(), OnDirectSocketSend() is called for each
+    /// of them once it has been written
+    void SendBatched(network_socket_t* sock, send_params_t* sendParams);
+    /// SendBatched() to @rs on its socket2use, stamped with the departure time its
+    /// transport_layer_t paces it to when the socket has SO_TXTIME on
+    void SendPaced(remote_system_t* rs, send_params_t* sendParams);
+    void FlushEgressBatch(berkley_socket_t* sock);
+    void FlushAllEgressBatches(void);
+
+    /// packetization layer path mtu discovery, only called by network update thread.
+    /// UpdatePathMtu() binary searches between remote_system_t::MTUSize and
+    /// MAXIMUM_MTU_SIZE with padded probes, one in flight per remote system
+    void ResetPathMtu(remote_system_t* rs, TimeMS timeMS);
+    void UpdatePathMtu(TimeMS timeMS);
+    /// datagrams above the handshake size keep timing out, fall back to it and search again
+    void OnPathMtuBlackHole(remote_system_t* rs, TimeMS timeMS);
+    void SendPathMtuProbe(remote_system_t* rs, ushort size);
+    /// returns 0 if nothing is cached for the prefix of @addr or it has expired
+    ushort GetCachedPathMtu(const network_address_t& addr, TimeMS timeMS) const;
+    void CachePathMtu(const network_address_t& addr, ushort mtu, TimeMS timeMS);
+
     /// In multi-threads app and single- thread app,these 3 functions
     /// are called only  by recv thread. the recvStruct will be obtained from 
     /// bufferedDeallocatedRecvParamQueue, so it is thread safe
@@ -302,6 +395,36 @@ class GECO_EXPORT network_application_t  //: public IServerApplication
     void ReclaimOneJISRecvParams(recv_params_t *s, uint index);
     void ReclaimAllJISRecvParams(uint deAlloclJISRecvParamsQIndex);
     recv_params_t * AllocJISRecvParams(uint deAlloclJISRecvParamsQIndex);
+    /// give @s back to pool, and its gro buffer as well if @s is the last one using it
+    void ReclaimJISRecvParamsToPool(recv_params_t *s, uint index);
+    /// push filled recv params to allocRecvParamQ[index] and wake up network thread
+    void PushJISRecvParams(recv_params_t** recvParams, int count, uint index);
+    /// read one batch from @sock into the recv params of index, returns the number queued
+    int RecvJISRecvParams(berkley_socket_t* sock, uint index);
+    /// only called by recv thread, @sock of index polls on another fd now, see uring_socket_t
+    void OnPollFdChanged(berkley_socket_t* sock, uint index);
+    /// recv with UDP_GRO and split every coalesced buffer into per-datagram recv params
+    int RecvJISRecvParamsGRO(berkley_socket_t* sock, uint index);
+#if GECO_ENABLE_PEER_SOCKETS == 1
+    /// read the shared socket of index and every connected socket next to it
+    int RecvPeerSockets(uint index);
+    /// only called by network update thread. open a connect()ed socket on the port of
+    /// @rs->socket2use and send through it from now on, false if it is not possible
+    bool OpenPeerSocket(remote_system_t* rs);
+    void ClosePeerSocket(remote_system_t* rs);
+    /// only called by recv thread between two reads, nothing it copied out before is in use
+    void AckRetiredPeerSockets(uint index);
+    /// only called by network update thread. free closed peers recv thread is done with,
+    /// all of them if @force, i.e. recv thread is gone
+    void FreeRetiredPeerSockets(uint index, bool force);
+#if GECO_ENABLE_SHM_TRANSPORT == 1
+    /// only called by network update thread. move a sameHost @rs onto a shm channel
+    /// sitting in the peer sockets, ClosePeerSocket() closes it, false if it is not possible
+    bool OpenShmChannel(remote_system_t* rs);
+    /// read up to a batch from the ring of @sock, it has no fd to poll
+    int RecvShmChannel(berkley_socket_t* sock, uint index);
+#endif
+#endif
 
     /// send thread will push trail this packet to buffered alloc queue in multi-threads env
     /// for the furture use of recv thread by popout
@@ -315,7 +438,17 @@ class GECO_EXPORT network_application_t  //: public IServerApplication
 
     public:
     void RunNetworkUpdateCycleOnce(void);
-    void RunRecvCycleOnce(uint in = 0);
+    /// returns the number of datagrams queued to allocRecvParamQ[in], 0 if nothing was read
+    int RunRecvCycleOnce(uint in = 0);
+#if GECO_USE_EPOLL_REACTOR == 1
+    /// wait up to @timeoutMS on all binded sockets and read the ready ones, at most
+    /// GECO_REACTOR_CYCLES_PER_WAKEUP cycles each. sockets that still have datagrams are
+    /// requeued and read next call without waiting. returns the number of ready sockets
+    int RunReactorCycleOnce(int timeoutMS);
+    /// kick reactor thread out of epoll_wait() to pick up what network thread changed,
+    /// closed peer sockets and stopping
+    void WakeupReactor(void);
+#endif
     network_packet_t* RunGetPacketCycleOnce(void);
 
     /// function  CreateRecvPollingThread 
@@ -327,6 +460,19 @@ class GECO_EXPORT network_application_t  //: public IServerApplication
     /// author mengdi[Jackie]
     int CreateRecvPollingThread(int threadPriority, uint index);
     int CreateNetworkUpdateThread(int threadPriority);
+#if GECO_USE_EPOLL_REACTOR == 1
+    int CreateReactorThread(int threadPriority);
+    void CloseReactor(void);
+    /// runs up to GECO_REACTOR_CYCLES_PER_WAKEUP recv cycles on @index,
+    /// requeues it if it is not drained by then
+    void RunReactorRecvCycles(uint index);
+    /// epoll instance watching all binded sockets plus @reactorWakeupFd
+    int reactorEpollFd;
+    /// eventfd written by WakeupReactor()
+    int reactorWakeupFd;
+    /// edge triggered sockets not drained in their turn, only touched by reactor thread
+    JackieArraryQueue<uint> reactorPendingQ;
+#endif
 
     void PacketGoThroughPluginCBs(network_packet_t*& incomePacket);
     void PacketGoThroughPlugins(network_packet_t*& incomePacket);
@@ -344,6 +490,30 @@ class GECO_EXPORT network_application_t  //: public IServerApplication
     void ResetSendReceipt(void);
     network_packet_t* fetch_packet(void);
 
+#if USE_SINGLE_THREAD != 0
+    //////////////////////////////////////////////////////////////////////////
+    /// Embed the app into your own reactor, no thread and no sleep of ours:
+    /// 1. after startup(), wait for read on every fd of get_poll_fds() and fetch
+    ///     them again whenever get_poll_fds_version() changes, peer sockets come and go
+    /// 2. never wait longer than next_deadline_ms()
+    /// 3. on any readiness or timeout call poll_once(), then RunGetPacketCycleOnce()
+    ///     until it returns 0
+    /// sockets are always non-blocking in single thread mode, none of these blocks
+    //////////////////////////////////////////////////////////////////////////
+    /// fills up to @size fds and returns how many there are, a bigger return asks for a
+    /// bigger @fds. virtual and shm sockets have no fd, next_deadline_ms() covers them
+    uint get_poll_fds(socket_fd_t* fds, uint size) const;
+    uint get_poll_fds_version(void) const { return pollFdsVersion; }
+    /// ms until network update has something due, 0 if it has right now.
+    /// never more than GECO_EVENT_LOOP_MAX_WAIT_MS
+    TimeMS next_deadline_ms(void);
+    /// read every ready socket until it is drained or @budget datagrams are read, then
+    /// process them and due timers. sockets take turns one recv batch at a time, so a busy
+    /// one can not use up the budget of the others. returns datagrams read, equal to
+    /// @budget means some may be left in kernel, so an edge-triggered caller must call it again
+    int poll_once(uint budget = GECO_POLL_ONCE_BUDGET);
+#endif
+
     virtual startup_result_t startup(socket_binding_params_t *socketDescriptors,
         uint maxConnections = 8, uint socketDescriptorCount = 1,
         int threadPriority = -99999);
@@ -368,6 +538,8 @@ class GECO_EXPORT network_application_t  //: public IServerApplication
     uint set_sleep_time() const { return userThreadSleepTime; }
     void set_sleep_time(uint val) { userThreadSleepTime = val; }
     /// to check if this is loop back address of local host
+    /// @hostId is what @systemAddress sent in the handshake
+    bool IsSameHost(const network_address_t& systemAddress, ulonglong hostId) const;
     bool IsLoopbackAddress(const guid_address_wrapper_t &systemIdentifier,
         bool matchPort) const;
 
@@ -448,6 +620,21 @@ class GECO_EXPORT network_application_t  //: public IServerApplication
     /// a public key from connecting clients as a proof of identity but eats twice as much CPU time as a normal connection
     bool enable_secure_inbound_connections(cat::TunnelKeyPair& key_pair, bool requireClientPublicKey);
 
+    /// @Brief multicast fan-out for servers on one LAN segment, one datagram reaches
+    /// every member of a group instead of one copy per remote system
+    /// 1. JoinMulticastGroup() makes the sockets of user connection socket index @socketIndex
+    ///     members of @group, they must be bound to the port of @group. call them after startup()
+    /// 2. SendMulticast() posts a copy of @data for network thread to send to @group,
+    ///     @reliability is UNRELIABLE_NOT_ACK_RECEIPT_OF_PACKET or
+    ///     UNRELIABLE_SEQUENCED_NOT_ACK_RECEIPT_OF_PACKET, nothing is resent
+    /// 3. members receive it as a normal network_packet_t tagged with the sender's guid,
+    ///     sequenced data older than the latest from the same sender and group is dropped,
+    ///     so is data not sent to a group the receiving socket has joined
+    bool JoinMulticastGroup(const network_address_t& group, uint socketIndex = 0);
+    bool LeaveMulticastGroup(const network_address_t& group, uint socketIndex = 0);
+    bool SendMulticast(const char *data, uint length, packet_reliability_t reliability,
+        const network_address_t& group, uint socketIndex = 0);
+
     /// recv thread will push tail this packet to buffered dealloc queue in multi-threads env
     void reclaim_packet(network_packet_t *packet);
     /// only recv thread will take charge of alloc packet in multi-threads env
@@ -575,11 +762,23 @@ class GECO_EXPORT network_application_t  //: public IServerApplication
         bool* isOfflinerecvParams);
     void OnConnectionReply2(recv_params_t* recvParams,
         bool* isOfflinerecvParams);
+    void OnPathMtuProbe(recv_params_t* recvParams,
+        bool* isOfflinerecvParams);
+    void OnPathMtuProbeReply(recv_params_t* recvParams,
+        bool* isOfflinerecvParams);
+    void OnMulticastData(recv_params_t* recvParams,
+        bool* isOfflinerecvParams);
+    void SendMulticastNow(cmd_t* cmd);
+    /// first binded socket of user connection socket index @userIndex, SO_REUSEPORT
+    /// fan-out gives one index several sockets. 0 if there is none
+    network_socket_t* GetBindedSocket(uint userIndex) const;
 
     public:
     friend JACKIE_THREAD_DECLARATION(RunNetworkUpdateCycleLoop);
     friend JACKIE_THREAD_DECLARATION(RunRecvCycleLoop);
+    friend JACKIE_THREAD_DECLARATION(RunReactorCycleLoop);
     friend JACKIE_THREAD_DECLARATION(UDTConnect);
+    friend class transport_layer_t;
 };
 
 GECO_NET_END_NSPACE
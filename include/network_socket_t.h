@@ -9,6 +9,7 @@
 #include "geco-globals.h" // only for JackieSleep() global function
 #include "geco-malloc-interface.h"
 #include "geco-net-config.h"
+#include "JackieSimpleMutex.h"
 #include <cassert>
 
 // #define TEST_NATIVE_CLIENT_ON_WINDOWS
@@ -22,6 +23,9 @@ GECO_NET_BEGIN_NSPACE
 /// JIS is short name for GECO_INet_Socket 
 class  network_socket_t;
 class network_application_t;
+class virtual_network_t;
+class shm_transceiver_t;
+class unix_transceiver_t;
 
 typedef int socket_fd_t;
 typedef int send_result_t;
@@ -44,7 +48,17 @@ enum  network_socket_type_t
     JISType_XBOX_360,
     JISType_XBOX_720,
     JISType_WINDOWS,
-    JISType_LINUX
+    JISType_LINUX,
+    JISType_LINUX_IO_URING
+};
+
+/// ECN field, the low 2 bits of ipv4 TOS and ipv6 traffic class (RFC 3168)
+enum  ecn_codepoint_t
+{
+    ECN_NOT_ECT = 0,
+    ECN_ECT1,
+    ECN_ECT0,
+    ECN_CE
 };
 
 GECO_EXPORT extern const char* network_socket_type_to_str(network_socket_type_t reason);
@@ -57,6 +71,15 @@ struct GECO_EXPORT send_params_t
     send_result_t bytesWritten; // use 0 to init
     network_address_t receiverINetAddress;
     int ttl;
+    /// local addr datagram leaves from, only honoured by a wildcard socket with
+    /// pktinfo enabled. JACKIE_NULL_ADDRESS lets kernel pick it by routing table
+    network_address_t senderINetAddress;
+    /// departure time in Get64BitsTimeUS() clock, only honoured by a socket with
+    /// EnableTxTime(). 0 sends it straight away
+    TimeUS txTime;
+
+    send_params_t() : data(0), length(0), bytesWritten(0), ttl(0),
+        senderINetAddress(JACKIE_NULL_ADDRESS), txTime(0) { }
 };
 
 struct GECO_EXPORT reliable_send_params_t
@@ -74,13 +97,34 @@ struct GECO_EXPORT reliable_send_params_t
     ushort mtu;
 };
 
+/// one buffer kernel has coalesced several same-flow datagrams into (UDP_GRO),
+/// shared by the recv params of its segments and given back to pool by recv thread
+/// once the last of them is reclaimed
+struct GECO_EXPORT recv_gro_buffer_t
+{
+    char data[GECO_GRO_BUFFER_SIZE];
+    int refCount;
+};
+
+/// slim descriptor of one received datagram, the bytes live elsewhere
 struct GECO_EXPORT recv_params_t
 {
-    char data[MAXIMUM_MTU_SIZE];
+    /// points at a record in the recv buffer ring of @localBoundSocket, or at one
+    /// segment inside @groBuffer when kernel handed us several datagrams in one go.
+    /// never owns the memory
+    char *data;
     recv_result_t bytesRead;
     network_address_t senderINetAddress;
+    /// local addr datagram was sent to, learnt from pktinfo on a wildcard socket,
+    /// otherwise JACKIE_NULL_ADDRESS. reply with it as send_params_t::senderINetAddress
+    network_address_t receiverINetAddress;
     TimeUS timeRead;
     network_socket_t *localBoundSocket;
+    recv_gro_buffer_t *groBuffer;
+    /// size of each datagram in @groBuffer kernel reported, 0 if not coalesced
+    int groSegmentSize;
+    /// ecn_codepoint_t of the ip header, ECN_NOT_ECT unless socket has EnableEcn()
+    uchar ecn;
 };
 
 class GECO_EXPORT event_handler_t
@@ -105,9 +149,12 @@ class GECO_EXPORT network_socket_t
     network_address_t boundAddress;
     unsigned int userConnectionSocketIndex;
     network_socket_type_t socketType;
+    /// biggest datagram this socket sends or receives, MAXIMUM_MTU_SIZE unless
+    /// bound with a bigger berkley_socket_binding_params_t::maxMTUSize
+    ushort maxMTUSize;
 
     public:
-    network_socket_t() : eventHandler(0) { }
+    network_socket_t() : eventHandler(0), maxMTUSize(MAXIMUM_MTU_SIZE) { }
     virtual ~network_socket_t() { }
 
     virtual  send_result_t Send(send_params_t *sendParameters,
@@ -125,6 +172,7 @@ class GECO_EXPORT network_socket_t
     inline void SetUserConnectionSocketIndex(unsigned int i) { userConnectionSocketIndex = i; }
 
     inline network_address_t GetBoundAddress(void) const { return boundAddress; }
+    inline ushort GetMaxMTUSize(void) const { return maxMTUSize; }
 
     inline bool IsBerkleySocket(void) const
     {
@@ -161,6 +209,10 @@ struct GECO_EXPORT berkley_socket_binding_params_t
     int pollingThreadPriority;
     network_application_t *eventHandler;
     unsigned short remotePortJackieNetWasStartedOn_PS3_PS4_PSP2;
+    bool reusePort; // SO_REUSEPORT, skips the send-recv test in BindShared()
+    bool connectedPeers; // let OpenPeerSocket() connect() siblings on this port, needs reusePort
+    bool recvPrefilter; // AttachRecvPrefilter() once bound
+    unsigned short maxMTUSize; // 0 is MAXIMUM_MTU_SIZE, capped to GECO_MAX_JUMBO_MTU_SIZE
 };
 
 class GECO_EXPORT transceiver_t
@@ -176,8 +228,9 @@ class GECO_EXPORT transceiver_t
     /// Called when RecvFrom would otherwise occur. 
     /// Return number of bytes read and Write data into dataOut
     /// Return -1 to use JackieNet's normal recvfrom, 0 to abort JackieNet's normal 
-    /// recvfrom,and positive to return data
-    virtual int JackieINetRecvFrom(char dataOut[MAXIMUM_MTU_SIZE], network_address_t *senderOut, bool calledFromMainThread) = 0;
+    /// recvfrom,and positive to return data. never writes more than @capacity bytes,
+    /// a bigger datagram is dropped
+    virtual int JackieINetRecvFrom(char *dataOut, int capacity, network_address_t *senderOut, bool calledFromMainThread) = 0;
 
     /// RakNet needs to know whether an address is a dummy override address, 
     /// so it won't be added as an external addresses
@@ -190,9 +243,84 @@ class GECO_EXPORT berkley_socket_t : public network_socket_t
 
     berkley_socket_binding_params_t binding;
     transceiver_t *jst;
+    /// set by BindVirtual(), jst is then an endpoint of it owned by this socket
+    virtual_network_t *virtualNetwork;
+#if GECO_ENABLE_SHM_TRANSPORT == 1
+    /// set by BindShm(), jst is then this channel owned by this socket
+    shm_transceiver_t *shmChannel;
+#endif
+#if GECO_ENABLE_UNIX_SOCKETS == 1
+    /// set by BindUnix(), jst is then this endpoint owned by this socket and
+    /// rns2Socket mirrors its fd for poll() and epoll
+    unix_transceiver_t *unixTransceiver;
+#endif
     atomic_long_t isRecvFromLoopThreadActive;
 
     socket_fd_t rns2Socket;
+    /// set to false at the first ENOSYS from recvmmsg() so we stop trying it
+    bool isRecvBatchSupported;
+    /// set to false at the first ENOSYS from sendmmsg() so we stop trying it
+    bool isSendBatchSupported;
+
+    /// egress batch filled by QueueSend() and sent by FlushQueuedSends(),
+    /// data is copied in because callers usually write into a stack bitstream.
+    /// GECO_SEND_BATCH_SIZE of them, allocated at the first QueueSend() so
+    /// sockets that never batch, per-peer and shm ones, do not carry it
+    send_params_t *queuedSends;
+    /// room for GECO_SEND_BATCH_SIZE datagrams of maxMTUSize bytes, allocated with
+    /// queuedSends and dropped by SetMaxMTUSize() for the next one to size it again.
+    /// payloads are packed back to back, a run of them to one receiver is one gso buffer
+    char *queuedSendsData;
+    int queuedSendsSize;
+    int queuedSendsBytes;
+
+    /// UDP_SEGMENT and MSG_ZEROCOPY states used by SendSegmented()
+    bool isGSOSupported;
+    bool isZeroCopyEnabled;
+    uint zeroCopyIssued;
+    uint zeroCopyCompleted;
+
+    /// set by EnableGRO() once kernel accepts UDP_GRO
+    bool isGROEnabled;
+    /// set by EnableRecvTimestamps() once kernel accepts SO_TIMESTAMPNS
+    bool isRecvTimestampEnabled;
+    /// set by EnablePktInfo() once kernel accepts IP_PKTINFO or IPV6_RECVPKTINFO
+    bool isPktInfoEnabled;
+
+    /// SO_RXQ_OVFL states, @kernelDropped is the counter of the latest datagram
+    bool isRxqOvflEnabled;
+    uint kernelDropped;
+    /// set by EnablePathMtuProbe() once kernel accepts IP_PMTUDISC_PROBE
+    bool isPathMtuProbeEnabled;
+    /// set by EnableEcn() once kernel accepts both ECT(0) marking and IP_RECVTOS
+    bool isEcnEnabled;
+    /// set by EnableTxTime() once kernel accepts SO_TXTIME
+    bool isTxTimeEnabled;
+    /// set by ConnectTo(), JACKIE_NULL_ADDRESS if not connected
+    network_address_t connectedAddress;
+    /// adaptive SO_RCVBUF states used by AdjustRecvBufSize(), @recvBufSize is
+    /// what kernel reports after bind and every resize
+    int recvBufSize;
+    uint kernelDroppedAtLastAdjust;
+    uint quietAdjustIntervals;
+    TimeMS nextAdjustTime;
+    /// drops at the cap are reported once, until it shrinks again
+    bool isRecvBufAtMax;
+
+    /// SO_RCVBUF kernel really gives, 0 if it can not be read
+    int GetKernelRecvBufSize(void) const;
+    /// groups joined by JoinMulticastGroup(), user thread changes them and
+    /// network thread checks them in IsMulticastMember()
+    network_address_t multicastGroups[GECO_MULTICAST_GROUPS_SIZE];
+    uint multicastGroupsSize;
+    mutable JackieSimpleMutex multicastGroupsMutex;
+    bool SetMulticastMembership(const network_address_t& group, bool join);
+    /// queued datagrams [@first, @last) by sendmmsg() where available, one by one otherwise
+    int SendQueuedBatch(int first, int last, const char *file, unsigned int line);
+    /// number of datagrams from @first on that SendSegmented() can take as one buffer,
+    /// same receiver and size, only the last may be shorter. 1 if there is no run
+    int GetQueuedRunSize(int first) const;
+    int SendQueuedRun(int first, int count, const char *file, unsigned int line);
 #if defined(__APPLE__)
     // http://sourceforge.net/p/open-dis/discussion/683284/thread/0929d6a0
     CFSocketRef             _cfSocket;
@@ -204,6 +332,8 @@ class GECO_EXPORT berkley_socket_t : public network_socket_t
 
     const berkley_socket_binding_params_t *GetBindingParams(void) const { return &binding; }
     inline socket_fd_t GetSocket(void) const { return rns2Socket; }
+    /// fd that turns readable when RecvFromBatch() has something, what a reactor waits on
+    virtual socket_fd_t GetPollFd(void) const { return rns2Socket; }
 
     inline void SetSocketTransceiver(transceiver_t *jst_) { this->jst = jst_; }
     inline transceiver_t* GetSocketTransceiver(void) const { return this->jst; }
@@ -218,6 +348,38 @@ class GECO_EXPORT berkley_socket_t : public network_socket_t
     socket_binding_result_t BindSharedIPV4(berkley_socket_binding_params_t *bindParameters, const char *file, unsigned int line);
     socket_binding_result_t BindSharedIPV4And6(berkley_socket_binding_params_t *bindParameters, const char *file, unsigned int line);
 
+    //////////////////////////////////////////////////////////////////////////
+    /// 1. no kernel socket at all, attach to @network as hostAddress:port
+    ///     and send and receive through that endpoint as jst
+    /// 2. port 0 gets the next free virtual port, empty host means 127.0.0.1
+    /// 3. returns JISBindResult_FAILED_BIND_SOCKET if the address is taken
+    //////////////////////////////////////////////////////////////////////////
+    socket_binding_result_t BindVirtual(virtual_network_t *network, berkley_socket_binding_params_t *bindParameters);
+    inline bool IsVirtual(void) const { return virtualNetwork != 0; }
+
+#if GECO_ENABLE_UNIX_SOCKETS == 1
+    //////////////////////////////////////////////////////////////////////////
+    /// 1. AF_UNIX SOCK_DGRAM socket at @dir/port instead of udp, sends and
+    ///     receives through it as jst, see unix_transceiver_t
+    /// 2. port 0 gets the first free one from GECO_UNIX_SOCKET_FIRST_PORT,
+    ///     bound address is always GECO_UNIX_SOCKET_HOST:port
+    /// 3. returns JISBindResult_FAILED_BIND_SOCKET if the path is taken
+    //////////////////////////////////////////////////////////////////////////
+    socket_binding_result_t BindUnix(const char *dir, berkley_socket_binding_params_t *bindParameters);
+    inline bool IsUnix(void) const { return unixTransceiver != 0; }
+#endif
+
+#if GECO_ENABLE_SHM_TRANSPORT == 1
+    //////////////////////////////////////////////////////////////////////////
+    /// 1. no kernel socket either, send and receive through the opened @channel as jst,
+    ///     this socket owns it from now on and closes it in dtor
+    /// 2. takes bound address, binding params and max mtu of @shared, which @channel
+    ///     falls back on and rings the doorbell through
+    //////////////////////////////////////////////////////////////////////////
+    socket_binding_result_t BindShm(shm_transceiver_t *channel, berkley_socket_t *shared);
+    inline shm_transceiver_t* GetShmChannel(void) const { return shmChannel; }
+#endif
+
     //////////////////////////////////////////////////////////////////////////
     /// 1. Used internally in @mtd JISBindResult Bind(...)
     /// 2. set nonblocking to 0 = blocking-socket; 
@@ -283,8 +445,86 @@ class GECO_EXPORT berkley_socket_t : public network_socket_t
         /// this assert always fail maybe need admin permission
         /// assert(val == 0);
     }
+    inline void SetReusePort(int reusePort)
+    {
+#if defined(SO_REUSEPORT) && !defined(_WIN32)
+        if (reusePort == 0) return;
+        int val = setsockopt__(rns2Socket, SOL_SOCKET, SO_REUSEPORT,
+            (char*)&reusePort, sizeof(reusePort));
+        assert(val == 0);
+#endif
+    }
+    //////////////////////////////////////////////////////////////////////////
+    /// 1. attach a reuseport CBPF program to the group this socket belongs to,
+    ///     it picks socket (saddr ^ sport) % @groupSize, so one client sticks to one socket
+    /// 2. only useful with SO_REUSEPORT, call it once on any socket of the group after
+    ///     all @groupSize sockets are bound
+    //////////////////////////////////////////////////////////////////////////
+    bool AttachReusePortCBPF(uint groupSize);
+    //////////////////////////////////////////////////////////////////////////
+    /// 1. attach a SO_ATTACH_FILTER program that keeps a datagram only if it is
+    ///     ID_RECV_WAKEUP, connected data (isValid bit set) or an offline message id
+    ///     IsOfflineRecvParams() knows with @offlineMessageDataId at its offset
+    /// 2. anything else, including datagrams too short to hold that, is dropped in kernel
+    //////////////////////////////////////////////////////////////////////////
+    bool AttachRecvPrefilter(const uchar offlineMessageDataId[16]);
+    //////////////////////////////////////////////////////////////////////////
+    /// 1. set DF on every datagram and ignore kernel's cached path mtu (IP_PMTUDISC_PROBE),
+    ///     so handshake padding and path mtu probes bigger than the path are lost
+    ///     instead of being fragmented, and nothing toggles DF around single sends
+    /// 2. sends bigger than local interface mtu fail with EMSGSIZE straight away
+    /// 3. SetDoNotFragment() is a no-op once it succeeds
+    //////////////////////////////////////////////////////////////////////////
+    bool EnablePathMtuProbe(void);
+
+    //////////////////////////////////////////////////////////////////////////
+    /// 1. mark every datagram ECT(0) (IP_TOS / IPV6_TCLASS) so ECN capable switches
+    ///     set CE instead of dropping when their queues build up
+    /// 2. recvmmsg() and io_uring paths fill recv_params_t::ecn from IP_RECVTOS /
+    ///     IPV6_RECVTCLASS, transport_layer_t counts CE marks and echoes them in acks
+    //////////////////////////////////////////////////////////////////////////
+    bool EnableEcn(void);
+    inline bool IsEcnEnabled(void) const { return isEcnEnabled; }
+
+    //////////////////////////////////////////////////////////////////////////
+    /// 1. turn SO_TXTIME on (CLOCK_MONOTONIC), every send path then attaches
+    ///     send_params_t::txTime as SCM_TXTIME and fq qdisc holds the datagram till then
+    /// 2. datagrams with txTime 0 are not stamped and leave straight away
+    //////////////////////////////////////////////////////////////////////////
+    bool EnableTxTime(void);
+    inline bool IsTxTimeEnabled(void) const { return isTxTimeEnabled; }
+
+    //////////////////////////////////////////////////////////////////////////
+    /// 1. join or leave multicast @group (IP_ADD_MEMBERSHIP / IPV6_JOIN_GROUP) on the
+    ///     interface this socket is bound to, any interface for a wildcard socket
+    /// 2. datagrams to @group only reach sockets bound to the port of @group
+    /// 3. at most GECO_MULTICAST_GROUPS_SIZE groups, IsMulticastMember() tells
+    ///     whether @addr (port ignored) is one of them
+    //////////////////////////////////////////////////////////////////////////
+    bool JoinMulticastGroup(const network_address_t& group);
+    bool LeaveMulticastGroup(const network_address_t& group);
+    bool IsMulticastMember(const network_address_t& addr) const;
+
+    //////////////////////////////////////////////////////////////////////////
+    /// 1. resize the egress batch and every recv length to @mtu, 0 is MAXIMUM_MTU_SIZE
+    ///     and anything above GECO_MAX_JUMBO_MTU_SIZE is capped
+    /// 2. Bind() calls it with berkley_socket_binding_params_t::maxMTUSize, the
+    ///     egress batch must be empty
+    //////////////////////////////////////////////////////////////////////////
+    void SetMaxMTUSize(ushort mtu);
+
+    //////////////////////////////////////////////////////////////////////////
+    /// 1. connect() this socket to @peer, kernel looks the route up once and delivers
+    ///     datagrams from @peer to it ahead of unconnected sockets on the same port
+    /// 2. send paths then leave destination addr out, receiverINetAddress must be @peer
+    //////////////////////////////////////////////////////////////////////////
+    bool ConnectTo(const network_address_t& peer);
+    inline bool IsConnected(void) const { return connectedAddress != JACKIE_NULL_ADDRESS; }
+    inline const network_address_t& GetConnectedAddress(void) const { return connectedAddress; }
+    inline bool IsPathMtuProbeEnabled(void) const { return isPathMtuProbeEnabled; }
     inline void SetDoNotFragment(int opt)
     {
+        if (isPathMtuProbeEnabled) return;
 #if defined( IP_DONTFRAGMENT )
 #if defined(_WIN32) && !defined(_DEBUG)
         // If this assert hit you improperly linked against WSock32.h
@@ -307,6 +547,60 @@ class GECO_EXPORT berkley_socket_t : public network_socket_t
     recv_result_t RecvFromIPV4(recv_params_t *recvFromStruct);
     recv_result_t RecvFromIPV4And6(recv_params_t *recvFromStruct);
 
+    //////////////////////////////////////////////////////////////////////////
+    /// 1. fill up to @count recv params with one recvmmsg() call, @count <= GECO_RECV_BATCH_SIZE
+    /// 2. return value  > 0 - number of filled params, they are packed at the front of @recvFromStructs
+    ///     truncated or empty datagrams are dropped and their params moved behind the filled ones
+    /// 3. return value <= 0 - same meaning as RecvFrom(), nothing is filled
+    /// 4. falls back to one RecvFrom() when jst is set or recvmmsg() is not available
+    //////////////////////////////////////////////////////////////////////////
+    virtual int RecvFromBatch(recv_params_t **recvFromStructs, int count);
+
+    //////////////////////////////////////////////////////////////////////////
+    /// 1. with UDP_GRO on, fill the groBuffer of up to @count recv params with one recvmmsg() call,
+    ///     caller must have set @recvFromStructs[i]->groBuffer
+    /// 2. on return, data points at the whole coalesced buffer, bytesRead is its size and
+    ///     groSegmentSize the size of every datagram in it but the last (0 if not coalesced)
+    /// 3. return values are the same as RecvFromBatch(), filled params are packed at the front
+    //////////////////////////////////////////////////////////////////////////
+    int RecvFromGRO(recv_params_t **recvFromStructs, int count);
+    virtual bool EnableGRO(void);
+    inline bool IsGROEnabled(void) const { return isGROEnabled; }
+
+    //////////////////////////////////////////////////////////////////////////
+    /// 1. ask kernel to stamp every datagram on arrival (SO_TIMESTAMPNS)
+    /// 2. RecvFromBatch() and RecvFromGRO() then fill timeRead from that stamp,
+    ///     converted to Get64BitsTimeUS() base, so it no more includes the time
+    ///     datagram sat in socket buffer waiting for recv thread
+    //////////////////////////////////////////////////////////////////////////
+    bool EnableRecvTimestamps(void);
+    inline bool IsRecvTimestampEnabled(void) const { return isRecvTimestampEnabled; }
+
+    //////////////////////////////////////////////////////////////////////////
+    /// 1. only for a socket bound to INADDR_ANY or in6addr_any, does nothing otherwise
+    /// 2. recv paths then fill recv_params_t::receiverINetAddress with the local addr
+    ///     each datagram was sent to (IP_PKTINFO / IPV6_RECVPKTINFO)
+    /// 3. send paths set the source addr from send_params_t::senderINetAddress, so
+    ///     one socket replies from whichever local addr the peer talks to
+    //////////////////////////////////////////////////////////////////////////
+    bool EnablePktInfo(void);
+    inline bool IsPktInfoEnabled(void) const { return isPktInfoEnabled; }
+
+    //////////////////////////////////////////////////////////////////////////
+    /// 1. ask kernel to attach its per-socket drop counter to every datagram (SO_RXQ_OVFL)
+    /// 2. recvmmsg() and io_uring paths keep the latest one, GetKernelDropped() returns
+    ///     how many datagrams kernel has thrown away since then because buffer was full
+    /// 3. AdjustRecvBufSize() is called by recv thread, it doubles SO_RCVBUF up to
+    ///     GECO_SO_REVBUF_MAX_SIZE when new drops show up, and halves it down to
+    ///     GECO_SO_REVBUF_SIZE after GECO_SO_REVBUF_SHRINK_INTERVALS quiet intervals
+    //////////////////////////////////////////////////////////////////////////
+    bool EnableRxqOvfl(void);
+    inline bool IsRxqOvflEnabled(void) const { return isRxqOvflEnabled; }
+    inline uint GetKernelDropped(void) const { return kernelDropped; }
+    inline int GetRecvBufSize(void) const { return recvBufSize; }
+    void AdjustRecvBufSize(TimeMS now);
+    bool SetRecvBufSize(int size);
+
     //////////////////////////////////////////////////////////////////////////
     /// 1. send by jst if not null, otherwise by @mtd SendWithoutVDP(...)
     /// 2. Returns value is either > 0(send succeeds) or <0 (send error)
@@ -315,6 +609,43 @@ class GECO_EXPORT berkley_socket_t : public network_socket_t
     virtual send_result_t Send(send_params_t *sendParameters, const char *file, unsigned int line) override;
     send_result_t SendWithoutVDP(socket_fd_t rns2Socket, send_params_t *sendParameters, const char *file, unsigned int line);
 
+    //////////////////////////////////////////////////////////////////////////
+    /// 1. QueueSend() copies one datagram into egress batch, returns false when
+    ///     batch is full and caller has to FlushQueuedSends() first
+    /// 2. FlushQueuedSends() sends the whole batch with sendmmsg() where available, 
+    ///     returns the number of datagrams that have been written. runs of datagrams to
+    ///     one receiver go out by SendSegmented() in between, the queued order is kept
+    /// 3. after flush, every queued send params has bytesWritten > 0 if it was sent,
+    ///     otherwise bytesWritten < 0 (-errno when sendmmsg() tells us which one failed)
+    /// 4. caller must ClearQueuedSends() once it is done with the send results
+    /// 5. only one thread (network update thread) can touch the batch
+    //////////////////////////////////////////////////////////////////////////
+    bool QueueSend(const send_params_t *sendParameters);
+    virtual int FlushQueuedSends(const char *file, unsigned int line);
+    inline int GetQueuedSendsSize(void) const { return queuedSendsSize; }
+    inline send_params_t* GetQueuedSend(int index) { return &queuedSends[index]; }
+    inline void ClearQueuedSends(void) { queuedSendsSize = queuedSendsBytes = 0; }
+
+    //////////////////////////////////////////////////////////////////////////
+    /// 1. send @sendParameters->data to one receiver as datagrams of @segmentSize bytes,
+    ///     the last one can be shorter. returns total bytes written or < 0 on error
+    /// 2. uses UDP_SEGMENT so kernel or NIC does the split, at most 64 segments and 64KB
+    ///     per syscall. At the first EINVAL/EIO/ENOPROTOOPT it turns gso off for this socket
+    ///     and sends the segments one by one right out of the same buffer
+    /// 3. with @zeroCopy once EnableZeroCopy() succeeds, buffers >= GECO_ZEROCOPY_MIN_BYTES go
+    ///     out with MSG_ZEROCOPY. Caller must then leave the buffer untouched until
+    ///     GetZeroCopyCompleted() goes beyond the GetZeroCopyIssued() value read right before
+    ///     the send. ENOBUFS reaps completions and retries a few times, then the rest is copied
+    /// 4. ReapZeroCopyCompletions() drains MSG_ERRQUEUE and must be called regularly by the
+    ///     sending thread. It turns zerocopy off once kernel reports it had to copy anyway
+    //////////////////////////////////////////////////////////////////////////
+    send_result_t SendSegmented(send_params_t *sendParameters, int segmentSize, bool zeroCopy,
+        const char *file, unsigned int line);
+    bool EnableZeroCopy(void);
+    int ReapZeroCopyCompletions(void);
+    inline uint GetZeroCopyIssued(void) const { return zeroCopyIssued; }
+    inline uint GetZeroCopyCompleted(void) const { return zeroCopyCompleted; }
+
     /// Constructor not called at this monment !
     //friend GECO_THREAD_DECLARATION(RunRecvCycleLoop);
     //friend GECO_THREAD_DECLARATION(RunSendCycleLoop);
@@ -341,6 +672,65 @@ class GECO_EXPORT berkley_socket_t : public network_socket_t
     static void GetSystemAddressViaJISSocketIPV4(socket_fd_t rns2Socket, network_address_t *systemAddressOut);
     static void GetSystemAddressViaJISSocketIPV4And6(socket_fd_t rns2Socket, network_address_t *systemAddressOut);
 };
+
+#if GECO_ENABLE_IO_URING == 1
+struct uring_t;
+struct uring_send_bank_t;
+//////////////////////////////////////////////////////////////////////////
+/// 1. io_uring backend, AllocJIS() hands it out instead of berkley_socket_t when
+///     IsSupported() says kernel has multishot recvmsg and provided buffer rings
+/// 2. binding, socket options and all the send paths not overridden here are berkley ones,
+///     so it can be used wherever a berkley_socket_t is expected
+/// 3. SetupRings() must be called once after bind, if it fails (or jst is set) the socket
+///     simply keeps working as a plain berkley socket
+/// 4. recv keeps one multishot recvmsg armed over GECO_IO_URING_BUFFERS provided buffers,
+///     RecvFromBatch() only reaps completions and needs no syscall while there are some
+/// 5. FlushQueuedSends() submits the whole egress batch as sendmsg sqes with one enter,
+///     none at all with GECO_IO_URING_SQPOLL while the sq thread is awake. it never waits,
+///     queuedSendsData rotates over GECO_IO_URING_SEND_BANKS banks so QueueSend() copies
+///     payloads right where the kernel reads them, completions are reaped at next flush
+/// 6. recv ring belongs to recv thread (it arms the recv at first RecvFromBatch() so
+///     completions run in its context), send ring belongs to network update thread
+/// 7. if multishot recvmsg fails for good RecvFromBatch() closes the recv ring and falls
+///     back to berkley recv, GetPollFd() changes to rns2Socket from then on, so whoever
+///     polls it must compare GetPollFd() around RecvFromBatch() and watch the new fd
+//////////////////////////////////////////////////////////////////////////
+class GECO_EXPORT uring_socket_t : public berkley_socket_t
+{
+    protected:
+    uring_t *recvRing;
+    uring_t *sendRing;
+    uring_send_bank_t *sendBanks;
+    /// bank queuedSendsData points at
+    unsigned sendBank;
+    /// queuedSendsData of berkley_socket_t while banks stand in for it
+    char *ownSendsData;
+    uint sendErrors;
+    /// datagrams bigger than a provided buffer, dropped
+    uint datagramsTooBig;
+
+    /// @waitInFlight lets kernel finish with banks first, false only when ring is broken
+    void CloseSendRing(bool waitInFlight);
+    int ReapSendCompletions(void);
+
+    public:
+    uring_socket_t();
+    virtual ~uring_socket_t();
+
+    static bool IsSupported(void);
+    bool SetupRings(void);
+    void CloseRings(void);
+
+    virtual int RecvFromBatch(recv_params_t **recvFromStructs, int count) override;
+    virtual int FlushQueuedSends(const char *file, unsigned int line) override;
+    /// provided buffers are one mtu big, no room for coalesced datagrams
+    virtual bool EnableGRO(void) override;
+    virtual socket_fd_t GetPollFd(void) const override;
+    inline uint GetDatagramsTooBig(void) const { return datagramsTooBig; }
+
+    virtual void Print(void);
+};
+#endif
 #endif
 
 GECO_NET_END_NSPACE
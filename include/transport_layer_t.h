@@ -4,8 +4,11 @@
 #include "geco-export.h"
 #include "geco-namesapces.h"
 #include "geco-features.h"
+#include "geco-net-config.h"
 #include "geco-basic-type.h"
 #include "geco-time.h"
+#include "JackieArraryQueue.h"
+#include "JackieMemoryPool.h"
 
 #if ENABLE_SECURE_HAND_SHAKE==1
 #include "geco-secure-hand-shake.h"
@@ -18,12 +21,177 @@ class recv_params_t;
 class network_application_t;
 class geco_bit_stream_t;
 struct reliable_send_params_t;
+struct packet_fixed_t;
+struct internal_packet_t;
+class congestion_controller_t;
+
+/// ordering channel goes out in 5 bits of the message header
+const uint ORDERING_CHANNELS_SIZE = 32;
+/// one send buffer per packet_send_priority_t
+const uint SEND_PRIORITIES_SIZE = 4;
+
+/// inclusive run of datagram numbers, they are 24 bits and wrap
+struct datagram_range_t
+{
+    uint start;
+    uint end;
+};
+
+/// ack range already sent, it rides along in the next @repeats acks as well
+struct repeat_range_t
+{
+    datagram_range_t range;
+    uint repeats;
+};
 
 class GECO_EXPORT transport_layer_t
 {
     private:
     remote_system_t* remoteEndpoint;
 
+    /// ECN feedback. receiver side counts CE marked datagrams, acks echo the total.
+    /// sender side turns every rise of the echoed total into one congestion event
+    uint ecnCEReceived;
+    uint ecnCEEchoed;
+    uint ecnCongestionEvents;
+    /// data, ack and nak datagrams that did not parse. anyone can send garbage to
+    /// the port, so they are only counted, never logged one by one
+    uint malformedDropped;
+
+    /// decides how many bytes of data datagrams may be in flight, 0 sends without
+    /// limit. owned, JackieSlidingWindows unless SetCongestionController() replaced it
+    congestion_controller_t* congestionController;
+
+    /// pacing states, @congestionWindow in bytes and @smoothedRtt in us are fed by
+    /// congestion control, @nextTxTime is when the next datagram may leave
+    uint congestionWindow;
+    TimeUS smoothedRtt;
+    TimeUS nextTxTime;
+
+    /// retransmission timer of its own, RFC 6298 over every ack. congestion control
+    /// keeps its rto when there is one, this one stands in when there is none, so
+    /// a lost tail or a lost nak is resent either way
+    TimeUS rtoSrtt;
+    TimeUS rtoRttVar;
+    TimeUS rto;
+    /// path mtu black hole detection, timeouts in a row that took datagrams bigger
+    /// than @pathMtuBase bytes with them. an ack of one that big clears it
+    ushort pathMtuBase;
+    uint bigTimeouts;
+
+    /// messages waiting to be aggregated into datagrams, head of the highest
+    /// priority goes first. @sendBufferBits is the upper bound of their encoded size
+    JackieArraryQueue<internal_packet_t*> sendBuffer[SEND_PRIORITIES_SIZE];
+    JackieMemoryPool<internal_packet_t, 32> internalPacketPool;
+    uint sendBufferBits;
+    /// when the oldest buffered message came in, 0 if buffer is empty
+    TimeUS sendBufferTime;
+    /// an UNBUFFERED_IMMEDIATELY_SEND message is buffered, do not wait for more
+    bool sendBufferFlush;
+    /// payload bits of one datagram at the mtu Update() last packed for
+    uint sendCapacityBits;
+    /// all messages buffered are reliable ones waiting for @reliableAckBase to move
+    bool sendBufferBlocked;
+    /// next indexes handed out, written as uint24_t
+    uint reliableWriteIndex;
+    uint orderedWriteIndex[ORDERING_CHANNELS_SIZE];
+    uint sequencedWriteIndex[ORDERING_CHANNELS_SIZE];
+
+    /// sender side. what every data datagram not yet acked carried, reliable
+    /// messages chained by resendNext wait here until their datagram is acked,
+    /// or go back to send buffer when it is nak'ed
+    struct sent_datagram_t
+    {
+        uint number;
+        bool inUse;
+        TimeUS sendTime;
+        /// on wire, UDP_HEADER_SIZE included, what congestion control counted in flight
+        uint bytes;
+        internal_packet_t* reliables;
+    };
+    sent_datagram_t sentDatagrams[GECO_DATAGRAM_HISTORY_SIZE];
+    uint datagramWriteNumber;
+    /// equals @datagramWriteNumber or numbers the oldest datagram still waiting for its
+    /// ack, retransmission timer runs on it
+    uint oldestUnackedNumber;
+    /// reliable message indexes acked, all below @reliableAckBase are. none goes out
+    /// GECO_RELIABLE_WINDOW_SIZE or more above it, the receiver could not track it
+    uint reliableAckBase;
+    uint reliableAckMask[GECO_RELIABLE_WINDOW_SIZE / 32];
+
+    /// receiver side. datagram numbers to ack and holes to nak as ranges,
+    /// @ackRangesTime is when the oldest of them came in
+    JackieArraryQueue<datagram_range_t> ackRanges;
+    JackieArraryQueue<datagram_range_t> nakRanges;
+    /// acks are never numbered nor resent, repeating them is what survives losing one.
+    /// @ackRepeatTime is when the last ack went out, repeats go alone once it is idle
+    JackieArraryQueue<repeat_range_t> ackRepeatRanges;
+    TimeUS ackRepeatTime;
+    TimeUS ackRangesTime;
+    /// next datagram number expected in order
+    uint datagramReadNumber;
+    /// reliable message indexes received, all below @reliableReadBase are,
+    /// the window above it has one bit per index
+    uint reliableReadBase;
+    uint reliableReadMask[GECO_RELIABLE_WINDOW_SIZE / 32];
+    /// per ordering channel, next ordering index to deliver and the sequencing index
+    /// sequenced messages of it must reach. messages ahead of their channel wait in
+    /// @orderingHeld, sorted the way they were sent
+    uint orderedReadIndex[ORDERING_CHANNELS_SIZE];
+    uint sequencedReadIndex[ORDERING_CHANNELS_SIZE];
+    JackieArraryQueue<internal_packet_t*> orderingHeld[ORDERING_CHANNELS_SIZE];
+
+    protected:
+    /// append [@start, @end] to @ranges, merging it with the last range if they touch
+    static void AddRange(JackieArraryQueue<datagram_range_t>& ranges, uint start, uint end);
+    /// write as many ranges of @ranges as fit @maxBits, count first, and pop them.
+    /// room left goes to @repeats, which the ranges written join if it is given
+    static void WriteRanges(geco_bit_stream_t& bitStream, JackieArraryQueue<datagram_range_t>& ranges,
+        uint maxBits, JackieArraryQueue<repeat_range_t>* repeats);
+    /// ack @number and nak the hole before it, if any
+    void OnDatagramReceived(uint number, TimeUS timeUS);
+    /// true if reliable message @index was received before, records it otherwise
+    bool IsReliableDuplicate(uint index);
+    /// ordered or sequenced message @header is older than what its channel delivered
+    bool IsOrderingStale(const packet_fixed_t& header) const;
+    /// earlier ordered ones of the channel of @header are still on the way
+    bool IsOrderingAhead(const packet_fixed_t& header) const;
+    /// keep a copy of @header ahead of its channel, caller fills in its data.
+    /// 0 if the channel holds too many already
+    internal_packet_t* HoldOrdering(const packet_fixed_t& header);
+    /// move the channel of @header past it, it has just been delivered
+    void OnOrderingDelivered(const packet_fixed_t& header);
+    /// next message held on @channel that is in order now, marked delivered, 0 if none.
+    /// caller frees it with FreeInternalPacket()
+    internal_packet_t* PopOrderingReady(uint channel);
+    void ResetOrdering(void);
+    void OnDatagramAcked(uint number, TimeUS timeUS);
+    /// record reliable message @index acked and slide @reliableAckBase over the run complete
+    void OnReliableAcked(uint index);
+    void OnDatagramNaked(uint number, TimeUS timeUS);
+    /// tell congestion control @sent is lost, nak'ed or @timedOut, and resend it
+    void OnDatagramLost(sent_datagram_t& sent, TimeUS timeUS, bool timedOut);
+    /// move @oldestUnackedNumber past the slots acked or lost meanwhile
+    void AdvanceOldestUnacked(void);
+    /// every slot from @oldestUnackedNumber on is taken, sending more would wrap the history
+    bool IsHistoryFull(void) const;
+    /// rto of congestion control, or our own without one
+    TimeUS GetRto(void) const;
+    void OnRttSample(TimeUS rtt);
+    void ResetRto(void);
+    /// pacing follows cwnd and srtt of congestion control
+    void UpdatePacingState(void);
+    /// put reliable messages of @sent back to the head of send buffer
+    void ResendDatagram(sent_datagram_t& sent, TimeUS timeUS);
+    bool ProcessAcksAndNaks(recv_params_t* recvParams, bool hasAcks, bool hasNaks);
+    void SendAcksAndNaks(network_application_t* serverApp, remote_system_t* remoteSystem, TimeUS timeUS);
+    void ResetAcks(void);
+
+    /// bits @msg takes at most in a datagram, alignment included
+    static uint GetMessageMaxBits(const internal_packet_t* msg);
+    void FreeInternalPacket(internal_packet_t* msg);
+    void ClearSendBuffer(void);
+
 #if ENABLE_SECURE_HAND_SHAKE == 1
     public:
     cat::AuthenticatedEncryption* GetAuthenticatedEncryption(void) { return &auth_enc; }
@@ -44,13 +212,61 @@ class GECO_EXPORT transport_layer_t
     //connected.  The game should not use that data directly
     // because some data is used internally, such as packet acknowledgment and
     //split packets
+    /// every message aggregated in the datagram is handed to the user as one packet,
+    /// ordered ones in the order of their channel, sequenced ones only if newer
     bool ProcessOneConnectedRecvParams(network_application_t* serverApp,
-        recv_params_t* recvParams, unsigned mtuSize);
+        recv_params_t* recvParams, remote_system_t* remoteSystem);
     void Reset(bool param1, int MTUSize, bool client_has_security);
     void SetSplitMessageProgressInterval(int splitMessageProgressInterval);
     void SetUnreliableTimeout(TimeMS unreliableTimeout);
     void SetTimeoutTime(TimeMS defaultTimeoutTime);
+    /// buffer one message for Update() to aggregate, false if it does not fit one
+    /// datagram of sendParams.mtu. takes over sendParams.data unless makeDataCopy is set
     bool Send(reliable_send_params_t& sendParams);
+    /// pack buffered messages by priority into as few datagrams of the mtu of
+    /// @remoteSystem as they fit and send them, once a datagram is full,
+    /// GECO_SEND_AGGREGATION_DELAY_US is up or an immediate message asks for it.
+    /// also acks received datagrams as ranges and naks the holes between them
+    void Update(network_application_t* serverApp, remote_system_t* remoteSystem, TimeUS timeUS);
+    /// when Update() sends next, 0 if nothing is buffered or waits to be acked
+    TimeUS GetNextSendTime(void) const;
+    /// when the oldest datagram in flight times out, 0 if none is
+    TimeUS GetRetransmissionTime(void) const;
+
+    /// bits the message header of @header takes, before the data is byte aligned
+    static uint GetMessageHeaderBits(const packet_fixed_t* header);
+    /// per message header of data datagrams, reliability, dataBitLength and the indexes
+    /// and ordering channel the reliability needs. data follows it byte aligned
+    static void WriteMessageHeader(geco_bit_stream_t& bitStream, const packet_fixed_t& header);
+    /// read back what WriteMessageHeader() wrote, false if @bitStream ends early
+    /// or it is not a header we send
+    static bool ReadMessageHeader(geco_bit_stream_t& bitStream, packet_fixed_t& header);
+
+    /// drop in another congestion control for this connection, or turn it off with 0.
+    /// @controller must come from OP_NEW, it is taken over and freed with OP_DELETE.
+    /// it is Reset() to the mtu of the connection, what is in flight is not counted
+    void SetCongestionController(congestion_controller_t* controller, ushort mtu);
+    congestion_controller_t* GetCongestionController(void) const { return congestionController; }
+
+    /// datagrams up to @size bytes are known to make it, Reset() takes the mtu for it
+    void SetPathMtuBase(ushort size) { pathMtuBase = size; bigTimeouts = 0; }
+    /// retransmission timeouts in a row that took datagrams above the path mtu base
+    uint GetBigTimeouts(void) const { return bigTimeouts; }
+
+    /// total CE marks received from the remote system, the next ack echoes it
+    uint GetEcnCEReceived(void) const { return ecnCEReceived; }
+    /// @ceEchoed is the total the remote system has acked, returns true if it has
+    /// grown, i.e. some switch on the way is queueing and sending rate should back off
+    bool OnEcnCEEchoed(uint ceEchoed);
+    uint GetEcnCongestionEvents(void) const { return ecnCongestionEvents; }
+    uint GetMalformedDropped(void) const { return malformedDropped; }
+
+    /// congestion control reports its window and rtt whenever they change
+    void SetPacingState(uint cwnd, TimeUS srtt);
+    /// departure time of the next @bytes to remote system, 0 means straight away.
+    /// datagrams are spread at cwnd / rtt but never stamped further than
+    /// GECO_TXTIME_HORIZON_US ahead of @timeUS. nothing is paced before the first rtt sample
+    TimeUS GetPacedTxTime(int bytes, TimeUS timeUS);
 };
 
 GECO_NET_END_NSPACE
@@ -590,9 +590,10 @@ void geco_bit_stream_t::WriteMini(const uchar* src, const bit_size_t bits2Write,
     }
 
     /// last byte
-    if ((src[currByte] & 0xF0) == 0x00 || (src[currByte] & 0xF0) == 0xF0)
+    if ((src[currByte] & 0xF0) == (byteMatch & 0xF0))
     { /// the upper(left aligned) half of the last byte(now currByte == 0) is a 0000 (positive) or 1111 (nagative)
-        /// write a bit 1 and the remaining 4 bits.
+        /// write a bit 1 and the remaining 4 bits. ReadMini() fills the upper half back in
+        /// from the sign, so 1111 of an unsigned or 0000 of a signed byte must go out whole
         Write(true);
         WriteBits(src + currByte, 4, true);
     }
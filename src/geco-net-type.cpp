@@ -28,6 +28,13 @@ socket_binding_params_t::socket_binding_params_t()
     extraSocketOptions = 0;
     socketFamily = AF_INET;
     blockingSocket = USE_BLOBKING_SOCKET;
+    reusePortSockets = 1;
+    reusePortAffinity = false;
+    virtualNetwork = 0;
+    unixSocketDir = 0;
+    connectedPeerSockets = false;
+    recvPrefilter = false;
+    maxMTUSize = MAXIMUM_MTU_SIZE;
 }
 socket_binding_params_t::socket_binding_params_t(const char *_hostAddress, ushort _port)
 {
@@ -43,6 +50,13 @@ socket_binding_params_t::socket_binding_params_t(const char *_hostAddress, ushor
     extraSocketOptions = 0;
     socketFamily = AF_INET;
     blockingSocket = USE_BLOBKING_SOCKET;
+    reusePortSockets = 1;
+    reusePortAffinity = false;
+    virtualNetwork = 0;
+    unixSocketDir = 0;
+    connectedPeerSockets = false;
+    recvPrefilter = false;
+    maxMTUSize = MAXIMUM_MTU_SIZE;
 }
 
 int network_address_t::size(void)
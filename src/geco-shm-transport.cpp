@@ -0,0 +1,202 @@
+#include "geco-shm-transport.h"
+#include "geco-msg-ids.h"
+
+#if GECO_ENABLE_SHM_TRANSPORT == 1
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define GECO_SHM_MAGIC 0x4745534d
+#define GECO_SHM_SLOT_SIZE (sizeof(uint) + GECO_MAX_JUMBO_MTU_SIZE)
+#define GECO_SHM_SEGMENT_SIZE (sizeof(shm_segment_t) + 2 * GECO_SHM_TRANSPORT_SLOTS * GECO_SHM_SLOT_SIZE)
+
+GECO_NET_BEGIN_NSPACE
+////////////////////////////// shm_transceiver_t implementations ////////////////////////////
+shm_transceiver_t::shm_transceiver_t() : segment(0), txSlots(0), rxSlots(0), side(0),
+udp(0), maxMTUSize(MAXIMUM_MTU_SIZE), datagramsDropped(0), datagramsTooBig(0)
+{
+    name[0] = 0;
+}
+shm_transceiver_t::~shm_transceiver_t()
+{
+    Close();
+}
+bool shm_transceiver_t::Open(const guid_t &localGuid, const guid_t &remoteGuid,
+    const network_address_t &remote, berkley_socket_t *udp_, ushort mtu)
+{
+    assert(segment == 0);
+    assert(localGuid != remoteGuid);
+
+    side = localGuid.g < remoteGuid.g ? 0 : 1;
+    ulonglong low = side == 0 ? localGuid.g : remoteGuid.g;
+    ulonglong high = side == 0 ? remoteGuid.g : localGuid.g;
+    sprintf(name, "/geco-shm-%llx-%llx", (unsigned long long)low, (unsigned long long)high);
+
+    int fd = shm_open(name, O_CREAT | O_RDWR, S_IRUSR | S_IWUSR);
+    if (fd < 0)
+    {
+        fprintf(stderr, "shm_transceiver_t::Open()::shm_open()::failed with errno code (%d-%s)\n", errno, strerror(errno));
+        return false;
+    }
+    /// both ends truncate to the same size, a new segment comes out zeroed
+    if (ftruncate(fd, GECO_SHM_SEGMENT_SIZE) != 0)
+    {
+        fprintf(stderr, "shm_transceiver_t::Open()::ftruncate()::failed with errno code (%d-%s)\n", errno, strerror(errno));
+        close(fd);
+        shm_unlink(name);
+        return false;
+    }
+    void *addr = mmap(0, GECO_SHM_SEGMENT_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED)
+    {
+        fprintf(stderr, "shm_transceiver_t::Open()::mmap()::failed with errno code (%d-%s)\n", errno, strerror(errno));
+        shm_unlink(name);
+        return false;
+    }
+
+    segment = (shm_segment_t*)addr;
+    __sync_val_compare_and_swap(&segment->magic, 0, GECO_SHM_MAGIC);
+    if (segment->magic != GECO_SHM_MAGIC || segment->attached[side] != 0)
+    {
+        /// left over by someone else under the very same name
+        fprintf(stderr, "shm_transceiver_t::Open()::failed, %s is in use\n", name);
+        munmap(addr, GECO_SHM_SEGMENT_SIZE);
+        segment = 0;
+        return false;
+    }
+
+    char *slots = (char*)(segment + 1);
+    txSlots = slots + side * GECO_SHM_TRANSPORT_SLOTS * GECO_SHM_SLOT_SIZE;
+    rxSlots = slots + (side ^ 1) * GECO_SHM_TRANSPORT_SLOTS * GECO_SHM_SLOT_SIZE;
+    remoteAddress = remote;
+    udp = udp_;
+    maxMTUSize = mtu;
+    __sync_synchronize();
+    segment->attached[side] = 1;
+    return true;
+}
+void shm_transceiver_t::Close(void)
+{
+    if (segment == 0) return;
+    segment->attached[side] = 0;
+    __sync_synchronize();
+    if (segment->attached[side ^ 1] == 0)
+        shm_unlink(name);
+    munmap(segment, GECO_SHM_SEGMENT_SIZE);
+    segment = 0;
+    txSlots = rxSlots = 0;
+}
+bool shm_transceiver_t::ArmDoorbell(void)
+{
+    if (segment == 0) return true;
+    segment->waiting[side] = 1;
+    /// sender pushes then looks at waiting, we set waiting then look at the ring,
+    /// so one of us always sees the other
+    __sync_synchronize();
+    shm_ring_t &rx = segment->rings[side ^ 1];
+    if (rx.head != rx.tail)
+    {
+        segment->waiting[side] = 0;
+        return false;
+    }
+    return true;
+}
+void shm_transceiver_t::DisarmDoorbell(void)
+{
+    if (segment != 0) segment->waiting[side] = 0;
+}
+void shm_transceiver_t::SendUdp(const char *data, int length)
+{
+    send_params_t sendParams;
+    sendParams.data = (char*)data;
+    sendParams.length = length;
+    sendParams.receiverINetAddress = remoteAddress;
+    udp->Send(&sendParams, TRACKE_MALLOC);
+}
+int shm_transceiver_t::JackieINetSendTo(const char *data, int length, const network_address_t &systemAddress)
+{
+    assert(systemAddress == remoteAddress);
+    if (segment == 0 || segment->attached[side ^ 1] == 0)
+    {
+        SendUdp(data, length);
+        return length;
+    }
+
+    shm_ring_t &tx = segment->rings[side];
+    uint tail = tx.tail;
+    if (length > GECO_MAX_JUMBO_MTU_SIZE || tail - tx.head >= GECO_SHM_TRANSPORT_SLOTS)
+    {
+        datagramsDropped++;
+        return length;
+    }
+    char *slot = Slot(txSlots, tail);
+    *(uint*)slot = length;
+    memcpy(slot + sizeof(uint), data, length);
+    /// slot must be filled before consumer can see the new tail
+    __sync_synchronize();
+    tx.tail = tail + 1;
+
+    __sync_synchronize();
+    if (segment->waiting[side ^ 1] != 0
+        && __sync_bool_compare_and_swap(&segment->waiting[side ^ 1], 1, 0))
+    {
+        char doorbell = (char)ID_RECV_WAKEUP;
+        SendUdp(&doorbell, sizeof(doorbell));
+    }
+    return length;
+}
+int shm_transceiver_t::JackieINetRecvFrom(char *dataOut, int capacity, network_address_t *senderOut,
+    bool calledFromMainThread)
+{
+    (void)calledFromMainThread;
+    if (segment == 0) return 0;
+    shm_ring_t &rx = segment->rings[side ^ 1];
+    uint head = rx.head;
+    if (head == rx.tail) return 0;
+    /// read tail before the slot it covers
+    __sync_synchronize();
+
+    char *slot = Slot(rxSlots, head);
+    int length = *(uint*)slot;
+    if (length > maxMTUSize || length > capacity)
+    {
+        datagramsTooBig++;
+        length = 0;
+    }
+    else
+    {
+        memcpy(dataOut, slot + sizeof(uint), length);
+        *senderOut = remoteAddress;
+    }
+    /// done with the slot before producer can reuse it
+    __sync_synchronize();
+    rx.head = head + 1;
+    return length;
+}
+bool shm_transceiver_t::IsFork(const network_address_t &systemAddress) const
+{
+    (void)systemAddress;
+    return false;
+}
+ulonglong shm_transceiver_t::GetHostId(void)
+{
+    char bootId[64];
+    FILE *fp = fopen("/proc/sys/kernel/random/boot_id", "r");
+    if (fp == 0) return 0;
+    size_t size = fread(bootId, 1, sizeof(bootId), fp);
+    fclose(fp);
+    if (size == 0) return 0;
+
+    /// FNV-1a, only compared for equality
+    ulonglong hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= (uchar)bootId[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+GECO_NET_END_NSPACE
+#endif
@@ -3,9 +3,117 @@ using namespace geco::net;
 
 JackieSlidingWindows::JackieSlidingWindows()
 {
+    Reset(MAXIMUM_MTU_SIZE);
 }
 
 JackieSlidingWindows::~JackieSlidingWindows()
 {
 }
 
+void JackieSlidingWindows::Reset(ushort mtu)
+{
+    this->mtu = mtu;
+    cwnd = GECO_CC_INITIAL_WINDOW * mtu;
+    ssthresh = (uint)-1;
+    bytesInFlight = 0;
+    bytesAckedInPeriod = 0;
+    srtt = rttVar = 0;
+    rto = GECO_CC_INITIAL_RTO_US;
+    backOffTime = 0;
+    backedOff = false;
+}
+
+bool JackieSlidingWindows::CanSend(uint bytes) const
+{
+    /// an empty pipe always takes one datagram, or a tiny cwnd would stall
+    return bytesInFlight == 0 || bytesInFlight + bytes <= cwnd;
+}
+
+void JackieSlidingWindows::OnSend(uint bytes, TimeUS /*timeUS*/)
+{
+    bytesInFlight += bytes;
+    /// path mtu discovery only ever lets bigger datagrams out
+    if (bytes > mtu) mtu = bytes;
+}
+
+void JackieSlidingWindows::OnAck(uint bytes, TimeUS sendTimeUS, TimeUS timeUS)
+{
+    bytesInFlight -= bytes < bytesInFlight ? bytes : bytesInFlight;
+
+    /// resent messages go out in new datagrams, every sample is unambiguous
+    if (timeUS >= sendTimeUS)
+    {
+        TimeUS rtt = timeUS - sendTimeUS;
+        if (rtt == 0) rtt = 1; /// srtt of 0 means no sample
+        if (srtt == 0)
+        {
+            srtt = rtt;
+            rttVar = rtt / 2;
+        }
+        else
+        {
+            TimeUS delta = srtt > rtt ? srtt - rtt : rtt - srtt;
+            rttVar = (3 * rttVar + delta) / 4;
+            srtt = (7 * srtt + rtt) / 8;
+        }
+        /// a fresh sample also undoes the exponential back off of timeouts
+        rto = srtt + 4 * rttVar;
+        if (rto < GECO_CC_MIN_RTO_US) rto = GECO_CC_MIN_RTO_US;
+        if (rto > GECO_CC_MAX_RTO_US) rto = GECO_CC_MAX_RTO_US;
+    }
+
+    /// acks of what was sent before the back off do not grow cwnd again
+    if (backedOff)
+    {
+        if (sendTimeUS <= backOffTime) return;
+        backedOff = false;
+    }
+
+    if (cwnd < ssthresh)
+    {
+        cwnd += bytes;
+        return;
+    }
+    /// one mtu per cwnd acked, mtu*mtu/cwnd per datagram without the rounding
+    bytesAckedInPeriod += bytes;
+    if (bytesAckedInPeriod >= cwnd)
+    {
+        bytesAckedInPeriod -= cwnd;
+        cwnd += mtu;
+    }
+}
+
+void JackieSlidingWindows::OnLoss(uint bytes, TimeUS sendTimeUS, TimeUS timeUS, bool timedOut)
+{
+    bytesInFlight -= bytes < bytesInFlight ? bytes : bytesInFlight;
+    if (backedOff && sendTimeUS <= backOffTime) return;
+
+    if (timedOut)
+    {
+        ssthresh = cwnd / 2 > 2 * mtu ? cwnd / 2 : 2 * mtu;
+        cwnd = mtu;
+        rto *= 2;
+        if (rto > GECO_CC_MAX_RTO_US) rto = GECO_CC_MAX_RTO_US;
+        bytesAckedInPeriod = 0;
+        backOffTime = timeUS;
+        backedOff = true;
+        return;
+    }
+    BackOff(timeUS);
+}
+
+void JackieSlidingWindows::OnCongestionEvent(TimeUS timeUS)
+{
+    /// marks echoed within one rtt of the back off were set before it took effect
+    if (backedOff && timeUS < backOffTime + srtt) return;
+    BackOff(timeUS);
+}
+
+void JackieSlidingWindows::BackOff(TimeUS timeUS)
+{
+    ssthresh = cwnd / 2 > 2 * mtu ? cwnd / 2 : 2 * mtu;
+    cwnd = ssthresh;
+    bytesAckedInPeriod = 0;
+    backOffTime = timeUS;
+    backedOff = true;
+}
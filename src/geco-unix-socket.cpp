@@ -0,0 +1,156 @@
+#include "geco-unix-socket.h"
+
+#if GECO_ENABLE_UNIX_SOCKETS == 1
+GECO_NET_BEGIN_NSPACE
+////////////////////////////// unix_transceiver_t implementations ////////////////////////////
+unix_transceiver_t::unix_transceiver_t() : fd((socket_fd_t)INVALID_SOCKET), dirLength(0),
+maxMTUSize(MAXIMUM_MTU_SIZE), datagramsDropped(0)
+{
+    dir[0] = 0;
+    memset(&boundPath, 0, sizeof(boundPath));
+    host.FromString(GECO_UNIX_SOCKET_HOST, (ushort)0);
+}
+unix_transceiver_t::~unix_transceiver_t()
+{
+    if (fd != INVALID_SOCKET)
+    {
+        closesocket__(fd);
+        unlink(boundPath.sun_path);
+        fd = (socket_fd_t)INVALID_SOCKET;
+    }
+}
+bool unix_transceiver_t::ToPath(ushort port, sockaddr_un &path) const
+{
+    memset(&path, 0, sizeof(path));
+    path.sun_family = AF_UNIX;
+    int length = snprintf(path.sun_path, sizeof(path.sun_path), "%s/%u", dir, (uint)port);
+    return length > 0 && length < (int)sizeof(path.sun_path);
+}
+bool unix_transceiver_t::FromPath(const sockaddr_un &path, socklen_t length, network_address_t &address) const
+{
+    /// unnamed sender has no path at all
+    if (length <= offsetof(sockaddr_un, sun_path)) return false;
+    if (strncmp(path.sun_path, dir, dirLength) != 0 || path.sun_path[dirLength] != '/')
+        return false;
+
+    char *end;
+    const char *number = path.sun_path + dirLength + 1;
+    unsigned long port = strtoul(number, &end, 10);
+    if (end == number || *end != 0 || port == 0 || port > 65535) return false;
+    address = host;
+    address.SetPortHostOrder((ushort)port);
+    return true;
+}
+bool unix_transceiver_t::RemoveStalePath(const sockaddr_un &path) const
+{
+    socket_fd_t probe = socket__(AF_UNIX, SOCK_DGRAM, 0);
+    if (probe == INVALID_SOCKET) return false;
+    /// a path left by a crashed process refuses, one still read by someone does not
+    bool stale = connect(probe, (const sockaddr*)&path, sizeof(path)) != 0 && errno == ECONNREFUSED;
+    closesocket__(probe);
+    if (stale) unlink(path.sun_path);
+    return stale;
+}
+socket_binding_result_t unix_transceiver_t::Bind(const char *dir_, network_address_t &address,
+    bool isNonBlocking, ushort mtu)
+{
+    assert(fd == INVALID_SOCKET);
+    dirLength = strlen(dir_);
+    if (dirLength == 0 || dirLength >= sizeof(dir)) return JISBindResult_FAILED_BIND_SOCKET;
+    strcpy(dir, dir_);
+    maxMTUSize = mtu;
+
+    fd = socket__(AF_UNIX, SOCK_DGRAM, 0);
+    if (fd == INVALID_SOCKET)
+    {
+        fprintf(stderr, "unix_transceiver_t::Bind()::socket__()::failed with errno code (%d-%s)\n", errno, strerror(errno));
+        return JISBindResult_FAILED_BIND_SOCKET;
+    }
+
+    ushort port = address.GetPortHostOrder();
+    bool anyPort = port == 0;
+    if (anyPort) port = GECO_UNIX_SOCKET_FIRST_PORT;
+    int error;
+    for (;; port++)
+    {
+        if (!ToPath(port, boundPath))
+        {
+            fprintf(stderr, "unix_transceiver_t::Bind()::failed, %s is too long for sun_path\n", dir);
+            error = ENAMETOOLONG;
+            break;
+        }
+        int ret = bind__(fd, (const sockaddr*)&boundPath, sizeof(boundPath));
+        error = errno;
+        if (ret != 0 && error == EADDRINUSE && RemoveStalePath(boundPath))
+        {
+            ret = bind__(fd, (const sockaddr*)&boundPath, sizeof(boundPath));
+            error = errno;
+        }
+        if (ret == 0)
+        {
+            if (isNonBlocking)
+                fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+            /// no mtu on a unix socket, SO_SNDBUF caps the biggest datagram instead
+            int bufSize = GECO_SO_REVBUF_SIZE;
+            setsockopt__(fd, SOL_SOCKET, SO_SNDBUF, (char*)&bufSize, sizeof(bufSize));
+            setsockopt__(fd, SOL_SOCKET, SO_RCVBUF, (char*)&bufSize, sizeof(bufSize));
+            address = host;
+            address.SetPortHostOrder(port);
+            return JISBindResult_SUCCESS;
+        }
+        if (error != EADDRINUSE || !anyPort || port == 65535) break;
+    }
+
+    fprintf(stderr, "unix_transceiver_t::Bind()::bind__()::failed with errno code (%d-%s)\n", error, strerror(error));
+    closesocket__(fd);
+    fd = (socket_fd_t)INVALID_SOCKET;
+    boundPath.sun_path[0] = 0;
+    return JISBindResult_FAILED_BIND_SOCKET;
+}
+int unix_transceiver_t::JackieINetSendTo(const char *data, int length, const network_address_t &systemAddress)
+{
+    /// only paths in dir are reachable, anything else is lost on the way
+    if (!systemAddress.EqualsExcludingPort(host)) return length;
+    sockaddr_un path;
+    if (!ToPath(systemAddress.GetPortHostOrder(), path)) return -1;
+
+    /// a full receiver queue blocks datagram unix sockets, never let it stall network thread
+    int len;
+    do
+    {
+        len = (int)sendto__(fd, data, length, MSG_DONTWAIT, (const sockaddr*)&path, sizeof(path));
+    } while (len < 0 && errno == EINTR);
+    if (len < 0 && errno != ENOENT && errno != ECONNREFUSED && errno != EAGAIN && errno != EWOULDBLOCK)
+        fprintf(stderr, "unix_transceiver_t::JackieINetSendTo()::sendto__()::failed with errno code (%d-%s)\n", errno, strerror(errno));
+    /// nobody at that path or a reader too slow is what udp calls a lost datagram
+    return len < 0 ? length : len;
+}
+int unix_transceiver_t::JackieINetRecvFrom(char *dataOut, int capacity, network_address_t *senderOut,
+    bool calledFromMainThread)
+{
+    (void)calledFromMainThread;
+    if (capacity > maxMTUSize) capacity = maxMTUSize;
+    sockaddr_un path;
+    socklen_t pathLength = sizeof(path);
+    int len = (int)recvfrom__(fd, dataOut, capacity, MSG_TRUNC, (sockaddr*)&path, &pathLength);
+    if (len <= 0)
+    {
+        if (len < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+            fprintf(stderr, "unix_transceiver_t::JackieINetRecvFrom()::recvfrom__()::failed with errno code (%d-%s)\n", errno, strerror(errno));
+        return 0;
+    }
+    /// bigger than mtu or from a path outside dir
+    if (len > capacity || !FromPath(path, pathLength, *senderOut))
+    {
+        datagramsDropped++;
+        return 0;
+    }
+    return len;
+}
+bool unix_transceiver_t::IsFork(const network_address_t &systemAddress) const
+{
+    (void)systemAddress;
+    return false;
+}
+GECO_NET_END_NSPACE
+#endif
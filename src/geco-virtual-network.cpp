@@ -0,0 +1,180 @@
+#include <cstring>
+#include "geco-virtual-network.h"
+
+GECO_NET_BEGIN_NSPACE
+////////////////////////////// virtual_transceiver_t implementations ////////////////////////////
+virtual_transceiver_t::virtual_transceiver_t() : network(0), isNonBlocking(false)
+{
+    inboxEvent.Init();
+}
+virtual_transceiver_t::~virtual_transceiver_t()
+{
+    virtual_datagram_t *datagram;
+    while (inbox.PopHead(datagram))
+        gFreeEx(datagram, TRACKE_MALLOC);
+    inboxEvent.Close();
+}
+bool virtual_transceiver_t::Push(virtual_datagram_t *datagram)
+{
+    inboxMutex.Lock();
+    if (inbox.Size() >= GECO_VIRTUAL_NETWORK_INBOX_SIZE)
+    {
+        inboxMutex.Unlock();
+        gFreeEx(datagram, TRACKE_MALLOC);
+        return false;
+    }
+    bool wasEmpty = inbox.IsEmpty();
+    inbox.PushTail(datagram);
+    inboxMutex.Unlock();
+
+    /// recv thread only sleeps on an empty inbox
+    if (wasEmpty && !isNonBlocking) inboxEvent.TriggerEvent();
+    return true;
+}
+int virtual_transceiver_t::JackieINetSendTo(const char *data, int length, const network_address_t &systemAddress)
+{
+    assert(network != 0);
+    return network->Route(address, data, length, systemAddress);
+}
+int virtual_transceiver_t::JackieINetRecvFrom(char *dataOut, int capacity, network_address_t *senderOut,
+    bool calledFromMainThread)
+{
+    (void)calledFromMainThread;
+    virtual_datagram_t *datagram = 0;
+    inboxMutex.Lock();
+    bool got = inbox.PopHead(datagram);
+    inboxMutex.Unlock();
+
+    if (!got)
+    {
+        if (isNonBlocking) return 0;
+        inboxEvent.WaitEvent(GECO_REACTOR_WAIT_MS);
+        inboxMutex.Lock();
+        got = inbox.PopHead(datagram);
+        inboxMutex.Unlock();
+        if (!got) return 0;
+    }
+
+    /// same as RecvFromIPV4(), never hand out more than mtu
+    int length = datagram->length;
+    if (length > MAXIMUM_MTU_SIZE || length > capacity)
+    {
+        fprintf(stderr, "virtual_transceiver_t::JackieINetRecvFrom()::drop datagram of %d bytes, the remote sends a bigger datagram than our max mtu\n", length);
+        gFreeEx(datagram, TRACKE_MALLOC);
+        return 0;
+    }
+    memcpy(dataOut, datagram->data, length);
+    *senderOut = datagram->sender;
+    gFreeEx(datagram, TRACKE_MALLOC);
+    return length;
+}
+bool virtual_transceiver_t::IsFork(const network_address_t &systemAddress) const
+{
+    return network != 0 && network->Contains(systemAddress);
+}
+
+////////////////////////////// virtual_network_t implementations ////////////////////////////
+virtual_network_t::virtual_network_t() : endpointsSize(0), nextPort(1024),
+    datagramsDelivered(0), datagramsDropped(0)
+{
+}
+virtual_network_t::~virtual_network_t()
+{
+    /// every app attached must have been shut down by now
+    assert(endpointsSize == 0);
+}
+virtual_transceiver_t* virtual_network_t::Find(const network_address_t &address) const
+{
+    const JackieArrayList<virtual_transceiver_t*>& bucket =
+        endpoints[network_address_t::ToHashCode(address) & (GECO_VIRTUAL_NETWORK_BUCKETS - 1)];
+    for (uint i = 0; i < bucket.Size(); i++)
+    {
+        if (bucket[i]->address == address) return bucket[i];
+    }
+    return 0;
+}
+virtual_transceiver_t* virtual_network_t::Attach(network_address_t &address, bool isNonBlocking)
+{
+    endpointsMutex.Lock();
+    if (address.GetPortHostOrder() == 0)
+    {
+        /// like an ephemeral port, walk on from the last one handed out
+        for (uint tries = 0; tries < 65536 - 1024; tries++)
+        {
+            address.SetPortHostOrder(nextPort);
+            nextPort = nextPort == 65535 ? 1024 : nextPort + 1;
+            if (Find(address) == 0) break;
+        }
+    }
+    if (Find(address) != 0)
+    {
+        endpointsMutex.Unlock();
+        return 0;
+    }
+
+    virtual_transceiver_t *endpoint = geco::ultils::OP_NEW<virtual_transceiver_t>(TRACKE_MALLOC);
+    endpoint->network = this;
+    endpoint->address = address;
+    endpoint->isNonBlocking = isNonBlocking;
+    endpoints[network_address_t::ToHashCode(address) & (GECO_VIRTUAL_NETWORK_BUCKETS - 1)].InsertAtLast(endpoint);
+    endpointsSize++;
+    endpointsMutex.Unlock();
+    return endpoint;
+}
+void virtual_network_t::Detach(virtual_transceiver_t *endpoint)
+{
+    assert(endpoint != 0 && endpoint->network == this);
+    endpointsMutex.Lock();
+    JackieArrayList<virtual_transceiver_t*>& bucket =
+        endpoints[network_address_t::ToHashCode(endpoint->address) & (GECO_VIRTUAL_NETWORK_BUCKETS - 1)];
+    for (uint i = 0; i < bucket.Size(); i++)
+    {
+        if (bucket[i] == endpoint)
+        {
+            bucket.RemoveAtIndexFast(i);
+            endpointsSize--;
+            break;
+        }
+    }
+    endpointsMutex.Unlock();
+    geco::ultils::OP_DELETE(endpoint, TRACKE_MALLOC);
+}
+int virtual_network_t::Route(const network_address_t &sender, const char *data, int length,
+    const network_address_t &receiver)
+{
+    assert(data != 0 && length > 0);
+
+    /// header and payload in one block, receiver frees it with one call. copied
+    /// before locking, senders of all endpoints share the table lock
+    virtual_datagram_t *datagram = (virtual_datagram_t*)gMallocEx(sizeof(virtual_datagram_t) + length,
+        TRACKE_MALLOC);
+    if (datagram != 0)
+    {
+        datagram->sender = sender;
+        datagram->length = length;
+        datagram->data = (char*)(datagram + 1);
+        memcpy(datagram->data, data, length);
+    }
+
+    /// table stays locked while pushing so receiver can not be detached under us
+    endpointsMutex.Lock();
+    virtual_transceiver_t *endpoint = datagram != 0 ? Find(receiver) : 0;
+    bool delivered = endpoint != 0 && endpoint->Push(datagram);
+    if (delivered)
+        datagramsDelivered++;
+    else
+        datagramsDropped++;
+    endpointsMutex.Unlock();
+
+    /// a full inbox freed it already
+    if (endpoint == 0 && datagram != 0) gFreeEx(datagram, TRACKE_MALLOC);
+    return length;
+}
+bool virtual_network_t::Contains(const network_address_t &address)
+{
+    endpointsMutex.Lock();
+    bool found = Find(address) != 0;
+    endpointsMutex.Unlock();
+    return found;
+}
+GECO_NET_END_NSPACE
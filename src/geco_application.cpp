@@ -4,6 +4,7 @@
 #include "JackieINetVersion.h"
 #include "geco-sliding-windows.h"
 #include "geco-net-plugin.h"
+#include "geco-shm-transport.h"
 
 //#include "JackieString.h"
 
@@ -11,6 +12,14 @@
 #include <stdlib.h> // malloc
 #endif
 
+#if GECO_USE_EPOLL_REACTOR == 1
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#endif
+#if GECO_ENABLE_PEER_SOCKETS == 1
+#include <poll.h>
+#endif
+
 using namespace geco::net;
 using namespace geco::ultils;
 
@@ -46,7 +55,7 @@ static const unsigned char OFFLINE_MESSAGE_DATA_ID[16] =
 0x34, 0x56, 0x78 };
 
 network_application_t::network_application_t() :
-sendBitStream(MAXIMUM_MTU_SIZE
+sendBitStream(GECO_MAX_JUMBO_MTU_SIZE
 #if ENABLE_SECURE_HAND_SHAKE==1
 + cat::AuthenticatedEncryption::OVERHEAD_BYTES
 #endif
@@ -72,6 +81,18 @@ sendBitStream(MAXIMUM_MTU_SIZE
 
     remoteSystemList = 0;
     remoteSystemLookup = 0;
+    JISRecvParamsPool = 0;
+    JISGROBufferPool = 0;
+    JISRecvBufferRing = 0;
+#if GECO_ENABLE_PEER_SOCKETS == 1
+    JISPeerSockets = 0;
+#endif
+    pollFdsVersion = 0;
+    pollOnceIndex = 0;
+#if GECO_USE_EPOLL_REACTOR == 1
+    reactorEpollFd = -1;
+    reactorWakeupFd = -1;
+#endif
     activeSystemList = 0;
     activeSystemListSize = 0;
 
@@ -79,6 +100,7 @@ sendBitStream(MAXIMUM_MTU_SIZE
     userUpdateThreadPtr = 0;
     userUpdateThreadData = 0;
     incomeDatagramEventHandler = 0;
+    congestionControllerFactory = 0;
     endThreads = true;
     userThreadSleepTime = 10; // default sleep 10 ms to wit more incoming data
 
@@ -96,6 +118,15 @@ sendBitStream(MAXIMUM_MTU_SIZE
     {
         localIPAddrs[index] = JACKIE_NULL_ADDRESS;
     }
+    for (uint index = 0; index < GECO_PLPMTUD_CACHE_SIZE; index++)
+    {
+        pathMtuCache[index].mtu = 0;
+    }
+    for (uint index = 0; index < GECO_MULTICAST_SENDERS_SIZE; index++)
+    {
+        multicastSenders[index].guid = JACKIE_NULL_GUID;
+    }
+    multicastSequence = 0;
 
 #ifdef _DEBUG
     // Wait longer to disconnect in debug so I don't get disconnected while tracing
@@ -120,11 +151,28 @@ sendBitStream(MAXIMUM_MTU_SIZE
 #endif
 
     GenerateGUID();
+#if GECO_ENABLE_SHM_TRANSPORT == 1
+    myHostId = shm_transceiver_t::GetHostId();
+#else
+    myHostId = 0;
+#endif
     ResetSendReceipt();
 }
 network_application_t::~network_application_t()
 {
     OP_DELETE_ARRAY(JISRecvParamsPool, TRACKE_MALLOC);
+    OP_DELETE_ARRAY(JISGROBufferPool, TRACKE_MALLOC);
+    OP_DELETE_ARRAY(JISRecvBufferRing, TRACKE_MALLOC);
+#if GECO_ENABLE_PEER_SOCKETS == 1
+    if (JISPeerSockets != 0)
+    {
+        for (uint index = 0; remoteSystemList != 0 && index < maxConnections; index++)
+            ClosePeerSocket(&remoteSystemList[index]);
+        for (uint index = 0; index < bindedSockets.Size(); index++)
+            FreeRetiredPeerSockets(index, true);
+        OP_DELETE_ARRAY(JISPeerSockets, TRACKE_MALLOC);
+    }
+#endif
 }
 
 startup_result_t network_application_t::startup(socket_binding_params_t *bindLocalSockets,
@@ -219,18 +267,51 @@ startup_result_t network_application_t::startup(socket_binding_params_t *bindLoc
             berkleyBindParams.eventHandler = this;
             berkleyBindParams.remotePortJackieNetWasStartedOn_PS3_PS4_PSP2 =
                 bindLocalSockets[index].remotePortWasStartedOn_PS3_PSP2;
+            /// a connected socket per peer joins the port of the shared one with SO_REUSEPORT
+            berkleyBindParams.connectedPeers = GECO_ENABLE_PEER_SOCKETS == 1 &&
+                bindLocalSockets[index].connectedPeerSockets;
+            berkleyBindParams.reusePort = bindLocalSockets[index].reusePortSockets > 1 ||
+                berkleyBindParams.connectedPeers;
+            berkleyBindParams.maxMTUSize = bindLocalSockets[index].maxMTUSize;
+            berkleyBindParams.recvPrefilter = bindLocalSockets[index].recvPrefilter;
 
 #if USE_SINGLE_THREAD == 0
             /// multi-threads app can use either non-blobk or blobk socket
             /// false = blobking, true = non-blocking
+#if GECO_USE_EPOLL_REACTOR == 1
+            /// reactor drains a socket until EAGAIN, it must never block
+            berkleyBindParams.isNonBlocking = true;
+#else
             berkleyBindParams.isNonBlocking = bindLocalSockets[index].blockingSocket;
+#endif
 #else
             ///  single thread app will always use non-blobking socket
             berkleyBindParams.isNonBlocking = true;
 #endif
 
-            bindResult = ((berkley_socket_t*)sock)->Bind(&berkleyBindParams,
-                TRACKE_MALLOC);
+            if (bindLocalSockets[index].virtualNetwork != 0)
+            {
+                /// in-process network, no kernel socket to fan out over
+                berkleyBindParams.reusePort = false;
+                berkleyBindParams.connectedPeers = false;
+                bindResult = ((berkley_socket_t*)sock)->BindVirtual(
+                    bindLocalSockets[index].virtualNetwork, &berkleyBindParams);
+            }
+#if GECO_ENABLE_UNIX_SOCKETS == 1
+            else if (bindLocalSockets[index].unixSocketDir != 0)
+            {
+                /// one path per port, no SO_REUSEPORT and no connect()ed siblings
+                berkleyBindParams.reusePort = false;
+                berkleyBindParams.connectedPeers = false;
+                bindResult = ((berkley_socket_t*)sock)->BindUnix(
+                    bindLocalSockets[index].unixSocketDir, &berkleyBindParams);
+            }
+#endif
+            else
+            {
+                bindResult = ((berkley_socket_t*)sock)->Bind(&berkleyBindParams,
+                    TRACKE_MALLOC);
+            }
 
             if (
 #if NET_SUPPORT_IPV6 ==0
@@ -265,9 +346,19 @@ startup_result_t network_application_t::startup(socket_binding_params_t *bindLoc
                     assert(bindResult == JISBindResult_SUCCESS);
                     std::cout << "Bind [" << sock->GetBoundAddress().ToString()
                         << "] Successfully";
-                    sock->SetUserConnectionSocketIndex(index);
+                    InitBindedSocket((berkley_socket_t*)sock, index);
                     break;
             }
+
+            /// SO_REUSEPORT fan-out, open the rest of the group on the very same port
+            if (berkleyBindParams.reusePort &&
+                !BindReusePortGroup((berkley_socket_t*)sock, &berkleyBindParams,
+                bindLocalSockets[index], index))
+            {
+                DeallocBindedSockets();
+                std::cout << "Bind Failed (FAILED_BIND_REUSEPORT_GROUP) ! ";
+                return SOCKET_PORT_ALREADY_IN_USE;
+            }
         }
         else
         {
@@ -277,7 +368,8 @@ startup_result_t network_application_t::startup(socket_binding_params_t *bindLoc
 #endif
     }
 
-    assert(bindedSockets.Size() == bindLocalSocketsCount);
+    /// more sockets than binding params when SO_REUSEPORT fan-out is used
+    assert(bindedSockets.Size() >= bindLocalSocketsCount);
 
     /// after binding, assign IPAddress port number
 #if !defined(__native_client__) && !defined(WINDOWS_STORE_RT)
@@ -295,6 +387,13 @@ startup_result_t network_application_t::startup(socket_binding_params_t *bindLoc
 
     JISRecvParamsPool = OP_NEW_ARRAY<JackieMemoryPool<recv_params_t>>(
         bindedSockets.Size(), TRACKE_MALLOC);
+    JISGROBufferPool = OP_NEW_ARRAY<JackieMemoryPool<recv_gro_buffer_t, 8, 2>>(
+        bindedSockets.Size(), TRACKE_MALLOC);
+    JISRecvBufferRing = OP_NEW_ARRAY<JackieBytesRing<GECO_RECV_RING_SIZE>>(
+        bindedSockets.Size(), TRACKE_MALLOC);
+#if GECO_ENABLE_PEER_SOCKETS == 1
+    JISPeerSockets = OP_NEW_ARRAY<peer_sockets_t>(bindedSockets.Size(), TRACKE_MALLOC);
+#endif
 #if USE_SINGLE_THREAD == 0
     deAllocRecvParamQ = OP_NEW_ARRAY < JackieSPSCQueue <
         recv_params_t* >> (bindedSockets.Size(), TRACKE_MALLOC);
@@ -339,6 +438,9 @@ startup_result_t network_application_t::startup(socket_binding_params_t *bindLoc
                 JACKIE_NULL_ADDRESS;
             remoteSystemList[index].connectMode = remote_system_t::NO_ACTION;
             remoteSystemList[index].MTUSize = defaultMTUSize;
+            remoteSystemList[index].peerSocket = 0;
+            remoteSystemList[index].sharedSocket = 0;
+            remoteSystemList[index].sameHost = false;
             remoteSystemList[index].remoteSystemIndex = (system_index_t)index;
 #ifdef _DEBUG
             remoteSystemList[index].reliabilityLayer.ApplyNetworkSimulator(_packetloss, _minExtraPing, _extraPingVariance);
@@ -375,10 +477,18 @@ startup_result_t network_application_t::startup(socket_binding_params_t *bindLoc
         /// Create recv threads
 #if !defined(__native_client__) && !defined(WINDOWS_STORE_RT)
 #if USE_SINGLE_THREAD == 0
-        /// this will create @bindLocalSocketsCount number of of recv threads
+        /// this will create one recv thread per binded socket
         /// That is if you have two NICs, will create two recv threads to handle
-        /// each of socket
-        for (index = 0; index < bindLocalSocketsCount; index++)
+        /// each of socket, plus one per extra socket of SO_REUSEPORT groups
+#if GECO_USE_EPOLL_REACTOR == 1
+        /// one reactor thread waits on all of binded sockets instead
+        if (CreateReactorThread(threadPriority) != 0)
+        {
+            End(0);
+            return FAILED_TO_CREATE_RECV_THREAD;
+        }
+#else
+        for (index = 0; index < bindedSockets.Size(); index++)
         {
             if (bindedSockets[index]->IsBerkleySocket())
             {
@@ -389,6 +499,7 @@ startup_result_t network_application_t::startup(socket_binding_params_t *bindLoc
                 }
             }
         }
+#endif
 
         /// Wait for the threads to activate. When they are active they will set these variables to true
         while (!isRecvPollingThreadActive.GetValue()) GecoSleep(10);
@@ -425,6 +536,79 @@ startup_result_t network_application_t::startup(socket_binding_params_t *bindLoc
     return START_SUCCEED;
     }
 
+void network_application_t::InitBindedSocket(berkley_socket_t* sock, uint userIndex)
+{
+    sock->SetUserConnectionSocketIndex(userIndex);
+    /// socket options below all need a udp socket
+    if (sock->IsVirtual()) return;
+#if GECO_ENABLE_UNIX_SOCKETS == 1
+    if (sock->IsUnix()) return;
+#endif
+    if (sock->GetBindingParams()->recvPrefilter)
+        sock->AttachRecvPrefilter(OFFLINE_MESSAGE_DATA_ID);
+#if GECO_ENABLE_IO_URING == 1
+    /// rings need the bound fd, on failure it just stays a berkley socket
+    if (sock->GetSocketType() == JISType_LINUX_IO_URING)
+        ((uring_socket_t*)sock)->SetupRings();
+#endif
+#if GECO_ENABLE_UDP_GRO == 1
+    sock->EnableGRO();
+#endif
+#if GECO_ENABLE_ZEROCOPY == 1
+    sock->EnableZeroCopy();
+#endif
+#if GECO_ENABLE_RECV_TIMESTAMPS == 1
+    sock->EnableRecvTimestamps();
+#endif
+#if GECO_ENABLE_PKTINFO == 1
+    /// no-op unless sock is bound to the wildcard addr
+    sock->EnablePktInfo();
+#endif
+#if GECO_ENABLE_RXQ_OVFL == 1
+    sock->EnableRxqOvfl();
+#endif
+#if GECO_ENABLE_PLPMTUD == 1
+    sock->EnablePathMtuProbe();
+#endif
+#if GECO_ENABLE_ECN == 1
+    sock->EnableEcn();
+#endif
+#if GECO_ENABLE_TXTIME == 1
+    sock->EnableTxTime();
+#endif
+}
+bool network_application_t::BindReusePortGroup(berkley_socket_t* first,
+    berkley_socket_binding_params_t* berkleyBindParams,
+    const socket_binding_params_t& bindLocalSocket, uint userIndex)
+{
+    /// port 0 has been resolved by the first bind, the rest must follow it
+    berkleyBindParams->port = first->GetBoundAddress().GetPortHostOrder();
+
+    for (uint i = 1; i < bindLocalSocket.reusePortSockets; i++)
+    {
+        network_socket_t* sock;
+        do
+        {
+            sock = network_socket_alloc_t::AllocJIS();
+        } while (sock == 0);
+        bindedSockets.InsertAtLast(sock);
+
+        if (!sock->IsBerkleySocket() ||
+            ((berkley_socket_t*)sock)->Bind(berkleyBindParams, TRACKE_MALLOC)
+            != JISBindResult_SUCCESS)
+            return false;
+
+        std::cout << "Bind [" << sock->GetBoundAddress().ToString()
+            << "] Successfully (SO_REUSEPORT " << i + 1 << "/"
+            << bindLocalSocket.reusePortSockets << ")";
+        InitBindedSocket((berkley_socket_t*)sock, userIndex);
+    }
+
+    if (bindLocalSocket.reusePortAffinity)
+        first->AttachReusePortCBPF(bindLocalSocket.reusePortSockets);
+    return true;
+}
+
 void network_application_t::End(uint blockDuration, unsigned char orderingChannel,
     packet_send_priority_t disconnectionNotificationPriority)
 {
@@ -446,8 +630,21 @@ inline void network_application_t::ReclaimAllJISRecvParams(uint Index)
     {
         bool ret = deAllocRecvParamQ[Index].PopHead(recvParams);
         assert(ret == true);
-        JISRecvParamsPool[Index].Reclaim(recvParams);
+        ReclaimJISRecvParamsToPool(recvParams, Index);
+    }
+}
+inline void network_application_t::ReclaimJISRecvParamsToPool(recv_params_t *s, uint index)
+{
+    if (s->groBuffer != 0)
+    {
+        if (--s->groBuffer->refCount <= 0)
+            JISGROBufferPool[index].Reclaim(s->groBuffer);
+    }
+    else if (s->data != 0 && JISRecvBufferRing[index].Owns(s->data))
+    {
+        JISRecvBufferRing[index].Release(s->data);
     }
+    JISRecvParamsPool[index].Reclaim(s);
 }
 inline recv_params_t * network_application_t::AllocJISRecvParams(uint Index)
 {
@@ -457,6 +654,11 @@ inline recv_params_t * network_application_t::AllocJISRecvParams(uint Index)
     {
         ptr = JISRecvParamsPool[Index].Allocate();
     } while (ptr == 0);
+    ptr->data = 0;
+    ptr->groBuffer = 0;
+    ptr->groSegmentSize = 0;
+    ptr->receiverINetAddress = JACKIE_NULL_ADDRESS;
+    ptr->ecn = ECN_NOT_ECT;
     ptr->localBoundSocket = bindedSockets[Index];
     return ptr;
 }
@@ -469,21 +671,19 @@ void network_application_t::ClearAllRecvParamsQs()
         {
             bool ret = allocRecvParamQ[index].PopHead(recvParams);
             assert(ret == true);
-            if (recvParams->data != 0)
-                gFreeEx(recvParams->data, TRACKE_MALLOC);
             JISRecvParamsPool[index].Reclaim(recvParams);
         }
         for (uint i = 0; i < deAllocRecvParamQ[index].Size(); i++)
         {
             bool ret = deAllocRecvParamQ[index].PopHead(recvParams);
             assert(ret == true);
-            if (recvParams->data != 0)
-                gFreeEx(recvParams->data, TRACKE_MALLOC);
             JISRecvParamsPool[index].Reclaim(recvParams);
         }
         allocRecvParamQ[index].Clear();
         deAllocRecvParamQ[index].Clear();
         JISRecvParamsPool[index].Clear();
+        JISGROBufferPool[index].Clear();
+        JISRecvBufferRing[index].Clear();
     }
 }
 
@@ -658,10 +858,127 @@ int network_application_t::CreateNetworkUpdateThread(int threadPriority)
     return JACKIE_Thread::Create(RunNetworkUpdateCycleLoop, this,
         threadPriority);
 }
+#if GECO_USE_EPOLL_REACTOR == 1
+int network_application_t::CreateReactorThread(int threadPriority)
+{
+    CloseReactor();
+
+    reactorEpollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (reactorEpollFd < 0)
+    {
+        fprintf(stderr, "JackieApplication::CreateReactorThread()::epoll_create1()::failed with errno code (%d-%s)\n", errno, strerror(errno));
+        return -1;
+    }
+    reactorWakeupFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (reactorWakeupFd < 0)
+    {
+        fprintf(stderr, "JackieApplication::CreateReactorThread()::eventfd()::failed with errno code (%d-%s)\n", errno, strerror(errno));
+        CloseReactor();
+        return -1;
+    }
+
+    /// edge triggered, reactor always drains a ready socket until EAGAIN. level triggered
+    /// would spin on EPOLLERR as long as zerocopy completions sit in the error queue
+    epoll_event ev;
+    ev.events = EPOLLIN | EPOLLET;
+    for (uint index = 0; index < bindedSockets.Size(); index++)
+    {
+        if (!bindedSockets[index]->IsBerkleySocket()) continue;
+        ev.data.u32 = index;
+        if (epoll_ctl(reactorEpollFd, EPOLL_CTL_ADD,
+            ((berkley_socket_t*)bindedSockets[index])->GetPollFd(), &ev) != 0)
+        {
+            fprintf(stderr, "JackieApplication::CreateReactorThread()::epoll_ctl()::failed with errno code (%d-%s)\n", errno, strerror(errno));
+            CloseReactor();
+            return -1;
+        }
+    }
+    ev.events = EPOLLIN;
+    ev.data.u32 = (uint)-1;
+    if (epoll_ctl(reactorEpollFd, EPOLL_CTL_ADD, reactorWakeupFd, &ev) != 0)
+    {
+        CloseReactor();
+        return -1;
+    }
+
+    return JACKIE_Thread::Create(RunReactorCycleLoop, this, threadPriority);
+}
+void network_application_t::CloseReactor(void)
+{
+    if (reactorWakeupFd >= 0) { close(reactorWakeupFd); reactorWakeupFd = -1; }
+    if (reactorEpollFd >= 0) { close(reactorEpollFd); reactorEpollFd = -1; }
+}
+void network_application_t::WakeupReactor(void)
+{
+    if (reactorWakeupFd < 0) return;
+    eventfd_t one = 1;
+    eventfd_write(reactorWakeupFd, one);
+}
+void network_application_t::RunReactorRecvCycles(uint index)
+{
+    for (int cycle = 0; cycle < GECO_REACTOR_CYCLES_PER_WAKEUP; cycle++)
+    {
+        if (endThreads || RunRecvCycleOnce(index) <= 0) return;
+    }
+    /// edge triggered, no new event comes until it is drained, so remember it ourselves
+    for (uint i = 0; i < reactorPendingQ.Size(); i++)
+    {
+        if (reactorPendingQ[i] == index) return;
+    }
+    reactorPendingQ.PushTail(index);
+}
+int network_application_t::RunReactorCycleOnce(int timeoutMS)
+{
+    /// sockets left over from last time must not wait for new events
+    epoll_event events[16];
+    int ready = epoll_wait(reactorEpollFd, events, 16, reactorPendingQ.Size() > 0 ? 0 : timeoutMS);
+    if (ready < 0)
+    {
+        if (errno != EINTR)
+            fprintf(stderr, "JackieApplication::RunReactorCycleOnce()::epoll_wait()::failed with errno code (%d-%s)\n", errno, strerror(errno));
+        ready = 0;
+    }
+
+    /// leftovers first, they have waited a whole round already
+    uint pending = reactorPendingQ.Size();
+    for (uint i = 0; i < pending; i++)
+    {
+        uint index;
+        reactorPendingQ.PopHead(index);
+        RunReactorRecvCycles(index);
+    }
+
+    for (int i = 0; i < ready; i++)
+    {
+        if (events[i].data.u32 == (uint)-1)
+        {
+            eventfd_t val;
+            eventfd_read(reactorWakeupFd, &val);
+            continue;
+        }
+        RunReactorRecvCycles(events[i].data.u32);
+    }
+#if GECO_ENABLE_PEER_SOCKETS == 1
+    /// idle indexes never get to RunRecvCycleOnce(), closed peers must not wait on traffic
+    for (uint index = 0; index < bindedSockets.Size(); index++)
+        AckRetiredPeerSockets(index);
+#endif
+    return ready;
+}
+#endif
 void network_application_t::stop_recv_thread()
 {
     endThreads = true;
 #if USE_SINGLE_THREAD == 0
+#if GECO_USE_EPOLL_REACTOR == 1
+    /// no need to send to ourselves, eventfd gets reactor out of epoll_wait()
+    WakeupReactor();
+    TimeMS timeout = Get32BitsTimeMS() + 1000;
+    while (isRecvPollingThreadActive.GetValue() > 0 && Get32BitsTimeMS() < timeout)
+        GecoSleep(10);
+    CloseReactor();
+    return;
+#endif
     for (uint i = 0; i < bindedSockets.Size(); i++)
     {
         if (bindedSockets[i]->IsBerkleySocket())
@@ -669,11 +986,13 @@ void network_application_t::stop_recv_thread()
             berkley_socket_t* sock = (berkley_socket_t*)bindedSockets[i];
             if (sock->GetBindingParams()->isNonBlocking == USE_BLOBKING_SOCKET)
             {
-                /// try to send 0 data to let recv thread keep running
+                /// send a wakeup to let recv thread keep running
                 /// to detect the isRecvPollingThreadActive === false so that stop the thread
-                char zero[] = "This is used to Stop Recv Thread";
-                send_params_t sendParams =
-                {   zero, sizeof(zero), 0, sock->GetBoundAddress(), 0};
+                char wakeup = (char)ID_RECV_WAKEUP;
+                send_params_t sendParams;
+                sendParams.data = &wakeup;
+                sendParams.length = sizeof(wakeup);
+                sendParams.receiverINetAddress = sock->GetBoundAddress();
                 sock->Send(&sendParams, TRACKE_MALLOC);
                 TimeMS timeout = Get32BitsTimeMS() + 1000;
                 while (isRecvPollingThreadActive.GetValue() > 0 && Get32BitsTimeMS() < timeout)
@@ -722,11 +1041,8 @@ void network_application_t::ProcessOneRecvParam(recv_params_t* recvParams)
         bsp.data = bs.char_data();
         bsp.length = bs.get_written_bytes();
         bsp.receiverINetAddress = recvParams->senderINetAddress;
-        if (recvParams->localBoundSocket->Send(&bsp, TRACKE_MALLOC) > 0)
-        {
-            for (index = 0; index < this->pluginListNTS.Size(); index++)
-                this->pluginListNTS[index]->OnDirectSocketSend(&bsp);
-        }
+        bsp.senderINetAddress = recvParams->receiverINetAddress;
+        SendBatched(recvParams->localBoundSocket, &bsp);
         return;
     }
 
@@ -748,7 +1064,7 @@ void network_application_t::ProcessOneRecvParam(recv_params_t* recvParams)
         if (remoteEndPoint != 0) // if this datagram comes from connected system
         {
             remoteEndPoint->reliabilityLayer.ProcessOneConnectedRecvParams(this,
-                recvParams, remoteEndPoint->MTUSize);
+                recvParams, remoteEndPoint);
         }
         else
         {
@@ -882,6 +1198,15 @@ void network_application_t::IsOfflineRecvParams(recv_params_t* recvParams,
                 /// msg layout: MessageID MessageID OFFLINE_MESSAGE_DATA_ID JackieGUID
                 OnConnectionFailed(recvParams, isOfflinerecvParams);
                 break;
+            case ID_PATH_MTU_PROBE:
+                OnPathMtuProbe(recvParams, isOfflinerecvParams);
+                break;
+            case ID_PATH_MTU_PROBE_REPLY:
+                OnPathMtuProbeReply(recvParams, isOfflinerecvParams);
+                break;
+            case ID_MULTICAST_DATA:
+                OnMulticastData(recvParams, isOfflinerecvParams);
+                break;
             default:
                 *isOfflinerecvParams = false;
                 break;
@@ -1043,6 +1368,10 @@ void network_application_t::OnConnectionRequest2(recv_params_t* recvParams,
         guid_t guid;
         fromClientReader.Read(guid);
         std::cout << "server ReadMini(client guid) " << guid.g;
+        ulonglong hostId = 0;
+#if GECO_ENABLE_SHM_TRANSPORT == 1
+        fromClientReader.Read(hostId);
+#endif
 
         int outcome;
         remote_system_t* rsysaddr = GetRemoteSystem(
@@ -1114,6 +1443,9 @@ void network_application_t::OnConnectionRequest2(recv_params_t* recvParams,
         toClientReplay2Writer.WriteMini(recvParams->senderINetAddress);
         toClientReplay2Writer.WriteMini(mtu);
         toClientReplay2Writer.WriteMini(clientSecureRequiredbyServer);
+#if GECO_ENABLE_SHM_TRANSPORT == 1
+        toClientReplay2Writer.Write(myHostId);
+#endif
 
         //return ID_OPEN_CONNECTION_REPLY if they are the same
         if (outcome == 1)
@@ -1136,10 +1468,8 @@ void network_application_t::OnConnectionRequest2(recv_params_t* recvParams,
             bsp.data = toClientReplay2Writer.char_data();
             bsp.length = toClientReplay2Writer.get_written_bytes();
             bsp.receiverINetAddress = recvParams->senderINetAddress;
-            recvParams->localBoundSocket->Send(&bsp, TRACKE_MALLOC);
-
-            for (index = 0; index < pluginListNTS.Size(); index++)
-                pluginListNTS[index]->OnDirectSocketSend(&bsp);
+            bsp.senderINetAddress = recvParams->receiverINetAddress;
+            SendBatched(recvParams->localBoundSocket, &bsp);
         }
         // return ID_ALREADY_CONNECTED
         else if (outcome != 0)
@@ -1154,10 +1484,8 @@ void network_application_t::OnConnectionRequest2(recv_params_t* recvParams,
             bsp.data = toClientAlreadyConnectedWriter.char_data();
             bsp.length = toClientAlreadyConnectedWriter.get_written_bytes();
             bsp.receiverINetAddress = recvParams->senderINetAddress;
-            recvParams->localBoundSocket->Send(&bsp, TRACKE_MALLOC);
-
-            for (index = 0; index < pluginListNTS.Size(); index++)
-                pluginListNTS[index]->OnDirectSocketSend(&bsp);
+            bsp.senderINetAddress = recvParams->receiverINetAddress;
+            SendBatched(recvParams->localBoundSocket, &bsp);
         }
         /// start to handle new connection from client
         else if (outcome == 0)
@@ -1177,10 +1505,8 @@ void network_application_t::OnConnectionRequest2(recv_params_t* recvParams,
                 bsp.data = toClientWriter.char_data();
                 bsp.length = toClientWriter.get_written_bytes();
                 bsp.receiverINetAddress = recvParams->senderINetAddress;
-                recvParams->localBoundSocket->Send(&bsp, TRACKE_MALLOC);
-
-                for (index = 0; index < pluginListNTS.Size(); index++)
-                    pluginListNTS[index]->OnDirectSocketSend(&bsp);
+                bsp.senderINetAddress = recvParams->receiverINetAddress;
+                SendBatched(recvParams->localBoundSocket, &bsp);
             }
             // Assign this client to Remote System List
             else
@@ -1201,6 +1527,8 @@ void network_application_t::OnConnectionRequest2(recv_params_t* recvParams,
                     thisIPFloodsConnRequest, mtu,
                     recvivedBoundAddrFromClient, guid,
                     clientSecureRequiredbyServer);
+                if (free_rs != 0)
+                    free_rs->sameHost = IsSameHost(recvParams->senderINetAddress, hostId);
 
                 if (thisIPFloodsConnRequest)
                 {
@@ -1213,10 +1541,8 @@ void network_application_t::OnConnectionRequest2(recv_params_t* recvParams,
                     bsp.data = toClientWriter.char_data();
                     bsp.length = toClientWriter.get_written_bytes();
                     bsp.receiverINetAddress = recvParams->senderINetAddress;
-                    recvParams->localBoundSocket->Send(&bsp, TRACKE_MALLOC);
-
-                    for (index = 0; index < pluginListNTS.Size(); index++)
-                        pluginListNTS[index]->OnDirectSocketSend(&bsp);
+                    bsp.senderINetAddress = recvParams->receiverINetAddress;
+                    SendBatched(recvParams->localBoundSocket, &bsp);
                 } // thisIPFloodsConnRequest == true
 
 #if ENABLE_SECURE_HAND_SHAKE==1
@@ -1248,10 +1574,8 @@ void network_application_t::OnConnectionRequest2(recv_params_t* recvParams,
                 bsp.data = toClientReplay2Writer.char_data();
                 bsp.length = toClientReplay2Writer.get_written_bytes();
                 bsp.receiverINetAddress = recvParams->senderINetAddress;
-                recvParams->localBoundSocket->Send(&bsp, TRACKE_MALLOC);
-
-                for (index = 0; index < pluginListNTS.Size(); index++)
-                    pluginListNTS[index]->OnDirectSocketSend(&bsp);
+                bsp.senderINetAddress = recvParams->receiverINetAddress;
+                SendBatched(recvParams->localBoundSocket, &bsp);
 
             }  // 	CanAcceptIncomingConnection() == true
         } // outcome == 0
@@ -1291,6 +1615,7 @@ void network_application_t::OnConnectionRequest1(recv_params_t* recvParams,
             data2send.data = writer.char_data();
             data2send.length = writer.get_written_bytes();
             data2send.receiverINetAddress = recvParams->senderINetAddress;
+            data2send.senderINetAddress = recvParams->receiverINetAddress;
 
             /// we do not need test 10040 error because it is only 24 bytes length
             /// impossible to exceed the max mtu
@@ -1340,9 +1665,10 @@ void network_application_t::OnConnectionRequest1(recv_params_t* recvParams,
             // because the size clients send us is hardcoded as
             // bitStream.pad_zeros_up_to(mtuSizes[MTUSizeIndex] -
             // UDP_HEADER_SIZE);  see connect() for details
+            ushort maxMTUSize = recvParams->localBoundSocket->GetMaxMTUSize();
             ushort newClientMTU =
-                (recvParams->bytesRead + UDP_HEADER_SIZE >= MAXIMUM_MTU_SIZE) ?
-            MAXIMUM_MTU_SIZE :
+                (recvParams->bytesRead + UDP_HEADER_SIZE >= maxMTUSize) ?
+            maxMTUSize :
                              recvParams->bytesRead + UDP_HEADER_SIZE;
             writer.WriteMini(newClientMTU);
             std::cout << "AUDIT: server WriteMini(newClientMTU)" << newClientMTU
@@ -1358,8 +1684,9 @@ void network_application_t::OnConnectionRequest1(recv_params_t* recvParams,
             bsp.data = writer.char_data();
             bsp.length = writer.get_written_bytes();
             bsp.receiverINetAddress = recvParams->senderINetAddress;
+            bsp.senderINetAddress = recvParams->receiverINetAddress;
 
-            // this send will never return 10040 error because bsp.length must be <= MAXIMUM_MTU_SIZE
+            // this send will never return 10040 error because bsp.length must be <= maxMTUSize
             if (recvParams->localBoundSocket->Send(&bsp, TRACKE_MALLOC) > 0)
             {
                 for (index = 0; index < pluginListNTS.Size(); index++)
@@ -1519,12 +1846,17 @@ void network_application_t::OnConnectionReply1(recv_params_t* recvParams,
                 toServerWriter.WriteMini(myGuid);
                 std::cout << "client WriteMini(myGuid) " << myGuid.g
                     << " to server ";
+#if GECO_ENABLE_SHM_TRANSPORT == 1
+                toServerWriter.Write(myHostId);
+#endif
 
                 send_params_t outcome_data;
                 outcome_data.data = toServerWriter.char_data();
                 outcome_data.length = toServerWriter.get_written_bytes();
                 outcome_data.receiverINetAddress =
                     recvParams->senderINetAddress;
+                outcome_data.senderINetAddress =
+                    recvParams->receiverINetAddress;
                 recvParams->localBoundSocket->Send(&outcome_data, TRACKE_MALLOC
                     );
 
@@ -1567,6 +1899,10 @@ void network_application_t::OnConnectionReply2(recv_params_t* recvParams,
         bs.Read(ourOwnBoundAddEchoFromServer);
         bs.Read(mtu);
         bs.ReadMini(clientSecureRequiredbyServer);
+        ulonglong hostId = 0;
+#if GECO_ENABLE_SHM_TRANSPORT == 1
+        bs.Read(hostId);
+#endif
 
 #if ENABLE_SECURE_HAND_SHAKE==1
         char answer[cat::EasyHandshake::ANSWER_BYTES];
@@ -1637,6 +1973,8 @@ void network_application_t::OnConnectionReply2(recv_params_t* recvParams,
                         thisIPFloodsConnRequest, mtu,
                         ourOwnBoundAddEchoFromServer, guid,
                         clientSecureRequiredbyServer);
+                    if (free_rs != 0)
+                        free_rs->sameHost = IsSameHost(recvParams->senderINetAddress, hostId);
                 }
 
                 // 4/13/09 Attackers can flood ID_OPEN_CONNECTION_REQUEST and use up all available connection slots
@@ -1908,11 +2246,24 @@ void network_application_t::ProcessConnectionRequestQ(TimeUS& timeUS,
                 connReq->nextRequestTime = timeMS
                     + connReq->connAttemptIntervalMS;
 
+                /// first round pads up to what our socket takes, jumbo frames on a lan
+                int requestMTU = MTUSizeIndex == 0 ?
+                    connReq->socket->GetMaxMTUSize() : mtuSizes[MTUSizeIndex];
+#if GECO_ENABLE_PLPMTUD == 1
+                /// first round goes straight to the size the path to this network took last time
+                if (MTUSizeIndex == 0)
+                {
+                    ushort cachedMTU = GetCachedPathMtu(connReq->receiverAddr, timeMS);
+                    if (cachedMTU != 0 && cachedMTU < requestMTU)
+                        requestMTU = cachedMTU;
+                }
+#endif
+
                 geco_bit_stream_t bitStream;
                 bitStream.Write(ID_OPEN_CONNECTION_REQUEST_1);
                 bitStream.Write(OFFLINE_MESSAGE_DATA_ID, sizeof(OFFLINE_MESSAGE_DATA_ID));
                 bitStream.Write((msg_id_t)JACKIE_INET_PROTOCOL_VERSION);
-                bitStream.pad_zeros_up_to(mtuSizes[MTUSizeIndex] - UDP_HEADER_SIZE);
+                bitStream.pad_zeros_up_to(requestMTU - UDP_HEADER_SIZE);
                 //bitStream.pad_zeros_up_to(3000 -
                 //	UDP_HEADER_SIZE); //will trigger 10040 recvfrom
 
@@ -1930,7 +2281,7 @@ void network_application_t::ProcessConnectionRequestQ(TimeUS& timeUS,
 #endif
                 Time sendToStart = GetTimeMS();
                 if (connReq->socket->Send(&jsp, TRACKE_MALLOC) < 0
-                    && jsp.bytesWritten == 10040)
+                    && (jsp.bytesWritten == 10040 || jsp.bytesWritten == EMSGSIZE))
                 {
                     // MessageId: WSAEMSGSIZE
                     // MessageText:
@@ -2016,7 +2367,18 @@ void network_application_t::ProcessAllocCommandQ(TimeUS& timeUS, TimeMS& timeMS)
                     remoteEndPoint = GetRemoteSystem(cmd->systemIdentifier, true,
                         true);
                     if (remoteEndPoint != 0)
+                    {
                         remoteEndPoint->connectMode = cmd->repStatus;
+#if GECO_ENABLE_PEER_SOCKETS == 1
+                        if (cmd->repStatus == remote_system_t::CONNECTED)
+                        {
+#if GECO_ENABLE_SHM_TRANSPORT == 1
+                            if (!OpenShmChannel(remoteEndPoint))
+#endif
+                                OpenPeerSocket(remoteEndPoint);
+                        }
+#endif
+                    }
                 }
                 break;
             case cmd_t::BCS_CLOSE_CONNECTION:
@@ -2065,6 +2427,10 @@ void network_application_t::ProcessAllocCommandQ(TimeUS& timeUS, TimeMS& timeMS)
                     timeout, extraData);
             }
             break;
+            case cmd_t::BCS_MULTICAST_SEND:
+                SendMulticastNow(cmd);
+                gFreeEx(cmd->data, TRACKE_MALLOC);
+                break;
             default:
                 std::cout << "Not Found Matched BufferedCommand";
                 break;
@@ -2110,112 +2476,537 @@ void network_application_t::ProcessAllocJISRecvParamsQ(void)
             bool ret = allocRecvParamQ[outter].PopHead(recvParams);
             assert(ret == true);
             ProcessOneRecvParam(recvParams);
-            ReclaimOneJISRecvParams(recvParams, inner);
+            ReclaimOneJISRecvParams(recvParams, outter);
         }
+#if GECO_ENABLE_PEER_SOCKETS == 1
+        if (JISPeerSockets[outter].retired.Size() > 0)
+            FreeRetiredPeerSockets(outter, false);
+#endif
     }
 }
 
-/// @TO-DO
-void network_application_t::AdjustTimestamp(network_packet_t*& incomePacket) const
+void network_application_t::SendBatched(network_socket_t* sock, send_params_t* sendParams)
 {
-    //std::cout << "@TO-DO AdjustTimestamp()";
-
-    if ((unsigned char)incomePacket->data[0] == ID_TIMESTAMP)
+    if (!sock->IsBerkleySocket())
     {
-        if (incomePacket->length >= sizeof(char) + sizeof(Time))
+        if (sock->Send(sendParams, TRACKE_MALLOC) > 0)
         {
-            char* data = (char*)&incomePacket->data[sizeof(char)];
-            //#ifdef _DEBUG
-            //				RakAssert(IsActive());
-            //				RakAssert(data);
-            //#endif
-            //
-            //				RakNet::BitStream timeBS(data, sizeof(RakNet::Time), false);
-            //				timeBS.EndianSwapBytes(0, sizeof(RakNet::Time));
-            //				RakNet::Time encodedTimestamp;
-            //				timeBS.Read(encodedTimestamp);
-            //
-            //				encodedTimestamp = encodedTimestamp - GetBestClockDifferential(systemAddress);
-            //				timeBS.SetWriteOffset(0);
-            //				timeBS.Write(encodedTimestamp);
+            for (uint index = 0; index < pluginListNTS.Size(); index++)
+                pluginListNTS[index]->OnDirectSocketSend(sendParams);
         }
+        return;
     }
-}
 
-const guid_t& network_application_t::GetGuidFromSystemAddress(
-    const network_address_t input) const
+    berkley_socket_t* bsock = (berkley_socket_t*)sock;
+    if (!bsock->QueueSend(sendParams))
+    {
+        FlushEgressBatch(bsock);
+        bool ret = bsock->QueueSend(sendParams);
+        assert(ret == true);
+    }
+}
+void network_application_t::SendPaced(remote_system_t* rs, send_params_t* sendParams)
 {
-    if (input == JACKIE_NULL_ADDRESS)
-        return myGuid;
-
-    if (input.systemIndex != (system_index_t)-1
-        && input.systemIndex < maxConnections
-        && remoteSystemList[input.systemIndex].systemAddress == input)
-        return remoteSystemList[input.systemIndex].guid;
+#if GECO_ENABLE_TXTIME == 1
+    if (rs->socket2use->IsBerkleySocket() && ((berkley_socket_t*)rs->socket2use)->IsTxTimeEnabled())
+        sendParams->txTime = rs->reliabilityLayer.GetPacedTxTime(sendParams->length, Get64BitsTimeUS());
+#endif
+    SendBatched(rs->socket2use, sendParams);
+}
+void network_application_t::FlushEgressBatch(berkley_socket_t* sock)
+{
+    if (sock->GetQueuedSendsSize() == 0) return;
 
-    for (unsigned int i = 0; i < maxConnections; i++)
+    sock->FlushQueuedSends(TRACKE_MALLOC);
+    for (int i = 0; i < sock->GetQueuedSendsSize(); i++)
     {
-        if (remoteSystemList[i].systemAddress == input)
+        send_params_t* sent = sock->GetQueuedSend(i);
+        if (sent->bytesWritten <= 0) continue;
+        for (uint index = 0; index < pluginListNTS.Size(); index++)
+            pluginListNTS[index]->OnDirectSocketSend(sent);
+    }
+    sock->ClearQueuedSends();
+}
+void network_application_t::FlushAllEgressBatches(void)
+{
+    for (uint index = 0; index < bindedSockets.Size(); index++)
+    {
+        if (bindedSockets[index]->IsBerkleySocket())
         {
-            // Set the systemIndex so future lookups will be fast
-            remoteSystemList[i].guid.systemIndex = (system_index_t)i;
-            return remoteSystemList[i].guid;
+            FlushEgressBatch((berkley_socket_t*)bindedSockets[index]);
+            ((berkley_socket_t*)bindedSockets[index])->ReapZeroCopyCompletions();
         }
     }
-    return JACKIE_NULL_GUID;
 }
 
-remote_system_t* network_application_t::GetRemoteSystem(const network_address_t& sa,
-    bool neededBySendThread, bool onlyWantActiveEndPoint) const
+static network_address_t GetPathMtuPrefix(const network_address_t& addr)
 {
-    if (sa == JACKIE_NULL_ADDRESS)
+    /// hosts of the same network most likely share the path, ipv4 /24 and ipv6 /64
+    network_address_t prefix = addr;
+    prefix.SetPortHostOrder(0);
+#if NET_SUPPORT_IPV6 ==1
+    if (prefix.address.addr6.sin6_family == AF_INET6)
+    {
+        memset(prefix.address.addr6.sin6_addr.s6_addr + 8, 0, 8);
+        return prefix;
+    }
+#endif
+    prefix.address.addr4.sin_addr.s_addr &= htonl(0xFFFFFF00);
+    return prefix;
+}
+ushort network_application_t::GetCachedPathMtu(const network_address_t& addr, TimeMS timeMS) const
+{
+    network_address_t prefix = GetPathMtuPrefix(addr);
+    const path_mtu_cache_t& slot = pathMtuCache[network_address_t::ToHashCode(prefix)
+        & (GECO_PLPMTUD_CACHE_SIZE - 1)];
+    if (slot.mtu == 0 || slot.prefix != prefix
+        || timeMS - slot.updateTime > GECO_PLPMTUD_CACHE_TIMEOUT_MS)
         return 0;
-
-    if (neededBySendThread)
+    return slot.mtu;
+}
+void network_application_t::CachePathMtu(const network_address_t& addr, ushort mtu, TimeMS timeMS)
+{
+    network_address_t prefix = GetPathMtuPrefix(addr);
+    /// direct mapped, the latest prefix wins a colliding slot
+    path_mtu_cache_t& slot = pathMtuCache[network_address_t::ToHashCode(prefix)
+        & (GECO_PLPMTUD_CACHE_SIZE - 1)];
+    slot.prefix = prefix;
+    slot.mtu = mtu;
+    slot.updateTime = timeMS;
+}
+void network_application_t::ResetPathMtu(remote_system_t* rs, TimeMS timeMS)
+{
+    /// handshake padding already made it, search upwards from there
+    rs->pathMtu.base = (ushort)rs->MTUSize;
+    rs->pathMtu.confirmed = (ushort)rs->MTUSize;
+    rs->pathMtu.tooBig = rs->socket2use->GetMaxMTUSize() + 1;
+    rs->pathMtu.probing = 0;
+    rs->pathMtu.probesLost = 0;
+    rs->pathMtu.finished = false;
+    rs->pathMtu.nextProbeTime = timeMS;
+    rs->reliabilityLayer.SetPathMtuBase(rs->pathMtu.base);
+
+    ushort cachedMTU = GetCachedPathMtu(rs->systemAddress, timeMS);
+    if (cachedMTU > rs->pathMtu.confirmed)
     {
-        int index = GetRemoteSystemIndex(sa);
-        if (index != -1)
-        {
-            if (!onlyWantActiveEndPoint || remoteSystemList[index].isActive)
-            {
-                assert(remoteSystemList[index].systemAddress == sa);
-                return &remoteSystemList[index];
-            }
-        }
+        /// another connection to this network got further, try its size first
+        rs->pathMtu.probing = cachedMTU;
+        rs->pathMtu.nextProbeTime = timeMS + GECO_PLPMTUD_PROBE_TIMEOUT_MS;
+        SendPathMtuProbe(rs, cachedMTU);
     }
-    else
+    else if (cachedMTU < rs->pathMtu.confirmed)
     {
-        /// Active EndPoints take priority.  But if matched end point is inactice,
-        /// return the first EndPoint match found
-        int inActiveEndPointIndex = -1;
-        for (uint index = 0; index < maxConnections; index++)
+        CachePathMtu(rs->systemAddress, rs->pathMtu.confirmed, timeMS);
+    }
+}
+void network_application_t::SendPathMtuProbe(remote_system_t* rs, ushort size)
+{
+    /// retries of one size share the nonce so a slow reply to an earlier one still counts
+    if (rs->pathMtu.probesLost == 0)
+        rs->pathMtu.nonce = rnr.RandomMT();
+
+    geco_bit_stream_t bitStream;
+    bitStream.Write((msg_id_t)ID_PATH_MTU_PROBE);
+    bitStream.Write(OFFLINE_MESSAGE_DATA_ID, sizeof(OFFLINE_MESSAGE_DATA_ID));
+    bitStream.Write(size);
+    bitStream.Write(rs->pathMtu.nonce);
+    bitStream.pad_zeros_up_to(size - UDP_HEADER_SIZE);
+
+    send_params_t jsp;
+    jsp.data = bitStream.char_data();
+    jsp.length = bitStream.get_written_bytes();
+    jsp.receiverINetAddress = rs->systemAddress;
+    jsp.senderINetAddress = rs->address2use;
+    SendPaced(rs, &jsp);
+}
+void network_application_t::UpdatePathMtu(TimeMS timeMS)
+{
+    remote_system_t* rs;
+    for (uint i = 0; i < activeSystemListSize; i++)
+    {
+        rs = activeSystemList[i];
+        /// not yet connected or being disconnected
+        if (!rs->isActive || rs->connectMode < remote_system_t::REQUESTED_CONNECTION)
+            continue;
+        if (rs->MTUSize > rs->pathMtu.base &&
+            rs->reliabilityLayer.GetBigTimeouts() >= GECO_PLPMTUD_BLACK_HOLE_TIMEOUTS)
+            OnPathMtuBlackHole(rs, timeMS);
+        if ((int)(timeMS - rs->pathMtu.nextProbeTime) < 0)
+            continue;
+
+        if (rs->pathMtu.probing != 0)
         {
-            if (remoteSystemList[index].systemAddress == sa)
+            /// no reply in time, a few losses in a row mean it does not fit the path
+            if (++rs->pathMtu.probesLost >= GECO_PLPMTUD_MAX_PROBES)
             {
-                if (remoteSystemList[index].isActive)
-                    return &remoteSystemList[index];
-                else if (inActiveEndPointIndex == -1)
-                    inActiveEndPointIndex = index;
+                rs->pathMtu.tooBig = rs->pathMtu.probing;
+                rs->pathMtu.probing = 0;
+                rs->pathMtu.probesLost = 0;
             }
         }
+        else if (rs->pathMtu.finished)
+        {
+            /// path may have grown since last search
+            rs->pathMtu.finished = false;
+            rs->pathMtu.tooBig = rs->socket2use->GetMaxMTUSize() + 1;
+        }
 
-        /// matched end pint was found but it is inactive
-        if (inActiveEndPointIndex != -1 && !onlyWantActiveEndPoint)
-            return &remoteSystemList[inActiveEndPointIndex];
-    }
+        if (rs->pathMtu.tooBig - rs->pathMtu.confirmed <= GECO_PLPMTUD_SEARCH_GRANULARITY)
+        {
+            rs->pathMtu.finished = true;
+            rs->pathMtu.nextProbeTime = timeMS + GECO_PLPMTUD_RAISE_INTERVAL_MS;
+            continue;
+        }
 
-    // no matched end point found
-    return 0;
+        if (rs->pathMtu.probing == 0)
+            rs->pathMtu.probing = (ushort)((rs->pathMtu.confirmed + rs->pathMtu.tooBig) / 2);
+        rs->pathMtu.nextProbeTime = timeMS + GECO_PLPMTUD_PROBE_TIMEOUT_MS;
+        SendPathMtuProbe(rs, rs->pathMtu.probing);
+    }
 }
-remote_system_t* network_application_t::GetRemoteSystem(
-    const guid_address_wrapper_t& senderWrapper, bool neededBySendThread,
-    bool onlyWantActiveEndPoint) const
+void network_application_t::OnPathMtuBlackHole(remote_system_t* rs, TimeMS timeMS)
 {
-    if (senderWrapper.guid != JACKIE_NULL_GUID)
-        return GetRemoteSystem(senderWrapper.guid, onlyWantActiveEndPoint);
-    else
-        return GetRemoteSystem(senderWrapper.systemAddress, neededBySendThread,
-        onlyWantActiveEndPoint);
+    /// the size that vanished is the new upper bound, the probes find what still fits
+    rs->pathMtu.tooBig = (ushort)rs->MTUSize;
+    rs->pathMtu.confirmed = rs->pathMtu.base;
+    rs->pathMtu.probing = 0;
+    rs->pathMtu.probesLost = 0;
+    rs->pathMtu.finished = false;
+    rs->pathMtu.nextProbeTime = timeMS;
+    rs->MTUSize = rs->pathMtu.base;
+    rs->reliabilityLayer.SetPathMtuBase(rs->pathMtu.base);
+
+    /// new connections to this network must not start at the size that vanished
+    network_address_t prefix = GetPathMtuPrefix(rs->systemAddress);
+    path_mtu_cache_t& slot = pathMtuCache[network_address_t::ToHashCode(prefix)
+        & (GECO_PLPMTUD_CACHE_SIZE - 1)];
+    if (slot.prefix == prefix) slot.mtu = 0;
+}
+void network_application_t::OnPathMtuProbe(recv_params_t* recvParams,
+    bool* isOfflinerecvParams)
+{
+    if (recvParams->bytesRead >= sizeof(msg_id_t)
+        + sizeof(OFFLINE_MESSAGE_DATA_ID) + sizeof(ushort) + sizeof(uint))
+    {
+        *isOfflinerecvParams = memcmp(recvParams->data + sizeof(msg_id_t),
+            OFFLINE_MESSAGE_DATA_ID, sizeof(OFFLINE_MESSAGE_DATA_ID)) == 0;
+    }
+    if (!*isOfflinerecvParams) return;
+
+    for (index = 0; index < pluginListNTS.Size(); index++)
+        pluginListNTS[index]->OnDirectSocketReceive(recvParams);
+
+    /// only answer systems we are connected with, the reply is small anyway
+    if (GetRemoteSystem(recvParams->senderINetAddress, true, true) == 0)
+        return;
+
+    geco_bit_stream_t reader((uchar*)recvParams->data, recvParams->bytesRead);
+    reader.skip_read_bytes(sizeof(msg_id_t));
+    reader.skip_read_bytes(sizeof(OFFLINE_MESSAGE_DATA_ID));
+    ushort size;
+    reader.Read(size);
+    uint nonce;
+    reader.Read(nonce);
+    /// confirm only what really came in one piece
+    if (recvParams->bytesRead + UDP_HEADER_SIZE < size)
+        return;
+
+    geco_bit_stream_t writer;
+    writer.Write((msg_id_t)ID_PATH_MTU_PROBE_REPLY);
+    writer.Write(OFFLINE_MESSAGE_DATA_ID, sizeof(OFFLINE_MESSAGE_DATA_ID));
+    writer.Write(size);
+    writer.Write(nonce);
+
+    send_params_t bsp;
+    bsp.data = writer.char_data();
+    bsp.length = writer.get_written_bytes();
+    bsp.receiverINetAddress = recvParams->senderINetAddress;
+    bsp.senderINetAddress = recvParams->receiverINetAddress;
+    SendBatched(recvParams->localBoundSocket, &bsp);
+}
+void network_application_t::OnPathMtuProbeReply(recv_params_t* recvParams,
+    bool* isOfflinerecvParams)
+{
+    if (recvParams->bytesRead >= sizeof(msg_id_t)
+        + sizeof(OFFLINE_MESSAGE_DATA_ID) + sizeof(ushort) + sizeof(uint))
+    {
+        *isOfflinerecvParams = memcmp(recvParams->data + sizeof(msg_id_t),
+            OFFLINE_MESSAGE_DATA_ID, sizeof(OFFLINE_MESSAGE_DATA_ID)) == 0;
+    }
+    if (!*isOfflinerecvParams) return;
+
+    for (index = 0; index < pluginListNTS.Size(); index++)
+        pluginListNTS[index]->OnDirectSocketReceive(recvParams);
+
+    remote_system_t* rs = GetRemoteSystem(recvParams->senderINetAddress, true, true);
+    if (rs == 0) return;
+
+    geco_bit_stream_t reader((uchar*)recvParams->data, recvParams->bytesRead);
+    reader.skip_read_bytes(sizeof(msg_id_t));
+    reader.skip_read_bytes(sizeof(OFFLINE_MESSAGE_DATA_ID));
+    ushort size;
+    reader.Read(size);
+    uint nonce;
+    reader.Read(nonce);
+    /// only the probe in flight counts, anyone can claim any other size
+    if (rs->pathMtu.probing == 0 || size != rs->pathMtu.probing || nonce != rs->pathMtu.nonce)
+        return;
+
+    TimeMS timeMS = Get32BitsTimeMS();
+    if (size > rs->pathMtu.confirmed)
+    {
+        rs->pathMtu.confirmed = size;
+        rs->MTUSize = size;
+        CachePathMtu(rs->systemAddress, size, timeMS);
+    }
+    /// go on with the next size in next update cycle
+    rs->pathMtu.probing = 0;
+    rs->pathMtu.probesLost = 0;
+    rs->pathMtu.nextProbeTime = timeMS;
+}
+
+network_socket_t* network_application_t::GetBindedSocket(uint userIndex) const
+{
+    for (uint i = 0; i < bindedSockets.Size(); i++)
+    {
+        if (bindedSockets[i]->GetUserConnectionSocketIndex() == userIndex)
+            return bindedSockets[i];
+    }
+    return 0;
+}
+bool network_application_t::JoinMulticastGroup(const network_address_t& group, uint socketIndex)
+{
+    /// every socket of a SO_REUSEPORT fan-out may be handed the group's datagrams
+    bool ret = false;
+    for (uint i = 0; i < bindedSockets.Size(); i++)
+    {
+        if (bindedSockets[i]->GetUserConnectionSocketIndex() != socketIndex
+            || !bindedSockets[i]->IsBerkleySocket())
+            continue;
+        if (!((berkley_socket_t*)bindedSockets[i])->JoinMulticastGroup(group))
+            return false;
+        ret = true;
+    }
+    return ret;
+}
+bool network_application_t::LeaveMulticastGroup(const network_address_t& group, uint socketIndex)
+{
+    bool ret = false;
+    for (uint i = 0; i < bindedSockets.Size(); i++)
+    {
+        if (bindedSockets[i]->GetUserConnectionSocketIndex() == socketIndex
+            && bindedSockets[i]->IsBerkleySocket()
+            && ((berkley_socket_t*)bindedSockets[i])->LeaveMulticastGroup(group))
+            ret = true;
+    }
+    return ret;
+}
+bool network_application_t::SendMulticast(const char *data, uint length,
+    packet_reliability_t reliability, const network_address_t& group, uint socketIndex)
+{
+    if (data == 0 || length == 0 || GetBindedSocket(socketIndex) == 0) return false;
+    if (reliability != UNRELIABLE_NOT_ACK_RECEIPT_OF_PACKET
+        && reliability != UNRELIABLE_SEQUENCED_NOT_ACK_RECEIPT_OF_PACKET)
+        return false;
+
+    cmd_t* c = alloc_cmd();
+    c->commandID = cmd_t::BCS_MULTICAST_SEND;
+    c->systemIdentifier.systemAddress = group;
+    c->data = (char*)gMallocEx(length, TRACKE_MALLOC);
+    memcpy(c->data, data, length);
+    c->numberOfBitsToSend = BYTES_TO_BITS(length);
+    c->reliability = reliability;
+    c->connectionSocketIndex = socketIndex;
+    run_cmd(c);
+    return true;
+}
+void network_application_t::SendMulticastNow(cmd_t* cmd)
+{
+    geco_bit_stream_t bitStream;
+    bitStream.Write((msg_id_t)ID_MULTICAST_DATA);
+    bitStream.Write(OFFLINE_MESSAGE_DATA_ID, sizeof(OFFLINE_MESSAGE_DATA_ID));
+    bitStream.Write(myGuid);
+    bitStream.Write(cmd->systemIdentifier.systemAddress);
+    bitStream.Write((uchar)cmd->reliability);
+    bitStream.Write(multicastSequence++);
+    bitStream.Write(cmd->data, BITS_TO_BYTES(cmd->numberOfBitsToSend));
+
+    network_socket_t* sock = GetBindedSocket(cmd->connectionSocketIndex);
+    if (sock == 0) return;
+    if (bitStream.get_written_bytes() > sock->GetMaxMTUSize())
+    {
+        fprintf(stderr, "network_application_t::SendMulticastNow()::drop %u bytes, bigger than max mtu of the socket\n",
+            bitStream.get_written_bytes());
+        return;
+    }
+
+    send_params_t jsp;
+    jsp.data = bitStream.char_data();
+    jsp.length = bitStream.get_written_bytes();
+    jsp.receiverINetAddress = cmd->systemIdentifier.systemAddress;
+    SendBatched(sock, &jsp);
+}
+void network_application_t::OnMulticastData(recv_params_t* recvParams,
+    bool* isOfflinerecvParams)
+{
+    if (recvParams->bytesRead >= sizeof(msg_id_t)
+        + sizeof(OFFLINE_MESSAGE_DATA_ID) + guid_t::size())
+    {
+        *isOfflinerecvParams = memcmp(recvParams->data + sizeof(msg_id_t),
+            OFFLINE_MESSAGE_DATA_ID, sizeof(OFFLINE_MESSAGE_DATA_ID)) == 0;
+    }
+    if (!*isOfflinerecvParams) return;
+
+    for (index = 0; index < pluginListNTS.Size(); index++)
+        pluginListNTS[index]->OnDirectSocketReceive(recvParams);
+
+    /// only datagrams really sent to a group this socket joined, not unicast ones claiming
+    /// to be multicast. without pktinfo the socket is bound to the addr they were sent to
+    if (!recvParams->localBoundSocket->IsBerkleySocket()) return;
+    berkley_socket_t* bsock = (berkley_socket_t*)recvParams->localBoundSocket;
+    const network_address_t& dest = bsock->IsPktInfoEnabled() ?
+        recvParams->receiverINetAddress : bsock->GetBoundAddress();
+    if (!bsock->IsMulticastMember(dest)) return;
+
+    geco_bit_stream_t reader((uchar*)recvParams->data, recvParams->bytesRead);
+    reader.skip_read_bytes(sizeof(msg_id_t));
+    reader.skip_read_bytes(sizeof(OFFLINE_MESSAGE_DATA_ID));
+    guid_t guid;
+    network_address_t group;
+    uchar reliability;
+    uint sequence;
+    reader.Read(guid);
+    reader.Read(group);
+    reader.Read(reliability);
+    reader.Read(sequence);
+
+    /// our own datagram looped back, one too short to carry any user data,
+    /// or one naming another group than it was sent to
+    uint offset = BITS_TO_BYTES(reader.readable_bit_pos());
+    if (guid == myGuid || offset >= (uint)recvParams->bytesRead || !group.EqualsExcludingPort(dest)) return;
+
+    if (reliability == UNRELIABLE_SEQUENCED_NOT_ACK_RECEIPT_OF_PACKET)
+    {
+        multicast_sender_t& slot = multicastSenders[(guid_t::ToUInt32(guid)
+            ^ network_address_t::ToHashCode(group)) & (GECO_MULTICAST_SENDERS_SIZE - 1)];
+        if (slot.guid == guid && slot.group == group && (int)(sequence - slot.sequence) <= 0)
+            return;
+        /// direct mapped, the latest sender wins a colliding slot
+        slot.guid = guid;
+        slot.group = group;
+        slot.sequence = sequence;
+    }
+
+    uint length = recvParams->bytesRead - offset;
+    network_packet_t* packet = AllocPacket(length);
+    memcpy(packet->data, recvParams->data + offset, length);
+    packet->systemAddress = recvParams->senderINetAddress;
+    packet->guid = guid;
+    bool ret = allocPacketQ.PushTail(packet);
+    assert(ret == true);
+}
+
+/// @TO-DO
+void network_application_t::AdjustTimestamp(network_packet_t*& incomePacket) const
+{
+    //std::cout << "@TO-DO AdjustTimestamp()";
+
+    if ((unsigned char)incomePacket->data[0] == ID_TIMESTAMP)
+    {
+        if (incomePacket->length >= sizeof(char) + sizeof(Time))
+        {
+            char* data = (char*)&incomePacket->data[sizeof(char)];
+            //#ifdef _DEBUG
+            //				RakAssert(IsActive());
+            //				RakAssert(data);
+            //#endif
+            //
+            //				RakNet::BitStream timeBS(data, sizeof(RakNet::Time), false);
+            //				timeBS.EndianSwapBytes(0, sizeof(RakNet::Time));
+            //				RakNet::Time encodedTimestamp;
+            //				timeBS.Read(encodedTimestamp);
+            //
+            //				encodedTimestamp = encodedTimestamp - GetBestClockDifferential(systemAddress);
+            //				timeBS.SetWriteOffset(0);
+            //				timeBS.Write(encodedTimestamp);
+        }
+    }
+}
+
+const guid_t& network_application_t::GetGuidFromSystemAddress(
+    const network_address_t input) const
+{
+    if (input == JACKIE_NULL_ADDRESS)
+        return myGuid;
+
+    if (input.systemIndex != (system_index_t)-1
+        && input.systemIndex < maxConnections
+        && remoteSystemList[input.systemIndex].systemAddress == input)
+        return remoteSystemList[input.systemIndex].guid;
+
+    for (unsigned int i = 0; i < maxConnections; i++)
+    {
+        if (remoteSystemList[i].systemAddress == input)
+        {
+            // Set the systemIndex so future lookups will be fast
+            remoteSystemList[i].guid.systemIndex = (system_index_t)i;
+            return remoteSystemList[i].guid;
+        }
+    }
+    return JACKIE_NULL_GUID;
+}
+
+remote_system_t* network_application_t::GetRemoteSystem(const network_address_t& sa,
+    bool neededBySendThread, bool onlyWantActiveEndPoint) const
+{
+    if (sa == JACKIE_NULL_ADDRESS)
+        return 0;
+
+    if (neededBySendThread)
+    {
+        int index = GetRemoteSystemIndex(sa);
+        if (index != -1)
+        {
+            if (!onlyWantActiveEndPoint || remoteSystemList[index].isActive)
+            {
+                assert(remoteSystemList[index].systemAddress == sa);
+                return &remoteSystemList[index];
+            }
+        }
+    }
+    else
+    {
+        /// Active EndPoints take priority.  But if matched end point is inactice,
+        /// return the first EndPoint match found
+        int inActiveEndPointIndex = -1;
+        for (uint index = 0; index < maxConnections; index++)
+        {
+            if (remoteSystemList[index].systemAddress == sa)
+            {
+                if (remoteSystemList[index].isActive)
+                    return &remoteSystemList[index];
+                else if (inActiveEndPointIndex == -1)
+                    inActiveEndPointIndex = index;
+            }
+        }
+
+        /// matched end pint was found but it is inactive
+        if (inActiveEndPointIndex != -1 && !onlyWantActiveEndPoint)
+            return &remoteSystemList[inActiveEndPointIndex];
+    }
+
+    // no matched end point found
+    return 0;
+}
+remote_system_t* network_application_t::GetRemoteSystem(
+    const guid_address_wrapper_t& senderWrapper, bool neededBySendThread,
+    bool onlyWantActiveEndPoint) const
+{
+    if (senderWrapper.guid != JACKIE_NULL_GUID)
+        return GetRemoteSystem(senderWrapper.guid, onlyWantActiveEndPoint);
+    else
+        return GetRemoteSystem(senderWrapper.systemAddress, neededBySendThread,
+        onlyWantActiveEndPoint);
 }
 remote_system_t* network_application_t::GetRemoteSystem(
     const guid_t& senderGUID, bool onlyWantActiveEndPoint) const
@@ -2348,8 +3139,18 @@ void network_application_t::DeRefRemoteSystem(const network_address_t &sa)
 bool network_application_t::SendRightNow(TimeUS currentTime, bool useCallerAlloc,
     cmd_t* bufferedCommand)
 {
-    std::cout << "@TO-DO::SendRightNow()";
-    return true;
+    reliable_send_params_t sendParams;
+    sendParams.data = bufferedCommand->data;
+    sendParams.bitsSize = bufferedCommand->numberOfBitsToSend;
+    sendParams.broadcast = bufferedCommand->broadcast;
+    sendParams.sendPriority = (packet_send_priority_t)bufferedCommand->priority;
+    sendParams.packetReliability = bufferedCommand->reliability;
+    sendParams.orderingChannel = bufferedCommand->orderingChannel;
+    sendParams.receiverAdress = bufferedCommand->systemIdentifier;
+    sendParams.currentTime = currentTime;
+    sendParams.receipt = bufferedCommand->receipt;
+    sendParams.useCallerDataAllocation = useCallerAlloc;
+    return SendImmediate(sendParams);
 }
 //@TO-DO
 void network_application_t::CloseConnectionInternally(
@@ -2583,12 +3384,144 @@ network_packet_t* network_application_t::fetch_packet(void)
 #endif
 
 #if USE_SINGLE_THREAD != 0
-    RunRecvCycleOnce(0);
-    RunNetworkUpdateCycleOnce();
+    poll_once(GECO_POLL_ONCE_BUDGET);
 #endif
 
     return RunGetPacketCycleOnce();
 }
+#if USE_SINGLE_THREAD != 0
+uint network_application_t::get_poll_fds(socket_fd_t* fds, uint size) const
+{
+    uint count = 0;
+    socket_fd_t fd;
+    for (uint index = 0; index < bindedSockets.Size(); index++)
+    {
+        if (!bindedSockets[index]->IsBerkleySocket()) continue;
+        fd = ((berkley_socket_t*)bindedSockets[index])->GetPollFd();
+        if (fd != INVALID_SOCKET)
+        {
+            if (count < size) fds[count] = fd;
+            count++;
+        }
+#if GECO_ENABLE_PEER_SOCKETS == 1
+        peer_sockets_t& peers = JISPeerSockets[index];
+        for (uint i = 0; i < peers.sockets.Size(); i++)
+        {
+            fd = peers.sockets[i]->GetPollFd();
+            if (fd == INVALID_SOCKET) continue;
+            if (count < size) fds[count] = fd;
+            count++;
+        }
+#endif
+    }
+    return count;
+}
+TimeMS network_application_t::next_deadline_ms(void)
+{
+    /// commands from user calls and datagrams left by a budget cut are due now
+    if (allocCommandQ.Size() > 0) return 0;
+    for (uint index = 0; index < bindedSockets.Size(); index++)
+    {
+        if (allocRecvParamQ[index].Size() > 0) return 0;
+    }
+
+    TimeMS timeMS = Get32BitsTimeMS();
+    TimeMS wait = GECO_EVENT_LOOP_MAX_WAIT_MS;
+    int left;
+
+    connReqQLock.Lock();
+    for (uint i = 0; i < connReqQ.Size(); i++)
+    {
+        left = (int)((TimeMS)connReqQ[i]->nextRequestTime - timeMS);
+        if (left < (int)wait) wait = left > 0 ? left : 0;
+    }
+    connReqQLock.Unlock();
+
+    remote_system_t* rs;
+    TimeUS timeUS = Get64BitsTimeUS();
+    TimeUS sendTime, rtoTime;
+    for (uint i = 0; i < activeSystemListSize; i++)
+    {
+        rs = activeSystemList[i];
+        if (!rs->isActive) continue;
+        /// buffered messages wait for aggregation at most this long. with a full
+        /// window nothing goes out before an ack comes in or the oldest datagram
+        /// in flight times out, so its rto is a deadline of its own
+        sendTime = rs->reliabilityLayer.GetNextSendTime();
+        rtoTime = rs->reliabilityLayer.GetRetransmissionTime();
+        if (rtoTime != 0 && (sendTime == 0 || rtoTime < sendTime)) sendTime = rtoTime;
+        if (sendTime != 0)
+        {
+            left = sendTime <= timeUS ? 0 : (int)((sendTime - timeUS + 999) / 1000);
+            if (left < (int)wait) wait = left;
+        }
+#if GECO_ENABLE_PLPMTUD == 1
+        if (rs->connectMode < remote_system_t::REQUESTED_CONNECTION)
+            continue;
+        left = (int)(rs->pathMtu.nextProbeTime - timeMS);
+        if (left < (int)wait) wait = left > 0 ? left : 0;
+#endif
+    }
+
+    for (uint index = 0; index < bindedSockets.Size(); index++)
+    {
+        /// nothing to wait on for a virtual socket, look at it every ms
+        if (bindedSockets[index]->IsBerkleySocket() && wait > 1 &&
+            ((berkley_socket_t*)bindedSockets[index])->GetPollFd() == INVALID_SOCKET)
+            wait = 1;
+#if GECO_ENABLE_SHM_TRANSPORT == 1
+        /// caller is about to block, have shm senders ring the doorbell on our udp socket
+        peer_sockets_t& peers = JISPeerSockets[index];
+        for (uint i = 0; i < peers.sockets.Size(); i++)
+        {
+            shm_transceiver_t* channel = peers.sockets[i]->GetShmChannel();
+            if (channel != 0 && !channel->ArmDoorbell()) wait = 0;
+        }
+#endif
+    }
+    return wait;
+}
+int network_application_t::poll_once(uint budget)
+{
+    if (budget == 0) budget = GECO_POLL_ONCE_BUDGET;
+    uint size = bindedSockets.Size();
+    int total = 0;
+    int got, result;
+    do
+    {
+        /// a full recv ring stops a socket early, network update below empties it
+        got = 0;
+        /// one batch per socket per round until all are drained or budget is used up.
+        /// drained ones are skipped for the rest of the call, beyond 64 they are just asked again
+        ulonglong drained = 0;
+        bool more = true;
+        while (more && (uint)(total + got) < budget)
+        {
+            more = false;
+            for (uint n = 0; n < size && (uint)(total + got) < budget; n++)
+            {
+                uint index = (pollOnceIndex + n) % size;
+                if (index < 64 && (drained & (1ULL << index)) != 0) continue;
+                if ((result = RunRecvCycleOnce(index)) > 0)
+                {
+                    got += result;
+                    more = true;
+                }
+                else if (index < 64)
+                {
+                    drained |= 1ULL << index;
+                }
+            }
+        }
+        /// whoever was cut off by the budget goes first next time
+        if (size > 0) pollOnceIndex = (pollOnceIndex + 1) % size;
+        total += got;
+        /// runs even if nothing came in, timers may be due
+        RunNetworkUpdateCycleOnce();
+    } while (got > 0 && (uint)total < budget);
+    return total;
+}
+#endif
 network_packet_t* network_application_t::RunGetPacketCycleOnce(void)
 {
     ReclaimAllCommands();
@@ -2668,28 +3601,187 @@ void network_application_t::RunNetworkUpdateCycleOnce(void)
     /// Cancel certain conn req before process Connection Request Q
     ProcessConnectionRequestCancelQ();
     ProcessConnectionRequestQ(timeUS, timeMS);
+
+#if GECO_ENABLE_PLPMTUD == 1
+    if (timeMS == 0) timeMS = Get32BitsTimeMS();
+    UpdatePathMtu(timeMS);
+#endif
+
+    /// aggregate buffered user messages into datagrams
+    if (timeUS == 0) timeUS = Get64BitsTimeUS();
+    remote_system_t* rs;
+    for (uint i = 0; i < activeSystemListSize; i++)
+    {
+        rs = activeSystemList[i];
+        if (rs->isActive) rs->reliabilityLayer.Update(this, rs, timeUS);
+    }
+
+    /// send out all datagrams gathered during this cycle
+    FlushAllEgressBatches();
 }
 
-void network_application_t::RunRecvCycleOnce(uint index)
+void network_application_t::PushJISRecvParams(recv_params_t** recvParams, int count, uint index)
 {
-    //TIMED_FUNC();
-    ReclaimAllJISRecvParams(index);
-    recv_params_t* recvParams = AllocJISRecvParams(index);
-    int result = ((berkley_socket_t*)bindedSockets[index])->RecvFrom(recvParams);
-    if (result > 0)
+#if USE_SINGLE_THREAD == 0
+    bool ret = allocRecvParamQ[index].PushTail(recvParams, count);
+    assert(ret == true);
+#else
+    for (int i = 0; i < count; i++)
     {
-        bool ret = allocRecvParamQ[index].PushTail(recvParams);
+        bool ret = allocRecvParamQ[index].PushTail(recvParams[i]);
         assert(ret == true);
-        if (incomeDatagramEventHandler != 0)
+    }
+#endif
+    if (incomeDatagramEventHandler != 0)
+    {
+        for (int i = 0; i < count; i++)
         {
-            if (!incomeDatagramEventHandler(recvParams))
+            if (!incomeDatagramEventHandler(recvParams[i]))
                 std::cout << "incomeDatagramEventHandler(recvStruct) Failed.";
         }
+    }
+#if USE_SINGLE_THREAD == 0
+    if (allocRecvParamQ[index].Size() >=
+        allocRecvParamQ->Size() / 2) quitAndDataEvents.TriggerEvent();
+#endif
+}
+
+int network_application_t::RecvJISRecvParamsGRO(berkley_socket_t* sock, uint index)
+{
+    recv_params_t* heads[GECO_GRO_BATCH_SIZE];
+    for (int i = 0; i < GECO_GRO_BATCH_SIZE; i++)
+    {
+        heads[i] = AllocJISRecvParams(index);
+        do
+        {
+            heads[i]->groBuffer = JISGROBufferPool[index].Allocate();
+        } while (heads[i]->groBuffer == 0);
+        heads[i]->groBuffer->refCount = 1;
+    }
+
+    int result = sock->RecvFromGRO(heads,
+        GECO_GRO_BATCH_SIZE);
+    if (result < 0) result = 0;
+
+    /// every segment gets its own recv params pointing into the shared buffer,
+    /// the head params describes the first segment
+    recv_params_t* segments[GECO_RECV_BATCH_SIZE];
+    int segmentsSize = 0;
+    for (int i = 0; i < result; i++)
+    {
+        recv_params_t* head = heads[i];
+        recv_gro_buffer_t* groBuffer = head->groBuffer;
+        network_address_t sender = head->senderINetAddress;
+        network_address_t receiver = head->receiverINetAddress;
+        TimeUS timeRead = head->timeRead;
+        /// kernel only coalesces datagrams with the very same tos
+        uchar ecn = head->ecn;
+        int total = head->bytesRead;
+        int groSegmentSize = head->groSegmentSize;
+        int segmentSize = groSegmentSize > 0 ? groSegmentSize : total;
+
+        groBuffer->refCount = 0;
+        for (int offset = 0; offset < total; offset += segmentSize)
+        {
+            recv_params_t* segment = offset == 0 ? head : AllocJISRecvParams(index);
+            segment->data = groBuffer->data + offset;
+            segment->bytesRead = total - offset < segmentSize ? total - offset : segmentSize;
+            segment->senderINetAddress = sender;
+            segment->receiverINetAddress = receiver;
+            segment->timeRead = timeRead;
+            segment->ecn = ecn;
+            segment->groBuffer = groBuffer;
+            segment->groSegmentSize = groSegmentSize;
+            groBuffer->refCount++;
+
+            segments[segmentsSize++] = segment;
+            if (segmentsSize == GECO_RECV_BATCH_SIZE)
+            {
+                PushJISRecvParams(segments, segmentsSize, index);
+                segmentsSize = 0;
+            }
+        }
+    }
+    if (segmentsSize > 0) PushJISRecvParams(segments, segmentsSize, index);
+
+    /// unused heads give their buffers back as well
+    for (int i = result; i < GECO_GRO_BATCH_SIZE; i++)
+        ReclaimJISRecvParamsToPool(heads[i], index);
+    return result;
+}
+
+int network_application_t::RunRecvCycleOnce(uint index)
+{
+    //TIMED_FUNC();
+    ReclaimAllJISRecvParams(index);
+#if GECO_ENABLE_RXQ_OVFL == 1
+    /// grow SO_RCVBUF as soon as kernel reports drops, only this thread reads the counter
+    ((berkley_socket_t*)bindedSockets[index])->AdjustRecvBufSize(Get32BitsTimeMS());
+#endif
+
+#if GECO_ENABLE_PEER_SOCKETS == 1
+    AckRetiredPeerSockets(index);
+    if (JISPeerSockets[index].size > 0)
+        return RecvPeerSockets(index);
+#endif
+    return RecvJISRecvParams((berkley_socket_t*)bindedSockets[index], index);
+}
+
+int network_application_t::RecvJISRecvParams(berkley_socket_t* sock, uint index)
+{
+#if GECO_ENABLE_UDP_GRO == 1
+    if (sock->IsGROEnabled())
+    {
+        return RecvJISRecvParamsGRO(sock, index);
+    }
+#endif
+
+    /// never pull more out of kernel than the ring can take, a full ring means network
+    /// thread is behind and datagrams are better off waiting in socket buffer
+    JackieBytesRing<GECO_RECV_RING_SIZE>& ring = JISRecvBufferRing[index];
+    while (!ring.HasRoomFor(GECO_RECV_BATCH_SIZE, sock->GetMaxMTUSize()))
+    {
 #if USE_SINGLE_THREAD == 0
-        if (allocRecvParamQ[index].Size() >=
-            allocRecvParamQ->Size() / 2) quitAndDataEvents.TriggerEvent();
+        if (endThreads) return 0;
+        GecoSleep(1);
+        ReclaimAllJISRecvParams(index);
+#else
+        return 0;
 #endif
     }
+
+    /// alloc a whole batch of mtu sized records and let socket fill as many as the kernel
+    /// has queued with one syscall, straight into the ring
+    recv_params_t* recvParams[GECO_RECV_BATCH_SIZE];
+    for (int i = 0; i < GECO_RECV_BATCH_SIZE; i++)
+    {
+        recvParams[i] = AllocJISRecvParams(index);
+        recvParams[i]->data = ring.Allocate(sock->GetMaxMTUSize());
+        assert(recvParams[i]->data != 0);
+    }
+
+    socket_fd_t pollFd = sock->GetPollFd();
+    int result = sock->RecvFromBatch(recvParams, GECO_RECV_BATCH_SIZE);
+    if (result < 0) result = 0;
+    if (sock->GetPollFd() != pollFd) OnPollFdChanged(sock, index);
+
+    /// most datagrams are far smaller than mtu, pack them next to each other again
+    /// and give the rest of the batch back to write cursor
+    char* datas[GECO_RECV_BATCH_SIZE];
+    unsigned int sizes[GECO_RECV_BATCH_SIZE];
+    for (int i = 0; i < GECO_RECV_BATCH_SIZE; i++)
+    {
+        datas[i] = recvParams[i]->data;
+        sizes[i] = i < result ? recvParams[i]->bytesRead : 0;
+    }
+    ring.Repack(datas, sizes, GECO_RECV_BATCH_SIZE);
+    for (int i = 0; i < GECO_RECV_BATCH_SIZE; i++)
+        recvParams[i]->data = datas[i];
+
+    if (result > 0)
+    {
+        PushJISRecvParams(recvParams, result, index);
+    }
     else
     {
         //@ Remember myself
@@ -2700,14 +3792,324 @@ void network_application_t::RunRecvCycleOnce(uint index)
         /// 10040 error  will happend n such case.
         /// in this case, we have nothing to do with such case only way is to tell this guy in realistic world "man, please send smaller datagram to me"
         /// i put it here is just reminding myself and
-        if (recvParams->bytesRead == 10040)
+        if (recvParams[0]->bytesRead == 10040)
         {
             std::cout
                 << "recvfrom() return 10040 error, the remote send a bigger datagram than our  max mtu";
         }
-        JISRecvParamsPool[index].Reclaim(recvParams);
+        result = 0;
+    }
+
+    for (int i = result; i < GECO_RECV_BATCH_SIZE; i++)
+        JISRecvParamsPool[index].Reclaim(recvParams[i]);
+    return result;
+}
+
+void network_application_t::OnPollFdChanged(berkley_socket_t* sock, uint index)
+{
+    (void)sock;
+    (void)index;
+#if GECO_USE_EPOLL_REACTOR == 1
+    if (reactorEpollFd >= 0)
+    {
+        /// old fd was closed and so left the epoll set by itself
+        epoll_event ev;
+        ev.events = EPOLLIN | EPOLLET;
+        ev.data.u32 = index;
+        if (epoll_ctl(reactorEpollFd, EPOLL_CTL_ADD, sock->GetPollFd(), &ev) != 0 &&
+            (errno != EEXIST || epoll_ctl(reactorEpollFd, EPOLL_CTL_MOD, sock->GetPollFd(), &ev) != 0))
+            fprintf(stderr, "JackieApplication::OnPollFdChanged()::epoll_ctl()::failed with errno code (%d-%s)\n", errno, strerror(errno));
+    }
+#endif
+    pollFdsVersion++;
+}
+
+#if GECO_ENABLE_PEER_SOCKETS == 1
+int network_application_t::RecvPeerSockets(uint index)
+{
+    peer_sockets_t& peers = JISPeerSockets[index];
+    berkley_socket_t* shared = (berkley_socket_t*)bindedSockets[index];
+    int result = 0;
+
+    /// read them off a copy. a full recv ring waits for network thread, which must never
+    /// find the mutex held meanwhile. closed ones stay allocated until we ack them
+    /// next cycle, so the copy is good until then
+    berkley_socket_t* socks[GECO_MAX_PEER_SOCKETS];
+    uint size = 0;
+    peers.mutex.Lock();
+    for (uint i = 0; i < peers.sockets.Size() && size < GECO_MAX_PEER_SOCKETS; i++)
+        socks[size++] = peers.sockets[i];
+    peers.mutex.Unlock();
+
+    if (shared->GetBindingParams()->isNonBlocking != USE_BLOBKING_SOCKET)
+    {
+        result = RecvJISRecvParams(shared, index);
+        for (uint i = 0; i < size; i++)
+        {
+#if GECO_ENABLE_SHM_TRANSPORT == 1
+            if (socks[i]->GetShmChannel() != 0)
+            {
+                result += RecvShmChannel(socks[i], index);
+                continue;
+            }
+#endif
+            result += RecvJISRecvParams(socks[i], index);
+        }
+        return result;
+    }
+
+    /// a blocking read on shared socket would leave the peers unread, wait on all of them
+    pollfd fds[GECO_MAX_PEER_SOCKETS + 1];
+    berkley_socket_t* fdSocks[GECO_MAX_PEER_SOCKETS + 1];
+    fds[0].fd = shared->GetPollFd();
+    fds[0].events = POLLIN;
+    fds[0].revents = 0;
+    fdSocks[0] = shared;
+    uint count = 1;
+    int timeout = GECO_REACTOR_WAIT_MS;
+    for (uint i = 0; i < size; i++)
+    {
+#if GECO_ENABLE_SHM_TRANSPORT == 1
+        /// no fd, the other end sends a doorbell to the shared socket instead
+        if (socks[i]->GetShmChannel() != 0)
+        {
+            if (!socks[i]->GetShmChannel()->ArmDoorbell()) timeout = 0;
+            continue;
+        }
+#endif
+        fds[count].fd = socks[i]->GetSocket();
+        fds[count].events = POLLIN;
+        fds[count].revents = 0;
+        fdSocks[count] = socks[i];
+        count++;
+    }
+
+    int ready = poll(fds, count, timeout);
+#if GECO_ENABLE_SHM_TRANSPORT == 1
+    for (uint i = 0; i < size; i++)
+    {
+        if (socks[i]->GetShmChannel() == 0) continue;
+        socks[i]->GetShmChannel()->DisarmDoorbell();
+        result += RecvShmChannel(socks[i], index);
+    }
+#endif
+    if (ready <= 0)
+        return result;
+    for (uint i = 0; i < count; i++)
+    {
+        if (fds[i].revents != 0)
+            result += RecvJISRecvParams(fdSocks[i], index);
+    }
+    return result;
+}
+bool network_application_t::OpenPeerSocket(remote_system_t* rs)
+{
+    if (rs->peerSocket != 0 || rs->socket2use == 0 || !rs->socket2use->IsBerkleySocket())
+        return false;
+    berkley_socket_t* shared = (berkley_socket_t*)rs->socket2use;
+    if (!shared->GetBindingParams()->connectedPeers || shared->IsConnected())
+        return false;
+
+    uint index;
+    for (index = 0; index < bindedSockets.Size(); index++)
+    {
+        if (bindedSockets[index] == shared) break;
+    }
+    if (index == bindedSockets.Size() || JISPeerSockets[index].size >= GECO_MAX_PEER_SOCKETS)
+        return false;
+
+    /// GetBoundAddress() reports the wildcard addr as 127.0.0.1, ask kernel instead
+    sockaddr_in sa;
+    socklen_t len = sizeof(sa);
+    if (getsockname__(shared->GetSocket(), (sockaddr*)&sa, &len) != 0)
+        return false;
+    char host[64] = "";
+    if (sa.sin_family != AF_INET || sa.sin_addr.s_addr != INADDR_ANY)
+        shared->GetBoundAddress().ToString(false, host);
+
+    berkley_socket_binding_params_t bindParams = *shared->GetBindingParams();
+    bindParams.hostAddress = host;
+    bindParams.port = shared->GetBoundAddress().GetPortHostOrder();
+    /// recv thread reads it next to the shared socket, it must never block
+    bindParams.isNonBlocking = true;
+    bindParams.reusePort = true;
+
+    network_socket_t* sock;
+    do
+    {
+        sock = network_socket_alloc_t::AllocJIS();
+    } while (sock == 0);
+    if (!sock->IsBerkleySocket()
+        || ((berkley_socket_t*)sock)->Bind(&bindParams, TRACKE_MALLOC) != JISBindResult_SUCCESS
+        || !((berkley_socket_t*)sock)->ConnectTo(rs->systemAddress))
+    {
+        network_socket_alloc_t::DeallocJIS(sock);
+        return false;
+    }
+
+    berkley_socket_t* peer = (berkley_socket_t*)sock;
+    peer->SetUserConnectionSocketIndex(shared->GetUserConnectionSocketIndex());
+    if (bindParams.recvPrefilter)
+        peer->AttachRecvPrefilter(OFFLINE_MESSAGE_DATA_ID);
+#if GECO_ENABLE_RECV_TIMESTAMPS == 1
+    peer->EnableRecvTimestamps();
+#endif
+#if GECO_ENABLE_PLPMTUD == 1
+    peer->EnablePathMtuProbe();
+#endif
+#if GECO_ENABLE_ECN == 1
+    peer->EnableEcn();
+#endif
+#if GECO_ENABLE_TXTIME == 1
+    peer->EnableTxTime();
+#endif
+
+    peer_sockets_t& peers = JISPeerSockets[index];
+    peers.mutex.Lock();
+    peers.sockets.InsertAtLast(peer);
+    peers.size = peers.sockets.Size();
+    peers.mutex.Unlock();
+#if GECO_USE_EPOLL_REACTOR == 1
+    if (reactorEpollFd >= 0)
+    {
+        /// reactor drains the whole index, shared socket and its peers, on any of them
+        epoll_event ev;
+        ev.events = EPOLLIN | EPOLLET;
+        ev.data.u32 = index;
+        if (epoll_ctl(reactorEpollFd, EPOLL_CTL_ADD, peer->GetPollFd(), &ev) != 0)
+            fprintf(stderr, "JackieApplication::OpenPeerSocket()::epoll_ctl()::failed with errno code (%d-%s)\n", errno, strerror(errno));
+    }
+#endif
+
+    rs->sharedSocket = shared;
+    rs->peerSocket = peer;
+    rs->socket2use = peer;
+    pollFdsVersion++;
+    return true;
+}
+void network_application_t::ClosePeerSocket(remote_system_t* rs)
+{
+    if (rs->peerSocket == 0) return;
+    berkley_socket_t* peer = (berkley_socket_t*)rs->peerSocket;
+    /// datagrams still batched on it go out before it is gone
+    FlushEgressBatch(peer);
+
+    for (uint index = 0; index < bindedSockets.Size(); index++)
+    {
+        if (bindedSockets[index] != rs->sharedSocket) continue;
+        peer_sockets_t& peers = JISPeerSockets[index];
+        retired_peer_t retiree;
+        retiree.sock = peer;
+        peers.mutex.Lock();
+        for (uint i = 0; i < peers.sockets.Size(); i++)
+        {
+            if (peers.sockets[i] == peer)
+            {
+                peers.sockets.RemoveAtIndexFast(i);
+                break;
+            }
+        }
+        peers.size = peers.sockets.Size();
+        retiree.seq = ++peers.retiredCount;
+        peers.mutex.Unlock();
+        /// recv thread may be reading it right now, queued recv params still point to it
+        peers.retired.InsertAtLast(retiree);
+#if GECO_USE_EPOLL_REACTOR == 1
+        /// reactor acks it right away instead of after its next wait times out
+        WakeupReactor();
+#endif
+        peer = 0;
+        break;
     }
+
+    /// not in the peer sockets, nobody else can see it
+    if (peer != 0) network_socket_alloc_t::DeallocJIS(peer);
+    pollFdsVersion++;
+    rs->socket2use = rs->sharedSocket;
+    rs->peerSocket = 0;
+    rs->sharedSocket = 0;
+}
+void network_application_t::AckRetiredPeerSockets(uint index)
+{
+    peer_sockets_t& peers = JISPeerSockets[index];
+    if (peers.retiredSeen == peers.retiredCount) return;
+    /// the lock orders every recv param pushed so far before the echo
+    peers.mutex.Lock();
+    peers.retiredSeen = peers.retiredCount;
+    peers.mutex.Unlock();
 }
+void network_application_t::FreeRetiredPeerSockets(uint index, bool force)
+{
+    peer_sockets_t& peers = JISPeerSockets[index];
+    peers.mutex.Lock();
+    uint seen = peers.retiredSeen;
+    peers.mutex.Unlock();
+    /// recv params pushed before the echo may still sit in the queue
+    if (!force && allocRecvParamQ[index].Size() > 0) return;
+
+    for (uint i = 0; i < peers.retired.Size();)
+    {
+        retired_peer_t& retiree = peers.retired[i];
+        if (!force && (int)(seen - retiree.seq) < 0)
+        {
+            i++;
+            continue;
+        }
+        /// closing the fd takes it out of the reactor epoll set as well
+        network_socket_alloc_t::DeallocJIS(retiree.sock);
+        peers.retired.RemoveAtIndexFast(i);
+    }
+}
+#if GECO_ENABLE_SHM_TRANSPORT == 1
+bool network_application_t::OpenShmChannel(remote_system_t* rs)
+{
+    if (!rs->sameHost || rs->peerSocket != 0 || rs->socket2use == 0 || !rs->socket2use->IsBerkleySocket())
+        return false;
+    berkley_socket_t* shared = (berkley_socket_t*)rs->socket2use;
+    /// virtual or user transceiver sockets never reach the kernel anyway
+    if (shared->GetSocketTransceiver() != 0)
+        return false;
+
+    uint index;
+    for (index = 0; index < bindedSockets.Size(); index++)
+    {
+        if (bindedSockets[index] == shared) break;
+    }
+    if (index == bindedSockets.Size() || JISPeerSockets[index].size >= GECO_MAX_PEER_SOCKETS)
+        return false;
+
+    shm_transceiver_t* channel = OP_NEW<shm_transceiver_t>(TRACKE_MALLOC);
+    if (!channel->Open(myGuid, rs->guid, rs->systemAddress, shared, shared->GetMaxMTUSize()))
+    {
+        OP_DELETE(channel, TRACKE_MALLOC);
+        return false;
+    }
+    /// not AllocJIS(), it may hand out an io_uring socket and shm never goes through uring
+    berkley_socket_t* peer = OP_NEW<berkley_socket_t>(TRACKE_MALLOC);
+    peer->SetSocketType(JISType_LINUX);
+    peer->BindShm(channel, shared);
+    peer->SetUserConnectionSocketIndex(shared->GetUserConnectionSocketIndex());
+
+    peer_sockets_t& peers = JISPeerSockets[index];
+    peers.mutex.Lock();
+    peers.sockets.InsertAtLast(peer);
+    peers.size = peers.sockets.Size();
+    peers.mutex.Unlock();
+
+    rs->sharedSocket = shared;
+    rs->peerSocket = peer;
+    rs->socket2use = peer;
+    return true;
+}
+int network_application_t::RecvShmChannel(berkley_socket_t* sock, uint index)
+{
+    int result = 0;
+    while (result < GECO_RECV_BATCH_SIZE && RecvJISRecvParams(sock, index) > 0)
+        result++;
+    return result;
+}
+#endif
+#endif
 
 JACKIE_THREAD_DECLARATION(geco::net::RunRecvCycleLoop)
 {
@@ -2728,6 +4130,28 @@ JACKIE_THREAD_DECLARATION(geco::net::RunRecvCycleLoop)
     return 0;
 }
 
+#if GECO_USE_EPOLL_REACTOR == 1
+JACKIE_THREAD_DECLARATION(geco::net::RunReactorCycleLoop)
+{
+    network_application_t *serv = (network_application_t*)arguments;
+    serv->isRecvPollingThreadActive.Increment();
+
+    std::cout << "Reactor thread " << "is running in backend....";
+    /// read whatever came in before registration, this also arms io_uring multishot
+    /// recvs from this very thread. what is left goes on in the first cycle
+    for (uint index = 0; index < serv->bindedSockets.Size(); index++)
+        serv->RunReactorRecvCycles(index);
+    while (!serv->endThreads)
+    {
+        serv->RunReactorCycleOnce(GECO_REACTOR_WAIT_MS);
+    }
+    std::cout << "Reactor thread Stops....";
+
+    serv->isRecvPollingThreadActive.Decrement();
+    return 0;
+}
+#endif
+
 JACKIE_THREAD_DECLARATION(geco::net::RunNetworkUpdateCycleLoop)
 {
     network_application_t *serv = (network_application_t*)arguments;
@@ -2866,15 +4290,19 @@ connection_attempt_result_t network_application_t::Connect(const char* host,
     if (passwd == 0)
         passwdLength = 0;
 
-    bool found = false;
+    /// with SO_REUSEPORT fan-out several sockets share one user index, any of them will do
+    network_socket_t* connSocket = 0;
     for (uint i = 0; i < bindedSockets.Size(); i++)
     {
         if (bindedSockets[i]->GetUserConnectionSocketIndex()
             == ConnectionSocketIndex)
-            found = true;
+        {
+            connSocket = bindedSockets[i];
+            break;
+        }
     }
 
-    if (!found)
+    if (connSocket == 0)
     {
         std::cout << "invalid ConnectionSocketIndex";
         return INVALID_PARAM;
@@ -2883,7 +4311,7 @@ connection_attempt_result_t network_application_t::Connect(const char* host,
     network_address_t addr;
     bool ret =
         addr.FromString(host, port,
-        bindedSockets[ConnectionSocketIndex]->GetBoundAddress().GetIPVersion());
+        connSocket->GetBoundAddress().GetIPVersion());
     if (!ret || addr == JACKIE_NULL_ADDRESS)
         return CANNOT_RESOLVE_DOMAIN_NAME;
 
@@ -2897,7 +4325,7 @@ connection_attempt_result_t network_application_t::Connect(const char* host,
     connReq->data = 0;
     connReq->extraData = extraData;
     connReq->socketIndex = ConnectionSocketIndex;
-    connReq->socket = bindedSockets[ConnectionSocketIndex];
+    connReq->socket = connSocket;
     connReq->actionToTake = connection_request_t::CONNECT;
     connReq->connAttemptTimes = attemptTimes;
     connReq->connAttemptIntervalMS = AttemptIntervalMS;
@@ -3052,6 +4480,12 @@ void network_application_t::AddToActiveSystemList(uint index2use)
     activeSystemList[activeSystemListSize++] = remoteSystemList + index2use;
 }
 
+bool network_application_t::IsSameHost(const network_address_t& systemAddress,
+    ulonglong hostId) const
+{
+    if (hostId != 0 && hostId == myHostId) return true;
+    return IsLoopbackAddress(systemAddress, false);
+}
 bool network_application_t::IsLoopbackAddress(
     const guid_address_wrapper_t &systemIdentifier, bool matchPort) const
 {
@@ -3169,8 +4603,10 @@ void network_application_t::Add2RemoteSystemList(recv_params_t* recvParams,
             free_rs->MTUSize = defaultMTUSize;
             if (mtu > defaultMTUSize)
             {
+                /// mtu is echoed back by the client, never trust it beyond our socket
                 free_rs->MTUSize = mtu;
-                assert(free_rs->MTUSize <= MAXIMUM_MTU_SIZE);
+                if (free_rs->MTUSize > recvParams->localBoundSocket->GetMaxMTUSize())
+                    free_rs->MTUSize = recvParams->localBoundSocket->GetMaxMTUSize();
             }
 
             // This one line causes future incoming packets to go through the reliability layer
@@ -3179,12 +4615,27 @@ void network_application_t::Add2RemoteSystemList(recv_params_t* recvParams,
             // Reserve this reliability layer for ourselves.
             free_rs->reliabilityLayer.Reset(true, free_rs->MTUSize,
                 clientSecureRequiredbyServer);
+            if (congestionControllerFactory != 0)
+                free_rs->reliabilityLayer.SetCongestionController(
+                    congestionControllerFactory(guid, recvParams->senderINetAddress), free_rs->MTUSize);
             free_rs->reliabilityLayer.SetSplitMessageProgressInterval(
                 splitMessageProgressInterval);
             free_rs->reliabilityLayer.SetUnreliableTimeout(unreliableTimeout);
             free_rs->reliabilityLayer.SetTimeoutTime(defaultTimeoutTime);
             AddToActiveSystemList(index2use);
-            if (recvParams->localBoundSocket->GetBoundAddress()
+#if GECO_ENABLE_PEER_SOCKETS == 1
+            /// left over from the previous system in this slot
+            ClosePeerSocket(free_rs);
+#endif
+            free_rs->address2use = JACKIE_NULL_ADDRESS;
+            if (recvParams->receiverINetAddress != JACKIE_NULL_ADDRESS)
+            {
+                // wildcard socket told us which local ip client talks to,
+                // keep replying from it on the very same socket
+                free_rs->socket2use = recvParams->localBoundSocket;
+                free_rs->address2use = recvParams->receiverINetAddress;
+            }
+            else if (recvParams->localBoundSocket->GetBoundAddress()
                 == recvivedBoundAddrFromClient)
             {
                 free_rs->socket2use = recvParams->localBoundSocket;
@@ -3270,6 +4721,9 @@ void network_application_t::Add2RemoteSystemList(recv_params_t* recvParams,
             free_rs->connectionTime = time;
             free_rs->myExternalSystemAddress = JACKIE_NULL_ADDRESS;
             free_rs->lastReliableSend = time;
+#if GECO_ENABLE_PLPMTUD == 1
+            ResetPathMtu(free_rs, time);
+#endif
 
 #ifdef _DEBUG
             int indexLoopupCheck = GetRemoteSystemIndexGeneral(recvParams->senderINetAddress, true);
@@ -3289,7 +4743,6 @@ void network_application_t::Add2RemoteSystemList(recv_params_t* recvParams,
 
 bool network_application_t::SendImmediate(reliable_send_params_t& sendParams)
 {
-    std::cout << "JackieApplication::SendImmediate needs implementations !";
     uint* sendList;
     uint sendListSize = 0;
     bool callerDataAllocationUsed = false;
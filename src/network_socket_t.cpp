@@ -1,6 +1,20 @@
 ﻿#include "network_socket_t.h"
 #include "geco-wsa-singleton.h"
 #include "geco_application.h"
+#include "geco-virtual-network.h"
+#include "geco-shm-transport.h"
+#include "geco-unix-socket.h"
+#include "geco-msg-ids.h"
+
+#if GECO_ENABLE_IO_URING == 1
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/utsname.h>
+#endif
+#if defined(__linux__)
+#include <linux/net_tstamp.h>
+#endif
 
 GECO_NET_BEGIN_NSPACE
 
@@ -25,7 +39,7 @@ const char* socket_binding_result_to_str(socket_binding_result_t reason)
 }
 const char* network_socket_type_to_str(network_socket_type_t reason)
 {
-    const char* const JISTypeStrings[9] =
+    const char* const JISTypeStrings[10] =
     {
         "JISType_WINDOWS_STORE_8",
         "JISType_PS3",
@@ -35,7 +49,8 @@ const char* network_socket_type_to_str(network_socket_type_t reason)
         "JISType_XBOX_360",
         "JISType_XBOX_720",
         "JISType_WINDOWS",
-        "JISType_LINUX"
+        "JISType_LINUX",
+        "JISType_LINUX_IO_URING"
     };
     unsigned int index = reason;
 
@@ -61,6 +76,14 @@ inline network_socket_t* network_socket_alloc_t::AllocJIS(void)
     s2 = geco::ultils::OP_NEW<berkley_socket_t>(TRACKE_MALLOC);
     if (s2 != 0) s2->SetSocketType(JISType_WINDOWS);
 #else
+#if GECO_ENABLE_IO_URING == 1
+    if (uring_socket_t::IsSupported())
+    {
+        s2 = geco::ultils::OP_NEW<uring_socket_t>(TRACKE_MALLOC);
+        if (s2 != 0) s2->SetSocketType(JISType_LINUX_IO_URING);
+        return s2;
+    }
+#endif
     s2 = geco::ultils::OP_NEW<berkley_socket_t>(TRACKE_MALLOC);
     if(s2 != 0) s2->SetSocketType(JISType_LINUX);
 #endif
@@ -112,15 +135,86 @@ berkley_socket_t::berkley_socket_t()
     WSAStartupSingleton::AddRef();
     rns2Socket = (socket_fd_t)INVALID_SOCKET;
     jst = 0;
+    virtualNetwork = 0;
+#if GECO_ENABLE_SHM_TRANSPORT == 1
+    shmChannel = 0;
+#endif
+#if GECO_ENABLE_UNIX_SOCKETS == 1
+    unixTransceiver = 0;
+#endif
+    isRecvBatchSupported = true;
+    isSendBatchSupported = true;
+    queuedSendsSize = 0;
+    queuedSendsBytes = 0;
+    isGSOSupported = true;
+    isZeroCopyEnabled = false;
+    zeroCopyIssued = 0;
+    zeroCopyCompleted = 0;
+    isGROEnabled = false;
+    isRecvTimestampEnabled = false;
+    isPktInfoEnabled = false;
+    isRxqOvflEnabled = false;
+    kernelDropped = 0;
+    isPathMtuProbeEnabled = false;
+    connectedAddress = JACKIE_NULL_ADDRESS;
+    isEcnEnabled = false;
+    isTxTimeEnabled = false;
+    multicastGroupsSize = 0;
+    queuedSends = 0;
+    queuedSendsData = 0;
+    SetMaxMTUSize(MAXIMUM_MTU_SIZE);
+    recvBufSize = GECO_SO_REVBUF_SIZE;
+    kernelDroppedAtLastAdjust = 0;
+    quietAdjustIntervals = 0;
+    nextAdjustTime = 0;
+    isRecvBufAtMax = false;
 }
 berkley_socket_t::~berkley_socket_t()
 {
     WSAStartupSingleton::Deref();
+    if (virtualNetwork != 0)
+    {
+        virtualNetwork->Detach((virtual_transceiver_t*)jst);
+        virtualNetwork = 0;
+        jst = 0;
+    }
+#if GECO_ENABLE_SHM_TRANSPORT == 1
+    if (shmChannel != 0)
+    {
+        geco::ultils::OP_DELETE(shmChannel, TRACKE_MALLOC);
+        shmChannel = 0;
+        jst = 0;
+    }
+#endif
+#if GECO_ENABLE_UNIX_SOCKETS == 1
+    if (unixTransceiver != 0)
+    {
+        /// it closes the fd rns2Socket mirrors
+        geco::ultils::OP_DELETE(unixTransceiver, TRACKE_MALLOC);
+        unixTransceiver = 0;
+        rns2Socket = (socket_fd_t)INVALID_SOCKET;
+        jst = 0;
+    }
+#endif
     if (rns2Socket != INVALID_SOCKET)
     {
         closesocket__(rns2Socket);
         rns2Socket = (socket_fd_t)INVALID_SOCKET;
     }
+    OP_DELETE_ARRAY(queuedSendsData, TRACKE_MALLOC);
+    OP_DELETE_ARRAY(queuedSends, TRACKE_MALLOC);
+}
+void berkley_socket_t::SetMaxMTUSize(ushort mtu)
+{
+    assert(queuedSendsSize == 0);
+    if (mtu == 0) mtu = MAXIMUM_MTU_SIZE;
+    if (mtu > GECO_MAX_JUMBO_MTU_SIZE) mtu = GECO_MAX_JUMBO_MTU_SIZE;
+    if (mtu == maxMTUSize) return;
+
+    /// QueueSend() allocates it again at the new size
+    OP_DELETE_ARRAY(queuedSendsData, TRACKE_MALLOC);
+    queuedSendsData = 0;
+    maxMTUSize = mtu;
 }
 
 bool berkley_socket_t::IsPortInUse(unsigned short port, const char *hostAddress,
@@ -139,7 +233,11 @@ bool berkley_socket_t::IsPortInUse(unsigned short port, const char *hostAddress,
         false,//int doNotFragment;
         0,//int pollingThreadPriority;
         0,//JISEventHandler *eventHandler;
-        0//unsigned short remotePortJackieNetWasStartedOn_PS3_PS4_PSP2;
+        0,//unsigned short remotePortJackieNetWasStartedOn_PS3_PS4_PSP2;
+        false,//bool reusePort;
+        false,//bool connectedPeers;
+        false,//bool recvPrefilter;
+        0//unsigned short maxMTUSize;
     };
 
     network_address_t boundAddress;
@@ -163,10 +261,75 @@ socket_binding_result_t berkley_socket_t::Bind(berkley_socket_binding_params_t *
     }
     return bindResult;
 }
+socket_binding_result_t berkley_socket_t::BindVirtual(virtual_network_t *network,
+        berkley_socket_binding_params_t *bindParameters)
+{
+    assert(network != 0);
+    assert(virtualNetwork == 0);
+
+    const char *host = bindParameters->hostAddress != 0 && bindParameters->hostAddress[0] != 0 ?
+        bindParameters->hostAddress : "127.0.0.1";
+    if (!boundAddress.FromString(host, bindParameters->port))
+        return JISBindResult_FAILED_BIND_SOCKET;
+
+    virtual_transceiver_t *endpoint = network->Attach(boundAddress, bindParameters->isNonBlocking);
+    if (endpoint == 0)
+    {
+        fprintf(stderr, "JISBerkley::BindVirtual()::Attach()::failed, %s is in use\n", boundAddress.ToString());
+        return JISBindResult_FAILED_BIND_SOCKET;
+    }
+    jst = endpoint;
+    virtualNetwork = network;
+    /// virtual_transceiver_t moves MAXIMUM_MTU_SIZE datagrams at most
+    SetMaxMTUSize(MAXIMUM_MTU_SIZE);
+    memcpy(&this->binding, bindParameters, sizeof(berkley_socket_binding_params_t));
+    return JISBindResult_SUCCESS;
+}
+#if GECO_ENABLE_UNIX_SOCKETS == 1
+socket_binding_result_t berkley_socket_t::BindUnix(const char *dir,
+        berkley_socket_binding_params_t *bindParameters)
+{
+    assert(dir != 0);
+    assert(unixTransceiver == 0 && virtualNetwork == 0);
+
+    if (!boundAddress.FromString(GECO_UNIX_SOCKET_HOST, bindParameters->port))
+        return JISBindResult_FAILED_BIND_SOCKET;
+    SetMaxMTUSize(bindParameters->maxMTUSize);
+
+    unix_transceiver_t *endpoint = geco::ultils::OP_NEW<unix_transceiver_t>(TRACKE_MALLOC);
+    socket_binding_result_t br = endpoint->Bind(dir, boundAddress,
+        bindParameters->isNonBlocking, maxMTUSize);
+    if (br != JISBindResult_SUCCESS)
+    {
+        geco::ultils::OP_DELETE(endpoint, TRACKE_MALLOC);
+        return br;
+    }
+    jst = endpoint;
+    unixTransceiver = endpoint;
+    rns2Socket = endpoint->GetFd();
+    memcpy(&this->binding, bindParameters, sizeof(berkley_socket_binding_params_t));
+    return JISBindResult_SUCCESS;
+}
+#endif
+#if GECO_ENABLE_SHM_TRANSPORT == 1
+socket_binding_result_t berkley_socket_t::BindShm(shm_transceiver_t *channel, berkley_socket_t *shared)
+{
+    assert(channel != 0 && channel->IsOpen());
+    assert(shmChannel == 0 && virtualNetwork == 0);
+
+    jst = channel;
+    shmChannel = channel;
+    boundAddress = shared->GetBoundAddress();
+    SetMaxMTUSize(shared->GetMaxMTUSize());
+    memcpy(&this->binding, shared->GetBindingParams(), sizeof(berkley_socket_binding_params_t));
+    return JISBindResult_SUCCESS;
+}
+#endif
 socket_binding_result_t berkley_socket_t::BindShared(berkley_socket_binding_params_t *bindParameters,
         const char *file, unsigned int line)
 {
     socket_binding_result_t br;
+    SetMaxMTUSize(bindParameters->maxMTUSize);
 
 #if NET_SUPPORT_IPV6==1
     br = BindSharedIPV4And6(bindParameters, file, line);
@@ -176,14 +339,30 @@ socket_binding_result_t berkley_socket_t::BindShared(berkley_socket_binding_para
 
     if (br != JISBindResult_SUCCESS) return br;
 
+    /// SetSocketOptions() asked for GECO_SO_REVBUF_SIZE, kernel caps it at net.core.rmem_max
+    int actual = GetKernelRecvBufSize();
+    if (actual > 0) recvBufSize = actual;
+
+    /// kernel can deliver the test datagram to any socket in the reuseport group
+    if (bindParameters->reusePort)
+    {
+        memcpy(&this->binding, bindParameters, sizeof(berkley_socket_binding_params_t));
+        return br;
+    }
+
     char zero[128] =
     {   0};
-    send_params_t sendParams =
-    {   (char*)&zero, sizeof(zero), 0, boundAddress, 0};
+    send_params_t sendParams;
+    sendParams.data = (char*)&zero;
+    sendParams.length = sizeof(zero);
+    sendParams.receiverINetAddress = boundAddress;
 
     Send(&sendParams, TRACKE_MALLOC);
     GecoSleep(10); // make sure data has been delivered into us
+    char buffer[GECO_MAX_JUMBO_MTU_SIZE];
     recv_params_t recvParams;
+    recvParams.data = buffer;
+    recvParams.groBuffer = 0;
     recvParams.localBoundSocket = this;
     recv_result_t rr = RecvFrom(&recvParams);
 
@@ -219,6 +398,7 @@ socket_binding_result_t berkley_socket_t::BindSharedIPV4(berkley_socket_binding_
     }
 
     SetSocketOptions();
+    SetReusePort(bindParameters->reusePort);
     SetNonBlockingSocket(bindParameters->isNonBlocking);
     SetBroadcastSocket(bindParameters->isBroadcast);
     SetIPHdrIncl(bindParameters->setIPHdrIncl);
@@ -284,6 +464,7 @@ socket_binding_result_t berkley_socket_t::BindSharedIPV4And6(berkley_socket_bind
         // getaddrinfo() gave us.
         rns2Socket = socket__(aip->ai_family, aip->ai_socktype, aip->ai_protocol);
         if( rns2Socket == -1 ) return JISBindResult_FAILED_BIND_SOCKET;
+        SetReusePort(bindParameters->reusePort);
 
         ret = bind__(rns2Socket, aip->ai_addr, (int) aip->ai_addrlen);
         if( ret >= 0 )
@@ -331,6 +512,136 @@ socket_binding_result_t berkley_socket_t::BindSharedIPV4And6(berkley_socket_bind
     return BindSharedIPV4(bindParameters, file, line);
 #endif
 }
+bool berkley_socket_t::AttachReusePortCBPF(uint groupSize)
+{
+#if defined(__linux__) && !defined(ANDROID)
+    assert(groupSize > 1);
+
+    /// socket data starts at udp payload when the program runs, so go to
+    /// headers via SKF_NET_OFF. ipv4 header length comes from IHL, options
+    /// move the udp header. ipv6 header is taken as 40 bytes (no extension
+    /// headers) and the last word of its source address is hashed
+    bool v6 = boundAddress.GetIPVersion() == 6;
+    uint saddrOffset = v6 ? 20 : 12;
+
+    sock_filter code[] =
+    {
+        /// X = ip header length
+        v6 ? sock_filter { BPF_LDX | BPF_W | BPF_IMM, 0, 0, 40 } :
+            sock_filter { BPF_LDX | BPF_B | BPF_MSH, 0, 0, (uint)SKF_NET_OFF },
+        /// A = source port, first half word of udp header
+        { BPF_LD | BPF_H | BPF_IND, 0, 0, (uint)SKF_NET_OFF },
+        /// X = A
+        { BPF_MISC | BPF_TAX, 0, 0, 0 },
+        /// A = source address
+        { BPF_LD | BPF_W | BPF_ABS, 0, 0, (uint)SKF_NET_OFF + saddrOffset },
+        /// A = (A ^ X) % groupSize
+        { BPF_ALU | BPF_XOR | BPF_X, 0, 0, 0 },
+        { BPF_ALU | BPF_MOD | BPF_K, 0, 0, groupSize },
+        /// return the index of socket in the group
+        { BPF_RET | BPF_A, 0, 0, 0 },
+    };
+    sock_fprog prog;
+    prog.len = sizeof(code) / sizeof(code[0]);
+    prog.filter = code;
+
+    if (setsockopt__(rns2Socket, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, (char *)& prog, sizeof(prog)) == 0)
+        return true;
+    fprintf(stderr, "JISBerkley::AttachReusePortCBPF()::setsockopt__()::failed with errno code (%d-%s)\n", errno, strerror(errno));
+#endif
+    return false;
+}
+bool berkley_socket_t::AttachRecvPrefilter(const uchar offlineMessageDataId[16])
+{
+#if defined(__linux__) && !defined(ANDROID)
+    if (jst != 0) return false;
+
+    /// offline ids and where IsOfflineRecvParams() looks for the magic in them
+    static const struct { uchar id; uchar offset; } offlines[] =
+    {
+        { ID_UNCONNECTED_PING, sizeof(msg_id_t) + sizeof(Time) },
+        { ID_UNCONNECTED_PING_OPEN_CONNECTIONS, sizeof(msg_id_t) + sizeof(Time) },
+        { ID_UNCONNECTED_PONG, sizeof(msg_id_t) + sizeof(Time) + sizeof(ulonglong) },
+        { ID_OUT_OF_BAND_INTERNAL, sizeof(msg_id_t) + sizeof(ulonglong) },
+        { ID_OPEN_CONNECTION_REPLY_1, sizeof(msg_id_t) },
+        { ID_OPEN_CONNECTION_REPLY_2, sizeof(msg_id_t) },
+        { ID_OPEN_CONNECTION_REQUEST_1, sizeof(msg_id_t) },
+        { ID_OPEN_CONNECTION_REQUEST_2, sizeof(msg_id_t) },
+        { ID_CONNECTION_ATTEMPT_FAILED, sizeof(msg_id_t) },
+        { ID_CANNOT_ACCEPT_INCOMING_CONNECTIONS, sizeof(msg_id_t) },
+        { ID_CONNECTION_BANNED, sizeof(msg_id_t) },
+        { ID_ALREADY_CONNECTED, sizeof(msg_id_t) },
+        { ID_YOU_CONNECT_TOO_OFTEN, sizeof(msg_id_t) },
+        { ID_INCOMPATIBLE_PROTOCOL_VERSION, sizeof(msg_id_t) },
+        { ID_PATH_MTU_PROBE, sizeof(msg_id_t) },
+        { ID_PATH_MTU_PROBE_REPLY, sizeof(msg_id_t) },
+        { ID_MULTICAST_DATA, sizeof(msg_id_t) },
+    };
+    const uint idsSize = sizeof(offlines) / sizeof(offlines[0]);
+    /// program of a udp socket sees the udp header first
+    const uint payload = 8;
+
+    /// one block comparing the 4 words of magic per distinct offset
+    uchar offsets[idsSize];
+    uint offsetsSize = 0;
+    uint blockOf[idsSize];
+    for (uint i = 0; i < idsSize; i++)
+    {
+        uint j = 0;
+        while (j < offsetsSize && offsets[j] != offlines[i].offset) j++;
+        if (j == offsetsSize) offsets[offsetsSize++] = offlines[i].offset;
+        blockOf[i] = j;
+    }
+
+    const uint blockSize = 9;
+    const uint firstBlock = 7 + idsSize;
+    const uint dropAt = firstBlock + offsetsSize * blockSize;
+    const uint acceptAt = dropAt + 1;
+    sock_filter code[7 + idsSize + idsSize * blockSize + 2];
+    uint pc = 0;
+#define GECO_BPF(c, jt, jf, k) { sock_filter f = { (ushort)(c), (uchar)(jt), (uchar)(jf), (uint)(k) }; code[pc++] = f; }
+#define GECO_BPF_TO(at) ((at) - pc - 1)
+
+    /// A = datagram length, datagrams of 2 bytes or less are only kept as a wakeup
+    GECO_BPF(BPF_LD | BPF_W | BPF_LEN, 0, 0, 0);
+    GECO_BPF(BPF_JMP | BPF_JGE | BPF_K, 2, 0, payload + 3);
+    GECO_BPF(BPF_LD | BPF_B | BPF_ABS, 0, 0, payload);
+    GECO_BPF(BPF_JMP | BPF_JEQ | BPF_K, GECO_BPF_TO(acceptAt), GECO_BPF_TO(dropAt), ID_RECV_WAKEUP);
+    /// A = msg id, isValid bit is set in every datagram of the reliability layer
+    GECO_BPF(BPF_LD | BPF_B | BPF_ABS, 0, 0, payload);
+    GECO_BPF(BPF_JMP | BPF_JSET | BPF_K, GECO_BPF_TO(acceptAt), 0, 0x80);
+    for (uint i = 0; i < idsSize; i++)
+    {
+        GECO_BPF(BPF_JMP | BPF_JEQ | BPF_K, GECO_BPF_TO(firstBlock + blockOf[i] * blockSize), 0, offlines[i].id);
+    }
+    GECO_BPF(BPF_RET | BPF_K, 0, 0, 0);
+    for (uint j = 0; j < offsetsSize; j++)
+    {
+        /// a load past the end of a short datagram drops it too
+        for (uint w = 0; w < 4; w++)
+        {
+            const uchar *m = offlineMessageDataId + w * 4;
+            GECO_BPF(BPF_LD | BPF_W | BPF_ABS, 0, 0, payload + offsets[j] + w * 4);
+            GECO_BPF(BPF_JMP | BPF_JEQ | BPF_K, 0, GECO_BPF_TO(dropAt),
+                ((uint)m[0] << 24) | ((uint)m[1] << 16) | ((uint)m[2] << 8) | m[3]);
+        }
+        GECO_BPF(BPF_RET | BPF_K, 0, 0, 0xFFFFFFFF);
+    }
+    assert(pc == dropAt);
+    GECO_BPF(BPF_RET | BPF_K, 0, 0, 0);
+    GECO_BPF(BPF_RET | BPF_K, 0, 0, 0xFFFFFFFF);
+#undef GECO_BPF_TO
+#undef GECO_BPF
+
+    sock_fprog prog;
+    prog.len = pc;
+    prog.filter = code;
+    if (setsockopt__(rns2Socket, SOL_SOCKET, SO_ATTACH_FILTER, (char *)& prog, sizeof(prog)) == 0)
+        return true;
+    fprintf(stderr, "JISBerkley::AttachRecvPrefilter()::setsockopt__()::failed with errno code (%d-%s)\n", errno, strerror(errno));
+#endif
+    return false;
+}
 //////////////////////////////////////////////////////////////////////////
 
 inline recv_result_t berkley_socket_t::RecvFrom(recv_params_t *recvFromStruct)
@@ -339,8 +650,11 @@ inline recv_result_t berkley_socket_t::RecvFrom(recv_params_t *recvFromStruct)
 
     if (jst != 0)
     {
-        return jst->JackieINetRecvFrom(recvFromStruct->data,
+        /// callers size @data by GetMaxMTUSize()
+        recvFromStruct->bytesRead = jst->JackieINetRecvFrom(recvFromStruct->data, maxMTUSize,
                 &recvFromStruct->senderINetAddress, false);
+        recvFromStruct->timeRead = Get64BitsTimeUS();
+        return recvFromStruct->bytesRead;
     }
 
 #if NET_SUPPORT_IPV6 ==1
@@ -360,7 +674,7 @@ recv_result_t berkley_socket_t::RecvFromIPV4(recv_params_t *recvFromStruct)
     static const int flag = 0;
 
     TRY_ONE_MORE_TIME:
-    recvFromStruct->bytesRead = recvfrom__(this->rns2Socket, recvFromStruct->data, MAXIMUM_MTU_SIZE, flag, sockAddrPtr, socketlenPtr);
+    recvFromStruct->bytesRead = recvfrom__(this->rns2Socket, recvFromStruct->data, maxMTUSize, flag, sockAddrPtr, socketlenPtr);
 
     /// there are only two resons for UDP recvfrom() return 0 :
     /// 1. Socket has been soft closed by shutdown() or setting up linear attribute
@@ -449,7 +763,7 @@ inline recv_result_t berkley_socket_t::RecvFromIPV4And6(recv_params_t *recvFromS
     static sockaddr* sockAddrPtr = (sockaddr*) &sa;
     static const int flag = 0;
 
-    recvFromStruct->bytesRead = recvfrom__(rns2Socket, recvFromStruct->data, MAXIMUM_MTU_SIZE, flag, sockAddrPtr, socketlenPtr);
+    recvFromStruct->bytesRead = recvfrom__(rns2Socket, recvFromStruct->data, maxMTUSize, flag, sockAddrPtr, socketlenPtr);
 
     /// there are only two resons for UDP recvfrom() return 0 :
     /// 1. Socket has been soft closed by shutdown() or setting up linear attribute
@@ -501,160 +815,1334 @@ inline recv_result_t berkley_socket_t::RecvFromIPV4And6(recv_params_t *recvFromS
     return RecvFromIPV4(recvFromStruct);
 #endif
 }
-//////////////////////////////////////////////////////////////////////////
-send_result_t berkley_socket_t::Send(send_params_t *sendParameters,
-        const char *file, unsigned int line)
-{
-    /// we will nevwer send o len data
-    assert(sendParameters->data != 0);
-    assert(sendParameters->length > 0);
+#if defined(recvmmsg__) && defined(SO_TIMESTAMPNS)
+#define GECO_RECV_TIMESTAMP_SUPPORTED 1
+/// control room every recvmmsg() entry needs for one SCM_TIMESTAMPNS
+#define GECO_TIMESTAMP_CMSG_SPACE CMSG_SPACE(sizeof(timespec))
 
-    if (jst != 0)
-    {
-        return jst->JackieINetSendTo(sendParameters->data,
-                sendParameters->length,
-                sendParameters->receiverINetAddress);
-    }
-    else
+static inline TimeUS GetRealTimeUS(void)
+{
+    timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return ts.tv_sec * (TimeUS)1000000 + ts.tv_nsec / 1000;
+}
+/// SCM_TIMESTAMPNS is CLOCK_REALTIME while TimeUS has its own base, so what we carry
+/// over is how long ago kernel got the datagram. @now and @realNow are read together
+/// right after the recv call. returns @now if @msg has no stamp
+static TimeUS GetKernelTimeRead(msghdr *msg, TimeUS now, TimeUS realNow)
+{
+    for (cmsghdr* cm = CMSG_FIRSTHDR(msg); cm != 0; cm = CMSG_NXTHDR(msg, cm))
     {
-        return SendWithoutVDP(rns2Socket, sendParameters, file, line);
+        if (cm->cmsg_level != SOL_SOCKET || cm->cmsg_type != SCM_TIMESTAMPNS)
+            continue;
+        timespec ts;
+        memcpy(&ts, CMSG_DATA(cm), sizeof(timespec));
+        TimeUS stamp = ts.tv_sec * (TimeUS)1000000 + ts.tv_nsec / 1000;
+        /// wall clock may have been stepped in between, never go beyond now
+        if (stamp >= realNow) return now;
+        TimeUS age = realNow - stamp;
+        return age < now ? now - age : 0;
     }
+    return now;
 }
-
-send_result_t berkley_socket_t::SendWithoutVDP(socket_fd_t rns2Socket,
-        send_params_t *sendParameters,
-        const char *file, unsigned int line)
+#else
+#define GECO_RECV_TIMESTAMP_SUPPORTED 0
+#define GECO_TIMESTAMP_CMSG_SPACE 0
+#endif
+#if defined(recvmmsg__) && defined(IP_PKTINFO)
+#define GECO_PKTINFO_SUPPORTED 1
+/// control room one IP_PKTINFO or IPV6_PKTINFO needs, in6_pktinfo is the bigger one
+#define GECO_PKTINFO_CMSG_SPACE CMSG_SPACE(sizeof(in6_pktinfo))
+
+/// fills @localAddress with the addr datagram in @msg was sent to, port is the
+/// one of @boundAddress. leaves @localAddress untouched if @msg has no pktinfo
+static void GetPktInfoAddress(msghdr *msg, const network_address_t& boundAddress,
+    network_address_t& localAddress)
 {
-    int len = 0;
-    int oldTTL = -1;
-    int newTTL = -1;
-    socklen_t opLen = sizeof(oldTTL);
-
-    oldTTL = -1;
-    if (sendParameters->ttl > 0)
+    for (cmsghdr* cm = CMSG_FIRSTHDR(msg); cm != 0; cm = CMSG_NXTHDR(msg, cm))
     {
-        // Get the current TTL
-        if (getsockopt__(rns2Socket,
-                        sendParameters->receiverINetAddress.GetIPProtocol(), IP_TTL, (char *)& oldTTL, &opLen) != -1)
+        if (cm->cmsg_level == IPPROTO_IP && cm->cmsg_type == IP_PKTINFO)
         {
-            newTTL = sendParameters->ttl;
-            setsockopt__(rns2Socket, sendParameters->receiverINetAddress.GetIPProtocol(), IP_TTL, (char *)& newTTL, sizeof(newTTL));
+            in_pktinfo info;
+            memcpy(&info, CMSG_DATA(cm), sizeof(in_pktinfo));
+            memset(&localAddress.address, 0, sizeof(localAddress.address));
+            localAddress.address.addr4.sin_family = AF_INET;
+            localAddress.address.addr4.sin_addr = info.ipi_addr;
+            localAddress.SetPortNetworkOrder(boundAddress);
+            return;
+        }
+#if NET_SUPPORT_IPV6 ==1
+        if (cm->cmsg_level == IPPROTO_IPV6 && cm->cmsg_type == IPV6_PKTINFO)
+        {
+            in6_pktinfo info;
+            memcpy(&info, CMSG_DATA(cm), sizeof(in6_pktinfo));
+            memset(&localAddress.address, 0, sizeof(localAddress.address));
+            localAddress.address.addr6.sin6_family = AF_INET6;
+            localAddress.address.addr6.sin6_addr = info.ipi6_addr;
+            localAddress.SetPortNetworkOrder(boundAddress);
+            return;
         }
+#endif
     }
-
-    TRY_ONE_MORE_TIME:
-    if (sendParameters->receiverINetAddress.address.addr4.sin_family == AF_INET)
+}
+/// writes the pktinfo that makes kernel send from @localAddress into @control,
+/// which has GECO_PKTINFO_CMSG_SPACE bytes. returns control bytes used, 0 if none
+static socklen_t PutPktInfoAddress(char *control, const network_address_t& localAddress)
+{
+    if (localAddress == JACKIE_NULL_ADDRESS) return 0;
+    memset(control, 0, GECO_PKTINFO_CMSG_SPACE);
+    cmsghdr *cm = (cmsghdr*)control;
+    if (localAddress.address.addr4.sin_family == AF_INET)
     {
-        len = sendto__(rns2Socket, sendParameters->data, sendParameters->length, 0, (const sockaddr*)& sendParameters->receiverINetAddress.address.addr4, sizeof(sockaddr_in));
+        in_pktinfo info;
+        memset(&info, 0, sizeof(in_pktinfo));
+        info.ipi_spec_dst = localAddress.address.addr4.sin_addr;
+        cm->cmsg_level = IPPROTO_IP;
+        cm->cmsg_type = IP_PKTINFO;
+        cm->cmsg_len = CMSG_LEN(sizeof(in_pktinfo));
+        memcpy(CMSG_DATA(cm), &info, sizeof(in_pktinfo));
+        return CMSG_SPACE(sizeof(in_pktinfo));
     }
-    else
-    {
 #if NET_SUPPORT_IPV6 ==1
-        len = sendto__(rns2Socket, sendParameters->data, sendParameters->length, 0, (const sockaddr*)& sendParameters->receiverINetAddress.address.addr6, sizeof(sockaddr_in6));
-#endif
+    if (localAddress.address.addr6.sin6_family == AF_INET6)
+    {
+        in6_pktinfo info;
+        memset(&info, 0, sizeof(in6_pktinfo));
+        info.ipi6_addr = localAddress.address.addr6.sin6_addr;
+        cm->cmsg_level = IPPROTO_IPV6;
+        cm->cmsg_type = IPV6_PKTINFO;
+        cm->cmsg_len = CMSG_LEN(sizeof(in6_pktinfo));
+        memcpy(CMSG_DATA(cm), &info, sizeof(in6_pktinfo));
+        return CMSG_SPACE(sizeof(in6_pktinfo));
     }
+#endif
+    return 0;
+}
+#else
+#define GECO_PKTINFO_SUPPORTED 0
+#define GECO_PKTINFO_CMSG_SPACE 0
+#endif
+#if defined(recvmmsg__) && defined(SO_RXQ_OVFL)
+#define GECO_RXQ_OVFL_SUPPORTED 1
+#define GECO_RXQ_OVFL_CMSG_SPACE CMSG_SPACE(sizeof(uint32_t))
 
-    /// only when sendParameters->length == 0, sendto() will return 0;
-    /// otherwise it will return > 0, or error code of -1
-    /// we forbid to send o length data
-    ///assert(len != 0);
-
-    if (len < 0)
+/// SO_RXQ_OVFL is the total kernel has dropped on this socket when datagram
+/// in @msg was queued, only there while the total is not 0
+static void GetRxqOvflCounter(msghdr *msg, uint& dropped)
+{
+    for (cmsghdr* cm = CMSG_FIRSTHDR(msg); cm != 0; cm = CMSG_NXTHDR(msg, cm))
     {
-#if defined(_WIN32)
-        DWORD err = GetLastError();
-        HLOCAL messageBuffer = 0;
-        FormatMessage(FORMAT_MESSAGE_ALLOCATE_BUFFER | FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS,
-                NULL, GetLastError(),
-                MAKELANGID(LANG_NEUTRAL, SUBLANG_DEFAULT),  // Default language
-                (PTSTR)& messageBuffer, 0, 0);
-        // I see this hit on XP with IPV6 for some reason
-        fwprintf(stderr, L"JISBerkley::RecvFromNonBlockingIPV4()::sendto__()::failed with errno code (%d, %ls)\n",
-                GetLastError(), (PCTSTR)LocalLock(messageBuffer));
-        LocalFree(messageBuffer);
-
-        /// try again only in two cases"
-        /// 1.it is nonblocking socket with WSAEWOULDBLOCK, it is not like a error
-        /// 2. other error occurs but it is not WSAEMSGSIZE, we can avoid to send
-        /// bigger dagram than max MSGSIZE by when client connects to server
-        ///  by Calling ServerApplication::Connect()
-        if ((binding.isNonBlocking && errno == WSAEWOULDBLOCK) ||
-                err != WSAEMSGSIZE)
+        if (cm->cmsg_level == SOL_SOCKET && cm->cmsg_type == SO_RXQ_OVFL)
         {
-            goto TRY_ONE_MORE_TIME;
+            uint32_t total;
+            memcpy(&total, CMSG_DATA(cm), sizeof(uint32_t));
+            dropped = total;
+            return;
         }
-        sendParameters->bytesWritten = WSAEMSGSIZE;
-#elif (defined(__GNUC__) || defined(__GCCXML__) )
-        fprintf(stderr,
-                "JISBerkley::SendWithoutVDP()::sendto__() failed with errno %i(%s) for char %i and length %i.\n",
-                errno, strerror(errno),sendParameters->data[0], sendParameters->length);
+    }
+}
+#else
+#define GECO_RXQ_OVFL_SUPPORTED 0
+#define GECO_RXQ_OVFL_CMSG_SPACE 0
+#endif
+#if defined(recvmmsg__) && defined(IP_RECVTOS)
+#define GECO_ECN_SUPPORTED 1
+/// IP_TOS comes as one byte, IPV6_TCLASS as an int
+#define GECO_ECN_CMSG_SPACE CMSG_SPACE(sizeof(int))
 
-        if ((binding.isNonBlocking && errno == EWOULDBLOCK) || errno != EMSGSIZE)
+/// ECN bits of the TOS or traffic class in @msg, ECN_NOT_ECT if @msg has none
+static uchar GetEcnCodepoint(msghdr *msg)
+{
+    for (cmsghdr* cm = CMSG_FIRSTHDR(msg); cm != 0; cm = CMSG_NXTHDR(msg, cm))
+    {
+        if (cm->cmsg_level == IPPROTO_IP && cm->cmsg_type == IP_TOS)
+            return *(uchar*)CMSG_DATA(cm) & 0x03;
+#if NET_SUPPORT_IPV6 ==1
+        if (cm->cmsg_level == IPPROTO_IPV6 && cm->cmsg_type == IPV6_TCLASS)
         {
-            goto TRY_ONE_MORE_TIME;
+            int tclass;
+            memcpy(&tclass, CMSG_DATA(cm), sizeof(int));
+            return (uchar)(tclass & 0x03);
         }
-        sendParameters->bytesWritten = errno; /// 10040
 #endif
-        /// send failed sendParameters->bytesWritten records the error number
-        /// of EMSGSIZE 10040
-        return len;
-    }
-
-    if (oldTTL != -1)
-    {
-        setsockopt__(rns2Socket, sendParameters->receiverINetAddress.GetIPProtocol(), IP_TTL, (char *)& oldTTL, sizeof(oldTTL));
     }
-
-    /// send succeeds
-    sendParameters->bytesWritten = len;
-    return len;
+    return ECN_NOT_ECT;
 }
+#else
+#define GECO_ECN_SUPPORTED 0
+#define GECO_ECN_CMSG_SPACE 0
+#endif
+#if defined(sendmmsg__) && defined(SO_TXTIME)
+#define GECO_TXTIME_SUPPORTED 1
+#define GECO_TXTIME_CMSG_SPACE CMSG_SPACE(sizeof(uint64_t))
 
-void berkley_socket_t::GetSystemAddressViaJISSocket(socket_fd_t rns2Socket, network_address_t *systemAddressOut)
+/// writes @txTime as the SCM_TXTIME kernel wants, ns of CLOCK_MONOTONIC, into @control
+/// which has GECO_TXTIME_CMSG_SPACE bytes. returns control bytes used, 0 if none
+static socklen_t PutTxTime(char *control, TimeUS txTime)
 {
-    WSAStartupSingleton::AddRef();
-    GetSystemAddressViaJISSocketIPV4And6(rns2Socket, systemAddressOut);
-    WSAStartupSingleton::Deref();
+    if (txTime == 0) return 0;
+    /// Get64BitsTimeUS() runs on another clock, carry the distance from now over
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    int64_t ahead = (int64_t)(txTime - Get64BitsTimeUS());
+    if (ahead <= 0) return 0;
+    uint64_t ns = ts.tv_sec * (uint64_t)1000000000 + ts.tv_nsec + (uint64_t)ahead * 1000;
+
+    memset(control, 0, GECO_TXTIME_CMSG_SPACE);
+    cmsghdr *cm = (cmsghdr*)control;
+    cm->cmsg_level = SOL_SOCKET;
+    cm->cmsg_type = SCM_TXTIME;
+    cm->cmsg_len = CMSG_LEN(sizeof(uint64_t));
+    memcpy(CMSG_DATA(cm), &ns, sizeof(uint64_t));
+    return CMSG_SPACE(sizeof(uint64_t));
 }
-void berkley_socket_t::GetSystemAddressViaJISSocketIPV4(socket_fd_t rns2Socket,
-        network_address_t *systemAddressOut)
+#else
+#define GECO_TXTIME_SUPPORTED 0
+#define GECO_TXTIME_CMSG_SPACE 0
+#endif
+/// control room of one recvmmsg() entry with every cmsg above turned on
+#define GECO_RECV_CMSG_SUPPORTED (GECO_RECV_TIMESTAMP_SUPPORTED == 1 || GECO_PKTINFO_SUPPORTED == 1 || \
+    GECO_RXQ_OVFL_SUPPORTED == 1 || GECO_ECN_SUPPORTED == 1)
+#define GECO_RECV_CMSG_SPACE (GECO_TIMESTAMP_CMSG_SPACE + GECO_PKTINFO_CMSG_SPACE + GECO_RXQ_OVFL_CMSG_SPACE + \
+    GECO_ECN_CMSG_SPACE)
+/// control room of one sent datagram with every cmsg above turned on
+#define GECO_SEND_CMSG_SUPPORTED (GECO_PKTINFO_SUPPORTED == 1 || GECO_TXTIME_SUPPORTED == 1)
+#define GECO_SEND_CMSG_SPACE (GECO_PKTINFO_CMSG_SPACE + GECO_TXTIME_CMSG_SPACE)
+#if GECO_SEND_CMSG_SUPPORTED
+/// writes the pktinfo (if @pktInfo) and the departure time (if @txTime) of
+/// @sendParameters into @control which has GECO_SEND_CMSG_SPACE bytes, returns bytes used
+static socklen_t PutSendControls(char *control, const send_params_t& sendParameters, bool pktInfo, bool txTime)
 {
-    static sockaddr_in sa;
-    static socklen_t len = sizeof(sa);
-    //memset(&sa, 0, sizeof(sockaddr_in));
+    socklen_t len = 0;
+#if GECO_PKTINFO_SUPPORTED == 1
+    if (pktInfo) len += PutPktInfoAddress(control + len, sendParameters.senderINetAddress);
+#endif
+#if GECO_TXTIME_SUPPORTED == 1
+    if (txTime) len += PutTxTime(control + len, sendParameters.txTime);
+#endif
+    return len;
+}
+#endif
 
-    if (getsockname__(rns2Socket, (struct sockaddr *)&sa, &len) == SOCKET_ERROR)
+int berkley_socket_t::RecvFromBatch(recv_params_t **recvFromStructs, int count)
+{
+    assert(recvFromStructs != 0);
+    assert(count > 0 && count <= GECO_RECV_BATCH_SIZE);
+
+#if defined(recvmmsg__) && GECO_RECV_BATCH_SIZE > 1
+    if (jst == 0 && count > 1 && isRecvBatchSupported)
     {
-#if defined(_WIN32)
-        fprintf_s(stderr, "JISBerkley::GetSystemAddressViaJISSocketIPV4()::getsockname__()::failed with errno code (%s)\n", strerror(WSAGetLastError()));
-#elif (defined(__GNUC__) || defined(__GCCXML__) )
-        fprintf(stderr, "JISBerkley::GetSystemAddressViaJISSocketIPV4()::getsockname__()::failed with errno code (%s)\n", strerror(errno));
+        mmsghdr msgs[GECO_RECV_BATCH_SIZE];
+        iovec iovs[GECO_RECV_BATCH_SIZE];
+#if GECO_RECV_CMSG_SUPPORTED
+        char controls[GECO_RECV_BATCH_SIZE][GECO_RECV_CMSG_SPACE];
 #endif
-        *systemAddressOut = JACKIE_NULL_ADDRESS;
-        return;
-    }
 
-    systemAddressOut->SetPortNetworkOrder(sa.sin_port);
-    systemAddressOut->address.addr4.sin_addr.s_addr = sa.sin_addr.s_addr;
+    TRY_ONE_MORE_TIME:
+        memset(msgs, 0, sizeof(mmsghdr)*count);
 
-    if (systemAddressOut->address.addr4.sin_addr.s_addr == INADDR_ANY)
-    {
-        systemAddressOut->address.addr4.sin_addr.s_addr = inet_addr__("127.0.0.1");
+        /// let the kernel write sender addr straight into each recv param
+        for (int i = 0; i < count; i++)
+        {
+            iovs[i].iov_base = recvFromStructs[i]->data;
+            iovs[i].iov_len = maxMTUSize;
+            msgs[i].msg_hdr.msg_iov = &iovs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+#if GECO_RECV_CMSG_SUPPORTED
+            if (isRecvTimestampEnabled || isPktInfoEnabled || isRxqOvflEnabled || isEcnEnabled)
+            {
+                msgs[i].msg_hdr.msg_control = controls[i];
+                msgs[i].msg_hdr.msg_controllen = sizeof(controls[i]);
+            }
+#endif
+#if NET_SUPPORT_IPV6 ==1
+            msgs[i].msg_hdr.msg_name = &recvFromStructs[i]->senderINetAddress.address.sa_stor;
+            msgs[i].msg_hdr.msg_namelen = sizeof(sockaddr_storage);
+#else
+            msgs[i].msg_hdr.msg_name = &recvFromStructs[i]->senderINetAddress.address.addr4;
+            msgs[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+#endif
+        }
+
+        /// MSG_WAITFORONE: blocking socket only waits for the first datagram,
+        /// then takes whatever else is already queued without blocking again
+        int filled = recvmmsg__(rns2Socket, msgs, count, MSG_WAITFORONE, 0);
+        if (filled < 0)
+        {
+            if (errno == ENOSYS)
+            {
+                /// old kernel, never try it again on this socket
+                isRecvBatchSupported = false;
+            }
+            else
+            {
+                if ((binding.isNonBlocking && errno != EAGAIN && errno != EWOULDBLOCK) || !binding.isNonBlocking)
+                {
+                    fprintf(stderr, "JISBerkley::RecvFromBatch()::recvmmsg__()::failed with errno code (%d-%s)\n", errno, strerror(errno));
+                }
+                return filled;
+            }
+        }
+        else
+        {
+            TimeUS timeRead = Get64BitsTimeUS();
+#if GECO_RECV_TIMESTAMP_SUPPORTED == 1
+            TimeUS realTimeRead = isRecvTimestampEnabled ? GetRealTimeUS() : 0;
+#endif
+            int valid = 0;
+            for (int i = 0; i < filled; i++)
+            {
+                recv_params_t* recvFromStruct = recvFromStructs[i];
+                /// see RecvFromIPV4(), we never accept empty or truncated datagram
+                if (msgs[i].msg_len == 0 || (msgs[i].msg_hdr.msg_flags & MSG_TRUNC))
+                {
+                    fprintf(stderr, "JISBerkley::RecvFromBatch()::recvmmsg__()::drop datagram of %u bytes, the remote sends a bigger datagram than our max mtu\n", msgs[i].msg_len);
+                    continue;
+                }
+                recvFromStruct->bytesRead = msgs[i].msg_len;
+                recvFromStruct->timeRead = timeRead;
+#if GECO_RECV_TIMESTAMP_SUPPORTED == 1
+                if (isRecvTimestampEnabled)
+                    recvFromStruct->timeRead = GetKernelTimeRead(&msgs[i].msg_hdr, timeRead, realTimeRead);
+#endif
+#if GECO_PKTINFO_SUPPORTED == 1
+                if (isPktInfoEnabled)
+                    GetPktInfoAddress(&msgs[i].msg_hdr, boundAddress, recvFromStruct->receiverINetAddress);
+#endif
+#if GECO_RXQ_OVFL_SUPPORTED == 1
+                if (isRxqOvflEnabled)
+                    GetRxqOvflCounter(&msgs[i].msg_hdr, kernelDropped);
+#endif
+#if GECO_ECN_SUPPORTED == 1
+                if (isEcnEnabled)
+                    recvFromStruct->ecn = GetEcnCodepoint(&msgs[i].msg_hdr);
+#endif
+#ifdef _DEBUG
+#if NET_SUPPORT_IPV6 ==1
+                if (recvFromStruct->senderINetAddress.address.sa_stor.ss_family == AF_INET6)
+                    recvFromStruct->senderINetAddress.debugPort = ntohs(recvFromStruct->senderINetAddress.address.addr6.sin6_port);
+                else
+                    recvFromStruct->senderINetAddress.debugPort = ntohs(((sockaddr_in*)&recvFromStruct->senderINetAddress.address.sa_stor)->sin_port);
+#else
+                recvFromStruct->senderINetAddress.debugPort = ntohs(recvFromStruct->senderINetAddress.address.addr4.sin_port);
+#endif
+#endif // _DEBUG
+                /// pack the filled params at the front
+                recvFromStructs[i] = recvFromStructs[valid];
+                recvFromStructs[valid++] = recvFromStruct;
+            }
+            /// all dropped, do not report 0 while more may be queued,
+            /// an edge-triggered caller would stop draining right here
+            if (valid == 0) goto TRY_ONE_MORE_TIME;
+            return valid;
+        }
     }
+#endif
+
+    recv_result_t result = RecvFrom(recvFromStructs[0]);
+    return result > 0 ? 1 : result;
 }
-void berkley_socket_t::GetSystemAddressViaJISSocketIPV4And6(socket_fd_t rns2Socket,
-        network_address_t *systemAddressOut)
+int berkley_socket_t::RecvFromGRO(recv_params_t **recvFromStructs, int count)
 {
-#if NET_SUPPORT_IPV6 ==1
+    assert(recvFromStructs != 0);
+    assert(count > 0 && count <= GECO_GRO_BATCH_SIZE);
 
-    socklen_t slen;
-    sockaddr_storage ss;
-    slen = sizeof(ss);
+    for (int i = 0; i < count; i++)
+    {
+        assert(recvFromStructs[i]->groBuffer != 0);
+        recvFromStructs[i]->data = recvFromStructs[i]->groBuffer->data;
+        recvFromStructs[i]->groSegmentSize = 0;
+    }
 
-    if (getsockname__(rns2Socket, (struct sockaddr *)&ss, &slen) == SOCKET_ERROR)
+#if defined(recvmmsg__)
+    if (jst == 0 && isGROEnabled)
     {
-#if defined(_WIN32)
-        fprintf_s(stderr, "JISBerkley::GetSystemAddressViaJISSocketIPV4And6()::getsockname__()::failed with errno code (%s)\n", strerror(WSAGetLastError()));
+        mmsghdr msgs[GECO_GRO_BATCH_SIZE];
+        iovec iovs[GECO_GRO_BATCH_SIZE];
+        char controls[GECO_GRO_BATCH_SIZE][CMSG_SPACE(sizeof(int)) + GECO_RECV_CMSG_SPACE];
+
+    TRY_ONE_MORE_TIME:
+        memset(msgs, 0, sizeof(mmsghdr)*count);
+
+        for (int i = 0; i < count; i++)
+        {
+            iovs[i].iov_base = recvFromStructs[i]->data;
+            iovs[i].iov_len = GECO_GRO_BUFFER_SIZE;
+            msgs[i].msg_hdr.msg_iov = &iovs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+            msgs[i].msg_hdr.msg_control = controls[i];
+            msgs[i].msg_hdr.msg_controllen = sizeof(controls[i]);
+#if NET_SUPPORT_IPV6 ==1
+            msgs[i].msg_hdr.msg_name = &recvFromStructs[i]->senderINetAddress.address.sa_stor;
+            msgs[i].msg_hdr.msg_namelen = sizeof(sockaddr_storage);
+#else
+            msgs[i].msg_hdr.msg_name = &recvFromStructs[i]->senderINetAddress.address.addr4;
+            msgs[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+#endif
+        }
+
+        int filled = recvmmsg__(rns2Socket, msgs, count, MSG_WAITFORONE, 0);
+        if (filled < 0)
+        {
+            if ((binding.isNonBlocking && errno != EAGAIN && errno != EWOULDBLOCK) || !binding.isNonBlocking)
+            {
+                fprintf(stderr, "JISBerkley::RecvFromGRO()::recvmmsg__()::failed with errno code (%d-%s)\n", errno, strerror(errno));
+            }
+            return filled;
+        }
+
+        TimeUS timeRead = Get64BitsTimeUS();
+#if GECO_RECV_TIMESTAMP_SUPPORTED == 1
+        TimeUS realTimeRead = isRecvTimestampEnabled ? GetRealTimeUS() : 0;
+#endif
+        int valid = 0;
+        for (int i = 0; i < filled; i++)
+        {
+            recv_params_t* recvFromStruct = recvFromStructs[i];
+            if (msgs[i].msg_len == 0 || (msgs[i].msg_hdr.msg_flags & MSG_TRUNC))
+                continue;
+
+            recvFromStruct->bytesRead = msgs[i].msg_len;
+            recvFromStruct->timeRead = timeRead;
+#if GECO_RECV_TIMESTAMP_SUPPORTED == 1
+            if (isRecvTimestampEnabled)
+                recvFromStruct->timeRead = GetKernelTimeRead(&msgs[i].msg_hdr, timeRead, realTimeRead);
+#endif
+#if GECO_PKTINFO_SUPPORTED == 1
+            if (isPktInfoEnabled)
+                GetPktInfoAddress(&msgs[i].msg_hdr, boundAddress, recvFromStruct->receiverINetAddress);
+#endif
+#if GECO_RXQ_OVFL_SUPPORTED == 1
+            if (isRxqOvflEnabled)
+                GetRxqOvflCounter(&msgs[i].msg_hdr, kernelDropped);
+#endif
+#if GECO_ECN_SUPPORTED == 1
+            if (isEcnEnabled)
+                recvFromStruct->ecn = GetEcnCodepoint(&msgs[i].msg_hdr);
+#endif
+            for (cmsghdr* cm = CMSG_FIRSTHDR(&msgs[i].msg_hdr); cm != 0; cm = CMSG_NXTHDR(&msgs[i].msg_hdr, cm))
+            {
+                if (cm->cmsg_level == IPPROTO_UDP && cm->cmsg_type == UDP_GRO)
+                    recvFromStruct->groSegmentSize = *(int*)CMSG_DATA(cm);
+            }
+            /// a lone datagram is reported with gso size of its own length, or not at all
+            if (recvFromStruct->groSegmentSize >= recvFromStruct->bytesRead)
+                recvFromStruct->groSegmentSize = 0;
+
+            recvFromStructs[i] = recvFromStructs[valid];
+            recvFromStructs[valid++] = recvFromStruct;
+        }
+        if (valid == 0) goto TRY_ONE_MORE_TIME;
+        return valid;
+    }
+#endif
+
+    /// no gro, one plain datagram into the first buffer
+    recv_result_t result = RecvFrom(recvFromStructs[0]);
+    return result > 0 ? 1 : result;
+}
+bool berkley_socket_t::EnableGRO(void)
+{
+#if defined(recvmmsg__)
+    int one = 1;
+    if (setsockopt__(rns2Socket, IPPROTO_UDP, UDP_GRO, (char *)& one, sizeof(one)) == 0)
+    {
+        isGROEnabled = true;
+        return true;
+    }
+    fprintf(stderr, "JISBerkley::EnableGRO()::setsockopt__()::failed with errno code (%d-%s)\n", errno, strerror(errno));
+#endif
+    return false;
+}
+bool berkley_socket_t::EnableRecvTimestamps(void)
+{
+#if GECO_RECV_TIMESTAMP_SUPPORTED == 1
+    int one = 1;
+    if (setsockopt__(rns2Socket, SOL_SOCKET, SO_TIMESTAMPNS, (char *)& one, sizeof(one)) == 0)
+    {
+        isRecvTimestampEnabled = true;
+        return true;
+    }
+    fprintf(stderr, "JISBerkley::EnableRecvTimestamps()::setsockopt__()::failed with errno code (%d-%s)\n", errno, strerror(errno));
+#endif
+    return false;
+}
+bool berkley_socket_t::EnableRxqOvfl(void)
+{
+#if GECO_RXQ_OVFL_SUPPORTED == 1
+    int one = 1;
+    if (setsockopt__(rns2Socket, SOL_SOCKET, SO_RXQ_OVFL, (char *)& one, sizeof(one)) == 0)
+    {
+        isRxqOvflEnabled = true;
+        return true;
+    }
+    fprintf(stderr, "JISBerkley::EnableRxqOvfl()::setsockopt__()::failed with errno code (%d-%s)\n", errno, strerror(errno));
+#endif
+    return false;
+}
+bool berkley_socket_t::SetRecvBufSize(int size)
+{
+    int ret = SOCKET_ERROR;
+#if defined(SO_RCVBUFFORCE)
+    /// goes beyond net.core.rmem_max, only with CAP_NET_ADMIN
+    ret = setsockopt__(rns2Socket, SOL_SOCKET, SO_RCVBUFFORCE, (char *)& size, sizeof(size));
+#endif
+    if (ret != 0) ret = setsockopt__(rns2Socket, SOL_SOCKET, SO_RCVBUF, (char *)& size, sizeof(size));
+    if (ret != 0)
+    {
+        fprintf(stderr, "JISBerkley::SetRecvBufSize()::setsockopt__()::failed with errno code (%d-%s)\n", errno, strerror(errno));
+        return false;
+    }
+
+    /// kernel silently caps it, keep what we really got so growing stops at the cap
+    int actual = GetKernelRecvBufSize();
+    recvBufSize = actual > 0 && actual < size ? actual : size;
+    return true;
+}
+int berkley_socket_t::GetKernelRecvBufSize(void) const
+{
+    int actual = 0;
+    socklen_t len = sizeof(actual);
+    if (getsockopt__(rns2Socket, SOL_SOCKET, SO_RCVBUF, (char *)& actual, &len) != 0 || actual < 0)
+        return 0;
+#if defined(__linux__)
+    /// linux reports twice the size, the other half is for its bookkeeping
+    actual /= 2;
+#endif
+    return actual;
+}
+void berkley_socket_t::AdjustRecvBufSize(TimeMS now)
+{
+    if (!isRxqOvflEnabled || (int)(now - nextAdjustTime) < 0) return;
+    nextAdjustTime = now + GECO_SO_REVBUF_ADJUST_INTERVAL_MS;
+
+    uint dropped = kernelDropped - kernelDroppedAtLastAdjust;
+    kernelDroppedAtLastAdjust = kernelDropped;
+
+    if (dropped > 0)
+    {
+        quietAdjustIntervals = 0;
+        int size = recvBufSize * 2 < GECO_SO_REVBUF_MAX_SIZE ? recvBufSize * 2 : GECO_SO_REVBUF_MAX_SIZE;
+        int old = recvBufSize;
+        if (size > recvBufSize) SetRecvBufSize(size);
+        if (recvBufSize > old)
+        {
+            fprintf(stderr, "JISBerkley::AdjustRecvBufSize()::kernel dropped %u datagrams on %s, SO_RCVBUF %d -> %d\n",
+                dropped, boundAddress.ToString(), old, recvBufSize);
+        }
+        else if (!isRecvBufAtMax)
+        {
+            /// GECO_SO_REVBUF_MAX_SIZE or net.core.rmem_max, drops from now on are only counted
+            isRecvBufAtMax = true;
+            fprintf(stderr, "JISBerkley::AdjustRecvBufSize()::kernel dropped %u datagrams on %s, SO_RCVBUF is at its max %d\n",
+                dropped, boundAddress.ToString(), recvBufSize);
+        }
+    }
+    else if (recvBufSize > GECO_SO_REVBUF_SIZE && ++quietAdjustIntervals >= GECO_SO_REVBUF_SHRINK_INTERVALS)
+    {
+        quietAdjustIntervals = 0;
+        int size = recvBufSize / 2 > GECO_SO_REVBUF_SIZE ? recvBufSize / 2 : GECO_SO_REVBUF_SIZE;
+        SetRecvBufSize(size);
+        isRecvBufAtMax = false;
+    }
+}
+bool berkley_socket_t::EnablePathMtuProbe(void)
+{
+#if defined(IP_MTU_DISCOVER) && defined(IP_PMTUDISC_PROBE)
+    int val = IP_PMTUDISC_PROBE;
+    int ret;
+#if NET_SUPPORT_IPV6 ==1 && defined(IPV6_MTU_DISCOVER) && defined(IPV6_PMTUDISC_PROBE)
+    if (boundAddress.GetIPVersion() == 6)
+    {
+        val = IPV6_PMTUDISC_PROBE;
+        ret = setsockopt__(rns2Socket, IPPROTO_IPV6, IPV6_MTU_DISCOVER, (char *)& val, sizeof(val));
+        /// v4-mapped traffic on a dual stack socket follows the ipv4 option
+        val = IP_PMTUDISC_PROBE;
+        setsockopt__(rns2Socket, IPPROTO_IP, IP_MTU_DISCOVER, (char *)& val, sizeof(val));
+    }
+    else
+#endif
+    {
+        ret = setsockopt__(rns2Socket, IPPROTO_IP, IP_MTU_DISCOVER, (char *)& val, sizeof(val));
+    }
+    if (ret == 0)
+    {
+        isPathMtuProbeEnabled = true;
+        return true;
+    }
+    fprintf(stderr, "JISBerkley::EnablePathMtuProbe()::setsockopt__()::failed with errno code (%d-%s)\n", errno, strerror(errno));
+#endif
+    return false;
+}
+bool berkley_socket_t::ConnectTo(const network_address_t& peer)
+{
+    socklen_t len = sizeof(sockaddr_in);
+#if NET_SUPPORT_IPV6 ==1
+    if (peer.GetIPVersion() == 6) len = sizeof(sockaddr_in6);
+#endif
+    if (connect__(rns2Socket, (const sockaddr*)&peer.address, len) != 0)
+    {
+        fprintf(stderr, "JISBerkley::ConnectTo()::connect__()::failed with errno code (%d-%s)\n", errno, strerror(errno));
+        return false;
+    }
+    connectedAddress = peer;
+    return true;
+}
+bool berkley_socket_t::EnableEcn(void)
+{
+#if GECO_ECN_SUPPORTED == 1
+    int ect0 = ECN_ECT0;
+    int one = 1;
+    int ret;
+#if NET_SUPPORT_IPV6 ==1 && defined(IPV6_TCLASS) && defined(IPV6_RECVTCLASS)
+    if (boundAddress.GetIPVersion() == 6)
+    {
+        ret = setsockopt__(rns2Socket, IPPROTO_IPV6, IPV6_TCLASS, (char *)& ect0, sizeof(ect0));
+        if (ret == 0)
+            ret = setsockopt__(rns2Socket, IPPROTO_IPV6, IPV6_RECVTCLASS, (char *)& one, sizeof(one));
+        /// v4-mapped traffic on a dual stack socket follows the ipv4 options
+        setsockopt__(rns2Socket, IPPROTO_IP, IP_TOS, (char *)& ect0, sizeof(ect0));
+        setsockopt__(rns2Socket, IPPROTO_IP, IP_RECVTOS, (char *)& one, sizeof(one));
+    }
+    else
+#endif
+    {
+        ret = setsockopt__(rns2Socket, IPPROTO_IP, IP_TOS, (char *)& ect0, sizeof(ect0));
+        if (ret == 0)
+            ret = setsockopt__(rns2Socket, IPPROTO_IP, IP_RECVTOS, (char *)& one, sizeof(one));
+    }
+    if (ret == 0)
+    {
+        isEcnEnabled = true;
+        return true;
+    }
+    fprintf(stderr, "JISBerkley::EnableEcn()::setsockopt__()::failed with errno code (%d-%s)\n", errno, strerror(errno));
+#endif
+    return false;
+}
+bool berkley_socket_t::EnableTxTime(void)
+{
+#if GECO_TXTIME_SUPPORTED == 1
+    /// fq qdisc only takes CLOCK_MONOTONIC, no deadline mode and no error reports
+    sock_txtime cfg;
+    cfg.clockid = CLOCK_MONOTONIC;
+    cfg.flags = 0;
+    if (setsockopt__(rns2Socket, SOL_SOCKET, SO_TXTIME, (char *)& cfg, sizeof(cfg)) == 0)
+    {
+        isTxTimeEnabled = true;
+        return true;
+    }
+    fprintf(stderr, "JISBerkley::EnableTxTime()::setsockopt__()::failed with errno code (%d-%s)\n", errno, strerror(errno));
+#endif
+    return false;
+}
+bool berkley_socket_t::JoinMulticastGroup(const network_address_t& group)
+{
+    bool ret = false;
+    multicastGroupsMutex.Lock();
+    if (IsMulticastMember(group))
+        ret = true;
+    else if (multicastGroupsSize < GECO_MULTICAST_GROUPS_SIZE && SetMulticastMembership(group, true))
+    {
+        multicastGroups[multicastGroupsSize++] = group;
+        ret = true;
+    }
+    multicastGroupsMutex.Unlock();
+    return ret;
+}
+bool berkley_socket_t::LeaveMulticastGroup(const network_address_t& group)
+{
+    bool ret = false;
+    multicastGroupsMutex.Lock();
+    for (uint i = 0; i < multicastGroupsSize; i++)
+    {
+        if (!multicastGroups[i].EqualsExcludingPort(group)) continue;
+        ret = SetMulticastMembership(group, false);
+        /// kernel drops it with the socket anyway, stop accepting its datagrams now
+        multicastGroups[i] = multicastGroups[--multicastGroupsSize];
+        break;
+    }
+    multicastGroupsMutex.Unlock();
+    return ret;
+}
+bool berkley_socket_t::IsMulticastMember(const network_address_t& addr) const
+{
+    /// recursive mutex, Join and Leave call it with the lock held
+    bool ret = false;
+    multicastGroupsMutex.Lock();
+    for (uint i = 0; i < multicastGroupsSize && !ret; i++)
+        ret = multicastGroups[i].EqualsExcludingPort(addr);
+    multicastGroupsMutex.Unlock();
+    return ret;
+}
+bool berkley_socket_t::SetMulticastMembership(const network_address_t& group, bool join)
+{
+    int ret;
+#if NET_SUPPORT_IPV6 ==1 && defined(IPV6_JOIN_GROUP)
+    if (group.GetIPVersion() == 6)
+    {
+        ipv6_mreq mreq;
+        memset(&mreq, 0, sizeof(mreq));
+        mreq.ipv6mr_multiaddr = group.address.addr6.sin6_addr;
+        /// 0 lets kernel pick the interface by routing table
+        mreq.ipv6mr_interface = 0;
+        ret = setsockopt__(rns2Socket, IPPROTO_IPV6, join ? IPV6_JOIN_GROUP : IPV6_LEAVE_GROUP,
+            (char *)& mreq, sizeof(mreq));
+    }
+    else
+#endif
+    {
+        ip_mreq mreq;
+        memset(&mreq, 0, sizeof(mreq));
+        mreq.imr_multiaddr = group.address.addr4.sin_addr;
+        /// GetBoundAddress() reports a wildcard socket as loopback, ask kernel instead
+        sockaddr_storage ss;
+        socklen_t slen = sizeof(ss);
+        if (getsockname__(rns2Socket, (sockaddr*)&ss, &slen) == 0 && ss.ss_family == AF_INET)
+            mreq.imr_interface = ((sockaddr_in*)&ss)->sin_addr;
+        else
+            mreq.imr_interface.s_addr = htonl(INADDR_ANY);
+        ret = setsockopt__(rns2Socket, IPPROTO_IP, join ? IP_ADD_MEMBERSHIP : IP_DROP_MEMBERSHIP,
+            (char *)& mreq, sizeof(mreq));
+    }
+    if (ret == 0) return true;
+    fprintf(stderr, "JISBerkley::SetMulticastMembership()::setsockopt__()::failed with errno code (%d-%s)\n", errno, strerror(errno));
+    return false;
+}
+bool berkley_socket_t::EnablePktInfo(void)
+{
+#if GECO_PKTINFO_SUPPORTED == 1
+    /// a socket bound to one addr always sends from it, nothing to learn
+    sockaddr_storage ss;
+    socklen_t slen = sizeof(ss);
+    if (getsockname__(rns2Socket, (sockaddr*)&ss, &slen) != 0) return false;
+
+    int one = 1;
+    int ret = -1;
+    if (ss.ss_family == AF_INET)
+    {
+        if (((sockaddr_in*)&ss)->sin_addr.s_addr != INADDR_ANY) return false;
+        ret = setsockopt__(rns2Socket, IPPROTO_IP, IP_PKTINFO, (char *)& one, sizeof(one));
+    }
+#if NET_SUPPORT_IPV6 ==1
+    else if (ss.ss_family == AF_INET6)
+    {
+        /// ipv4 datagrams on a dual stack socket come with v4-mapped IPV6_PKTINFO too
+        if (!IN6_IS_ADDR_UNSPECIFIED(&((sockaddr_in6*)&ss)->sin6_addr)) return false;
+        ret = setsockopt__(rns2Socket, IPPROTO_IPV6, IPV6_RECVPKTINFO, (char *)& one, sizeof(one));
+    }
+#endif
+    if (ret == 0)
+    {
+        isPktInfoEnabled = true;
+        return true;
+    }
+    fprintf(stderr, "JISBerkley::EnablePktInfo()::setsockopt__()::failed with errno code (%d-%s)\n", errno, strerror(errno));
+#endif
+    return false;
+}
+//////////////////////////////////////////////////////////////////////////
+send_result_t berkley_socket_t::Send(send_params_t *sendParameters,
+        const char *file, unsigned int line)
+{
+    /// we will nevwer send o len data
+    assert(sendParameters->data != 0);
+    assert(sendParameters->length > 0);
+
+    if (jst != 0)
+    {
+        return jst->JackieINetSendTo(sendParameters->data,
+                sendParameters->length,
+                sendParameters->receiverINetAddress);
+    }
+    else
+    {
+        return SendWithoutVDP(rns2Socket, sendParameters, file, line);
+    }
+}
+
+send_result_t berkley_socket_t::SendWithoutVDP(socket_fd_t rns2Socket,
+        send_params_t *sendParameters,
+        const char *file, unsigned int line)
+{
+    int len = 0;
+    int oldTTL = -1;
+    int newTTL = -1;
+    socklen_t opLen = sizeof(oldTTL);
+
+    oldTTL = -1;
+    if (sendParameters->ttl > 0)
+    {
+        // Get the current TTL
+        if (getsockopt__(rns2Socket,
+                        sendParameters->receiverINetAddress.GetIPProtocol(), IP_TTL, (char *)& oldTTL, &opLen) != -1)
+        {
+            newTTL = sendParameters->ttl;
+            setsockopt__(rns2Socket, sendParameters->receiverINetAddress.GetIPProtocol(), IP_TTL, (char *)& newTTL, sizeof(newTTL));
+        }
+    }
+
+    TRY_ONE_MORE_TIME:
+#if GECO_SEND_CMSG_SUPPORTED
+    /// wildcard socket pins the source addr with a pktinfo, paced datagram carries
+    /// its departure time, both need sendmsg()
+    if ((isPktInfoEnabled && !IsConnected() && sendParameters->senderINetAddress != JACKIE_NULL_ADDRESS) ||
+        (isTxTimeEnabled && sendParameters->txTime != 0))
+    {
+        char control[GECO_SEND_CMSG_SPACE];
+        iovec iov;
+        iov.iov_base = sendParameters->data;
+        iov.iov_len = sendParameters->length;
+        msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_name = &sendParameters->receiverINetAddress.address;
+#if NET_SUPPORT_IPV6 ==1
+        msg.msg_namelen = sendParameters->receiverINetAddress.address.sa_stor.ss_family == AF_INET6 ?
+            sizeof(sockaddr_in6) : sizeof(sockaddr_in);
+#else
+        msg.msg_namelen = sizeof(sockaddr_in);
+#endif
+        if (IsConnected())
+        {
+            msg.msg_name = 0;
+            msg.msg_namelen = 0;
+        }
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = PutSendControls(control, *sendParameters, !IsConnected() && isPktInfoEnabled, isTxTimeEnabled);
+        if (msg.msg_controllen == 0) msg.msg_control = 0;
+        len = sendmsg__(rns2Socket, &msg, 0);
+    }
+    else
+#endif
+    if (IsConnected())
+    {
+        /// route was looked up once by connect()
+        len = send__(rns2Socket, sendParameters->data, sendParameters->length, 0);
+    }
+    else
+    if (sendParameters->receiverINetAddress.address.addr4.sin_family == AF_INET)
+    {
+        len = sendto__(rns2Socket, sendParameters->data, sendParameters->length, 0, (const sockaddr*)& sendParameters->receiverINetAddress.address.addr4, sizeof(sockaddr_in));
+    }
+    else
+    {
+#if NET_SUPPORT_IPV6 ==1
+        len = sendto__(rns2Socket, sendParameters->data, sendParameters->length, 0, (const sockaddr*)& sendParameters->receiverINetAddress.address.addr6, sizeof(sockaddr_in6));
+#endif
+    }
+
+    /// only when sendParameters->length == 0, sendto() will return 0;
+    /// otherwise it will return > 0, or error code of -1
+    /// we forbid to send o length data
+    ///assert(len != 0);
+
+    if (len < 0)
+    {
+#if defined(_WIN32)
+        DWORD err = GetLastError();
+        HLOCAL messageBuffer = 0;
+        FormatMessage(FORMAT_MESSAGE_ALLOCATE_BUFFER | FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS,
+                NULL, GetLastError(),
+                MAKELANGID(LANG_NEUTRAL, SUBLANG_DEFAULT),  // Default language
+                (PTSTR)& messageBuffer, 0, 0);
+        // I see this hit on XP with IPV6 for some reason
+        fwprintf(stderr, L"JISBerkley::RecvFromNonBlockingIPV4()::sendto__()::failed with errno code (%d, %ls)\n",
+                GetLastError(), (PCTSTR)LocalLock(messageBuffer));
+        LocalFree(messageBuffer);
+
+        /// try again only in two cases"
+        /// 1.it is nonblocking socket with WSAEWOULDBLOCK, it is not like a error
+        /// 2. other error occurs but it is not WSAEMSGSIZE, we can avoid to send
+        /// bigger dagram than max MSGSIZE by when client connects to server
+        ///  by Calling ServerApplication::Connect()
+        if ((binding.isNonBlocking && errno == WSAEWOULDBLOCK) ||
+                err != WSAEMSGSIZE)
+        {
+            goto TRY_ONE_MORE_TIME;
+        }
+        sendParameters->bytesWritten = WSAEMSGSIZE;
+#elif (defined(__GNUC__) || defined(__GCCXML__) )
+        fprintf(stderr,
+                "JISBerkley::SendWithoutVDP()::sendto__() failed with errno %i(%s) for char %i and length %i.\n",
+                errno, strerror(errno),sendParameters->data[0], sendParameters->length);
+
+        if ((binding.isNonBlocking && errno == EWOULDBLOCK) || errno != EMSGSIZE)
+        {
+            goto TRY_ONE_MORE_TIME;
+        }
+        sendParameters->bytesWritten = errno; /// 10040
+#endif
+        /// send failed sendParameters->bytesWritten records the error number
+        /// of EMSGSIZE 10040
+        return len;
+    }
+
+    if (oldTTL != -1)
+    {
+        setsockopt__(rns2Socket, sendParameters->receiverINetAddress.GetIPProtocol(), IP_TTL, (char *)& oldTTL, sizeof(oldTTL));
+    }
+
+    /// send succeeds
+    sendParameters->bytesWritten = len;
+    return len;
+}
+
+bool berkley_socket_t::QueueSend(const send_params_t *sendParameters)
+{
+    assert(sendParameters->data != 0);
+    assert(sendParameters->length > 0 && sendParameters->length <= maxMTUSize);
+
+    if (queuedSendsSize == GECO_SEND_BATCH_SIZE) return false;
+    if (queuedSends == 0)
+        queuedSends = OP_NEW_ARRAY<send_params_t>(GECO_SEND_BATCH_SIZE, TRACKE_MALLOC);
+    if (queuedSendsData == 0)
+        queuedSendsData = OP_NEW_ARRAY<char>(GECO_SEND_BATCH_SIZE * maxMTUSize, TRACKE_MALLOC);
+
+    send_params_t& queued = queuedSends[queuedSendsSize];
+    queued.data = queuedSendsData + queuedSendsBytes;
+    memcpy(queued.data, sendParameters->data, sendParameters->length);
+    queuedSendsBytes += sendParameters->length;
+    queued.length = sendParameters->length;
+    queued.bytesWritten = 0;
+    queued.receiverINetAddress = sendParameters->receiverINetAddress;
+    queued.ttl = sendParameters->ttl;
+    queued.senderINetAddress = sendParameters->senderINetAddress;
+    queued.txTime = sendParameters->txTime;
+    queuedSendsSize++;
+    return true;
+}
+
+int berkley_socket_t::FlushQueuedSends(const char *file, unsigned int line)
+{
+    int sent = 0;
+    int first = 0;
+    while (first < queuedSendsSize)
+    {
+        /// what comes before the next run or ttl datagram goes out batched, the run
+        /// as one buffer and the ttl one on its own between setsockopt() calls, so
+        /// datagrams still leave in the order they were queued
+        int last = first;
+        int runSize = 1;
+        while (last < queuedSendsSize && queuedSends[last].ttl == 0 &&
+            (runSize = GetQueuedRunSize(last)) < 2) last++;
+        if (last > first) sent += SendQueuedBatch(first, last, file, line);
+        if (last == queuedSendsSize) break;
+        if (queuedSends[last].ttl > 0)
+        {
+            sent += SendQueuedBatch(last, last + 1, file, line);
+            first = last + 1;
+            continue;
+        }
+        sent += SendQueuedRun(last, runSize, file, line);
+        first = last + runSize;
+    }
+    return sent;
+}
+
+int berkley_socket_t::GetQueuedRunSize(int first) const
+{
+    int count = 1;
+#if defined(__linux__) && !defined(ANDROID) && GECO_ENABLE_UDP_GSO == 1
+    if (jst != 0 || !isGSOSupported) return 1;
+    const send_params_t& head = queuedSends[first];
+    if (head.ttl > 0 || head.bytesWritten != 0) return 1;
+    for (int i = first + 1; i < queuedSendsSize; i++)
+    {
+        const send_params_t& queued = queuedSends[i];
+        /// every segment but the last has the size of the first one
+        if (queuedSends[i - 1].length != head.length || queued.length > head.length) break;
+        if (queued.ttl > 0 || queued.bytesWritten != 0) break;
+        if (queued.receiverINetAddress != head.receiverINetAddress) break;
+        if (queued.data != queuedSends[i - 1].data + queuedSends[i - 1].length) break;
+#if GECO_SEND_CMSG_SUPPORTED
+        /// segments share the controls of the first one
+        if (isPktInfoEnabled && queued.senderINetAddress != head.senderINetAddress) break;
+        if (isTxTimeEnabled && queued.txTime != head.txTime) break;
+#endif
+        count++;
+    }
+#else
+    (void)first;
+#endif
+    return count;
+}
+
+int berkley_socket_t::SendQueuedRun(int first, int count, const char *file, unsigned int line)
+{
+    send_params_t run = queuedSends[first];
+    int segmentSize = run.length;
+    for (int i = first + 1; i < first + count; i++)
+        run.length += queuedSends[i].length;
+
+    /// batch buffer takes the next datagrams right after the flush, no zerocopy
+    SendSegmented(&run, segmentSize, false, file, line);
+    int written = run.bytesWritten > 0 ? run.bytesWritten : 0;
+    int sent = 0;
+    for (int i = first; i < first + count; i++)
+    {
+        send_params_t& queued = queuedSends[i];
+        if (written >= queued.length)
+        {
+            queued.bytesWritten = queued.length;
+            written -= queued.length;
+            sent++;
+        }
+        else
+        {
+            queued.bytesWritten = -1;
+        }
+    }
+    return sent;
+}
+
+int berkley_socket_t::SendQueuedBatch(int first, int last, const char *file, unsigned int line)
+{
+    int sent = 0;
+
+#if defined(sendmmsg__) && GECO_SEND_BATCH_SIZE > 1
+    if (jst == 0 && last - first > 1 && isSendBatchSupported)
+    {
+        mmsghdr msgs[GECO_SEND_BATCH_SIZE];
+        iovec iovs[GECO_SEND_BATCH_SIZE];
+        int queuedIndex[GECO_SEND_BATCH_SIZE];
+#if GECO_SEND_CMSG_SUPPORTED
+        char controls[GECO_SEND_BATCH_SIZE][GECO_SEND_CMSG_SPACE];
+#endif
+        int count = 0;
+
+        /// FlushQueuedSends() hands a datagram with ttl over alone, it needs
+        /// setsockopt() around it and is left to SendWithoutVDP()
+        for (int i = first; i < last; i++)
+        {
+            send_params_t& queued = queuedSends[i];
+            if (queued.ttl > 0 || queued.bytesWritten != 0) continue;
+
+            iovs[count].iov_base = queued.data;
+            iovs[count].iov_len = queued.length;
+            memset(&msgs[count], 0, sizeof(mmsghdr));
+            msgs[count].msg_hdr.msg_iov = &iovs[count];
+            msgs[count].msg_hdr.msg_iovlen = 1;
+            msgs[count].msg_hdr.msg_name = &queued.receiverINetAddress.address;
+#if NET_SUPPORT_IPV6 ==1
+            msgs[count].msg_hdr.msg_namelen = queued.receiverINetAddress.address.sa_stor.ss_family == AF_INET6 ?
+                sizeof(sockaddr_in6) : sizeof(sockaddr_in);
+#else
+            msgs[count].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+#endif
+            if (IsConnected())
+            {
+                msgs[count].msg_hdr.msg_name = 0;
+                msgs[count].msg_hdr.msg_namelen = 0;
+            }
+#if GECO_SEND_CMSG_SUPPORTED
+            if ((isPktInfoEnabled && !IsConnected()) || isTxTimeEnabled)
+            {
+                msgs[count].msg_hdr.msg_controllen = PutSendControls(controls[count], queued,
+                    isPktInfoEnabled && !IsConnected(), isTxTimeEnabled);
+                if (msgs[count].msg_hdr.msg_controllen > 0) msgs[count].msg_hdr.msg_control = controls[count];
+            }
+#endif
+            queuedIndex[count++] = i;
+        }
+
+        int next = 0;
+        while (next < count)
+        {
+            int len = sendmmsg__(rns2Socket, msgs + next, count - next, 0);
+            if (len > 0)
+            {
+                for (int i = next; i < next + len; i++)
+                    queuedSends[queuedIndex[i]].bytesWritten = msgs[i].msg_len;
+                sent += len;
+                next += len;
+                continue;
+            }
+
+            if (errno == ENOSYS)
+            {
+                /// old kernel, the rest go out one by one below
+                isSendBatchSupported = false;
+                break;
+            }
+
+            /// same as SendWithoutVDP(), socket buffer is full, just try again
+            if (errno == EINTR || (binding.isNonBlocking && (errno == EAGAIN || errno == EWOULDBLOCK)))
+                continue;
+
+            /// sendmmsg() reports the error of the first unsent datagram only,
+            /// record it on that one and carry on with the ones behind it
+            send_params_t& failed = queuedSends[queuedIndex[next]];
+            fprintf(stderr,
+                "JISBerkley::FlushQueuedSends()::sendmmsg__() failed with errno %i(%s) for char %i and length %i.\n",
+                errno, strerror(errno), failed.data[0], failed.length);
+            failed.bytesWritten = -errno;
+            next++;
+        }
+    }
+#endif
+
+    /// whatever sendmmsg() has not touched
+    for (int i = first; i < last; i++)
+    {
+        send_params_t& queued = queuedSends[i];
+        if (queued.bytesWritten != 0) continue;
+        send_result_t len = Send(&queued, file, line);
+        if (len > 0)
+        {
+            queued.bytesWritten = len;
+            sent++;
+        }
+        else
+        {
+            queued.bytesWritten = -1;
+        }
+    }
+
+    return sent;
+}
+
+send_result_t berkley_socket_t::SendSegmented(send_params_t *sendParameters, int segmentSize,
+        bool zeroCopy, const char *file, unsigned int line)
+{
+    assert(sendParameters->data != 0);
+    assert(sendParameters->length > 0);
+    assert(segmentSize > 0 && segmentSize <= maxMTUSize);
+
+    int sent = 0;
+
+#if defined(__linux__) && !defined(ANDROID) && GECO_ENABLE_UDP_GSO == 1
+    if (jst == 0 && sendParameters->ttl <= 0 && isGSOSupported &&
+            sendParameters->length > segmentSize)
+    {
+        /// kernel refuses more than 64 segments or a 64KB udp payload in one gso send
+        static const int GSO_MAX_SEGMENTS = 64;
+        static const int GSO_MAX_BYTES = 65507;
+        int bytesPerCall = GSO_MAX_SEGMENTS * segmentSize;
+        if (bytesPerCall > GSO_MAX_BYTES)
+            bytesPerCall = (GSO_MAX_BYTES / segmentSize) * segmentSize;
+
+        /// optmem pinned by zerocopy sends that kernel has not finished with yet
+        static const int ZEROCOPY_ENOBUFS_RETRIES = 4;
+        int zeroCopyRetries = 0;
+
+        char control[CMSG_SPACE(sizeof(unsigned short)) + GECO_SEND_CMSG_SPACE];
+        while (sent < sendParameters->length)
+        {
+            int len = sendParameters->length - sent;
+            if (len > bytesPerCall) len = bytesPerCall;
+
+            iovec iov;
+            iov.iov_base = sendParameters->data + sent;
+            iov.iov_len = len;
+
+            msghdr msg;
+            memset(&msg, 0, sizeof(msg));
+            msg.msg_name = &sendParameters->receiverINetAddress.address;
+#if NET_SUPPORT_IPV6 ==1
+            msg.msg_namelen = sendParameters->receiverINetAddress.address.sa_stor.ss_family == AF_INET6 ?
+                sizeof(sockaddr_in6) : sizeof(sockaddr_in);
+#else
+            msg.msg_namelen = sizeof(sockaddr_in);
+#endif
+            if (IsConnected())
+            {
+                msg.msg_name = 0;
+                msg.msg_namelen = 0;
+            }
+            msg.msg_iov = &iov;
+            msg.msg_iovlen = 1;
+
+            /// the tail may be a single segment, it needs no gso
+            if (len > segmentSize)
+            {
+                memset(control, 0, CMSG_SPACE(sizeof(unsigned short)));
+                msg.msg_control = control;
+                msg.msg_controllen = CMSG_SPACE(sizeof(unsigned short));
+                cmsghdr* cm = CMSG_FIRSTHDR(&msg);
+                cm->cmsg_level = IPPROTO_UDP;
+                cm->cmsg_type = UDP_SEGMENT;
+                cm->cmsg_len = CMSG_LEN(sizeof(unsigned short));
+                *(unsigned short*)CMSG_DATA(cm) = (unsigned short)segmentSize;
+            }
+#if GECO_SEND_CMSG_SUPPORTED
+            /// all segments of one gso send share the departure time
+            if ((isPktInfoEnabled && !IsConnected()) || isTxTimeEnabled)
+            {
+                msg.msg_control = control;
+                msg.msg_controllen += PutSendControls(control + msg.msg_controllen, *sendParameters,
+                    isPktInfoEnabled && !IsConnected(), isTxTimeEnabled);
+                if (msg.msg_controllen == 0) msg.msg_control = 0;
+            }
+#endif
+
+            int flags = 0;
+            if (zeroCopy && isZeroCopyEnabled && len >= GECO_ZEROCOPY_MIN_BYTES) flags |= MSG_ZEROCOPY;
+
+            int ret = sendmsg__(rns2Socket, &msg, flags);
+            if (ret >= 0)
+            {
+                sent += ret;
+                if (flags & MSG_ZEROCOPY) zeroCopyIssued++;
+                continue;
+            }
+
+            /// same as SendWithoutVDP(), socket buffer is full, just try again
+            if (errno == EINTR || (binding.isNonBlocking && (errno == EAGAIN || errno == EWOULDBLOCK)))
+                continue;
+
+            /// optmem is used up by pinned pages, free some by reaping completions.
+            /// kernel may not be done with any of them yet, then copy the rest instead
+            if (errno == ENOBUFS && (flags & MSG_ZEROCOPY))
+            {
+                if (ReapZeroCopyCompletions() == 0 || ++zeroCopyRetries >= ZEROCOPY_ENOBUFS_RETRIES)
+                    zeroCopy = false;
+                continue;
+            }
+
+            /// kernel too old for UDP_SEGMENT or device cannot do checksum offload
+            if (errno == EINVAL || errno == EIO || errno == ENOPROTOOPT || errno == EOPNOTSUPP)
+            {
+                fprintf(stderr, "JISBerkley::SendSegmented()::sendmsg__()::UDP_SEGMENT is not supported (%d-%s), fall back to user space split\n", errno, strerror(errno));
+                isGSOSupported = false;
+                break;
+            }
+
+            fprintf(stderr,
+                    "JISBerkley::SendSegmented()::sendmsg__() failed with errno %i(%s) for char %i and length %i.\n",
+                    errno, strerror(errno), sendParameters->data[0], sendParameters->length);
+            sendParameters->bytesWritten = sent;
+            return -1;
+        }
+
+        if (sent == sendParameters->length)
+        {
+            sendParameters->bytesWritten = sent;
+            return sent;
+        }
+    }
+#endif
+
+    /// no gso, still send every segment right out of caller's buffer
+    send_params_t segment = *sendParameters;
+    while (sent < sendParameters->length)
+    {
+        segment.data = sendParameters->data + sent;
+        segment.length = sendParameters->length - sent;
+        if (segment.length > segmentSize) segment.length = segmentSize;
+        if (Send(&segment, file, line) <= 0)
+        {
+            sendParameters->bytesWritten = sent;
+            return -1;
+        }
+        sent += segment.length;
+    }
+
+    sendParameters->bytesWritten = sent;
+    return sent;
+}
+
+bool berkley_socket_t::EnableZeroCopy(void)
+{
+#if defined(__linux__) && !defined(ANDROID)
+    int one = 1;
+    if (setsockopt__(rns2Socket, SOL_SOCKET, SO_ZEROCOPY, (char *)& one, sizeof(one)) == 0)
+    {
+        isZeroCopyEnabled = true;
+        return true;
+    }
+    fprintf(stderr, "JISBerkley::EnableZeroCopy()::setsockopt__()::failed with errno code (%d-%s)\n", errno, strerror(errno));
+#endif
+    return false;
+}
+
+int berkley_socket_t::ReapZeroCopyCompletions(void)
+{
+    int reaped = 0;
+
+#if defined(__linux__) && !defined(ANDROID)
+    if (zeroCopyCompleted == zeroCopyIssued) return 0;
+
+    char control[128];
+    while (true)
+    {
+        msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        /// MSG_ERRQUEUE never blocks, EAGAIN means nothing more to reap
+        if (recvmsg__(rns2Socket, &msg, MSG_ERRQUEUE) < 0) break;
+
+        for (cmsghdr* cm = CMSG_FIRSTHDR(&msg); cm != 0; cm = CMSG_NXTHDR(&msg, cm))
+        {
+            if (!(cm->cmsg_level == IPPROTO_IP && cm->cmsg_type == IP_RECVERR) &&
+                    !(cm->cmsg_level == IPPROTO_IPV6 && cm->cmsg_type == IPV6_RECVERR))
+                continue;
+
+            sock_extended_err* serr = (sock_extended_err*)CMSG_DATA(cm);
+            if (serr->ee_errno != 0 || serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY) continue;
+
+            /// [ee_info, ee_data] is the range of sends that kernel has done with
+            reaped += serr->ee_data - serr->ee_info + 1;
+            zeroCopyCompleted = serr->ee_data + 1;
+
+            /// kernel had to copy anyway (eg. loopback or no sg support on device),
+            /// zerocopy then only adds overhead
+            if (serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) isZeroCopyEnabled = false;
+        }
+    }
+#endif
+
+    return reaped;
+}
+
+void berkley_socket_t::GetSystemAddressViaJISSocket(socket_fd_t rns2Socket, network_address_t *systemAddressOut)
+{
+    WSAStartupSingleton::AddRef();
+    GetSystemAddressViaJISSocketIPV4And6(rns2Socket, systemAddressOut);
+    WSAStartupSingleton::Deref();
+}
+void berkley_socket_t::GetSystemAddressViaJISSocketIPV4(socket_fd_t rns2Socket,
+        network_address_t *systemAddressOut)
+{
+    static sockaddr_in sa;
+    static socklen_t len = sizeof(sa);
+    //memset(&sa, 0, sizeof(sockaddr_in));
+
+    if (getsockname__(rns2Socket, (struct sockaddr *)&sa, &len) == SOCKET_ERROR)
+    {
+#if defined(_WIN32)
+        fprintf_s(stderr, "JISBerkley::GetSystemAddressViaJISSocketIPV4()::getsockname__()::failed with errno code (%s)\n", strerror(WSAGetLastError()));
+#elif (defined(__GNUC__) || defined(__GCCXML__) )
+        fprintf(stderr, "JISBerkley::GetSystemAddressViaJISSocketIPV4()::getsockname__()::failed with errno code (%s)\n", strerror(errno));
+#endif
+        *systemAddressOut = JACKIE_NULL_ADDRESS;
+        return;
+    }
+
+    systemAddressOut->SetPortNetworkOrder(sa.sin_port);
+    systemAddressOut->address.addr4.sin_addr.s_addr = sa.sin_addr.s_addr;
+
+    if (systemAddressOut->address.addr4.sin_addr.s_addr == INADDR_ANY)
+    {
+        systemAddressOut->address.addr4.sin_addr.s_addr = inet_addr__("127.0.0.1");
+    }
+}
+void berkley_socket_t::GetSystemAddressViaJISSocketIPV4And6(socket_fd_t rns2Socket,
+        network_address_t *systemAddressOut)
+{
+#if NET_SUPPORT_IPV6 ==1
+
+    socklen_t slen;
+    sockaddr_storage ss;
+    slen = sizeof(ss);
+
+    if (getsockname__(rns2Socket, (struct sockaddr *)&ss, &slen) == SOCKET_ERROR)
+    {
+#if defined(_WIN32)
+        fprintf_s(stderr, "JISBerkley::GetSystemAddressViaJISSocketIPV4And6()::getsockname__()::failed with errno code (%s)\n", strerror(WSAGetLastError()));
 #elif (defined(__GNUC__) || defined(__GCCXML__) )
         fprintf_s(stderr, "JISBerkley::GetSystemAddressViaJISSocketIPV4And6()::getsockname__()::failed with errno code (%s)\n", strerror(errno));
 #endif
@@ -767,6 +2255,679 @@ void berkley_socket_t::Print(void)
 }
 ////////////////////////////// JISBerkley implementations ////////////////////////////
 
+/////////////////////////////// JISUring implementations /////////////////////////////////
+#if GECO_ENABLE_IO_URING == 1
+static int uring_setup__(unsigned entries, io_uring_params *p)
+{
+    return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+static int uring_enter__(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags)
+{
+    return (int)syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, 0, 0);
+}
+static int uring_register__(int fd, unsigned opcode, void *arg, unsigned nrArgs)
+{
+    return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nrArgs);
+}
+
+/// one io_uring instance with its mmapped rings. recv ring also owns
+/// the provided buffer ring the multishot recvmsg picks buffers from
+struct uring_t
+{
+    int fd;
+    unsigned setupFlags;
+
+    void *ringPtr;
+    size_t ringSize;
+    unsigned *sqHead;
+    unsigned *sqTail;
+    unsigned *sqMask;
+    unsigned *sqFlags;
+    unsigned *sqArray;
+    unsigned sqEntries;
+    unsigned sqLocalTail;
+    io_uring_sqe *sqes;
+    size_t sqesSize;
+    unsigned *cqHead;
+    unsigned *cqTail;
+    unsigned *cqMask;
+    io_uring_cqe *cqes;
+
+    io_uring_buf_ring *bufRing;
+    size_t bufRingSize;
+    char *bufs;
+    /// GECO_IO_URING_BUFFER_HEADROOM + max mtu of the socket
+    unsigned int bufSize;
+    unsigned short bufTail;
+    msghdr recvMsg;
+    bool isRecvArmed;
+};
+
+/// one egress batch handed to send ring. payloads are written by QueueSend() straight
+/// into @data, so everything the sqes point at has to stay here until completions come
+struct uring_send_bank_t
+{
+    /// room for GECO_SEND_BATCH_SIZE datagrams of maxMTUSize bytes
+    char *data;
+    /// sqes submitted from this bank whose cqes are not reaped yet
+    unsigned inFlight;
+    msghdr msgs[GECO_SEND_BATCH_SIZE];
+    iovec iovs[GECO_SEND_BATCH_SIZE];
+    sockaddr_storage names[GECO_SEND_BATCH_SIZE];
+#if GECO_SEND_CMSG_SUPPORTED
+    char controls[GECO_SEND_BATCH_SIZE][GECO_SEND_CMSG_SPACE];
+#endif
+};
+
+/// io_uring_recvmsg_out, sender address, cmsgs and payload share one provided buffer,
+/// this is all of it but the payload
+#define GECO_IO_URING_BUFFER_HEADROOM (sizeof(io_uring_recvmsg_out) + sizeof(sockaddr_storage) + \
+    GECO_RECV_CMSG_SPACE)
+
+static void uring_close(uring_t *r)
+{
+    if (r->bufRing != 0)
+    {
+        io_uring_buf_reg reg;
+        memset(&reg, 0, sizeof(reg));
+        uring_register__(r->fd, IORING_UNREGISTER_PBUF_RING, &reg, 1);
+        munmap(r->bufRing, r->bufRingSize);
+        r->bufRing = 0;
+    }
+    if (r->bufs != 0)
+    {
+        munmap(r->bufs, GECO_IO_URING_BUFFERS * r->bufSize);
+        r->bufs = 0;
+    }
+    if (r->sqes != 0)
+    {
+        munmap(r->sqes, r->sqesSize);
+        r->sqes = 0;
+    }
+    if (r->ringPtr != 0)
+    {
+        munmap(r->ringPtr, r->ringSize);
+        r->ringPtr = 0;
+    }
+    if (r->fd >= 0)
+    {
+        close(r->fd);
+        r->fd = -1;
+    }
+}
+static bool uring_init(uring_t *r, unsigned entries, unsigned cqEntries, unsigned flags)
+{
+    memset(r, 0, sizeof(uring_t));
+    r->fd = -1;
+
+    io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    p.flags = flags;
+    if (cqEntries > 0)
+    {
+        p.flags |= IORING_SETUP_CQSIZE;
+        p.cq_entries = cqEntries;
+    }
+    if (flags & IORING_SETUP_SQPOLL) p.sq_thread_idle = 1000;
+
+    r->fd = uring_setup__(entries, &p);
+    if (r->fd < 0) return false;
+    r->setupFlags = p.flags;
+
+    /// sq and cq rings in one mmap, kernel 5.4+
+    if ((p.features & IORING_FEAT_SINGLE_MMAP) == 0)
+    {
+        uring_close(r);
+        errno = ENOSYS;
+        return false;
+    }
+
+    size_t sqSize = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    size_t cqSize = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+    r->ringSize = sqSize > cqSize ? sqSize : cqSize;
+    r->ringPtr = mmap(0, r->ringSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+        r->fd, IORING_OFF_SQ_RING);
+    if (r->ringPtr == MAP_FAILED)
+    {
+        r->ringPtr = 0;
+        uring_close(r);
+        return false;
+    }
+    r->sqesSize = p.sq_entries * sizeof(io_uring_sqe);
+    r->sqes = (io_uring_sqe*)mmap(0, r->sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+        r->fd, IORING_OFF_SQES);
+    if (r->sqes == MAP_FAILED)
+    {
+        r->sqes = 0;
+        uring_close(r);
+        return false;
+    }
+
+    char *ring = (char*)r->ringPtr;
+    r->sqHead = (unsigned*)(ring + p.sq_off.head);
+    r->sqTail = (unsigned*)(ring + p.sq_off.tail);
+    r->sqMask = (unsigned*)(ring + p.sq_off.ring_mask);
+    r->sqFlags = (unsigned*)(ring + p.sq_off.flags);
+    r->sqArray = (unsigned*)(ring + p.sq_off.array);
+    r->sqEntries = p.sq_entries;
+    r->sqLocalTail = *r->sqTail;
+    r->cqHead = (unsigned*)(ring + p.cq_off.head);
+    r->cqTail = (unsigned*)(ring + p.cq_off.tail);
+    r->cqMask = (unsigned*)(ring + p.cq_off.ring_mask);
+    r->cqes = (io_uring_cqe*)(ring + p.cq_off.cqes);
+
+    /// sqe slot i always sits at sq array slot i
+    for (unsigned i = 0; i < r->sqEntries; i++)
+        r->sqArray[i] = i;
+    return true;
+}
+static io_uring_sqe* uring_get_sqe(uring_t *r)
+{
+    unsigned head = __atomic_load_n(r->sqHead, __ATOMIC_ACQUIRE);
+    if (r->sqLocalTail - head >= r->sqEntries) return 0;
+    io_uring_sqe *sqe = &r->sqes[r->sqLocalTail & *r->sqMask];
+    r->sqLocalTail++;
+    memset(sqe, 0, sizeof(io_uring_sqe));
+    return sqe;
+}
+/// publish prepared sqes and optionally wait for @waitNr completions.
+/// with SQPOLL nothing is entered unless kernel thread sleeps or we have to wait
+static int uring_submit(uring_t *r, unsigned waitNr)
+{
+    unsigned toSubmit = r->sqLocalTail - *r->sqTail;
+    __atomic_store_n(r->sqTail, r->sqLocalTail, __ATOMIC_RELEASE);
+
+    unsigned flags = 0;
+    if (r->setupFlags & IORING_SETUP_SQPOLL)
+    {
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        if (__atomic_load_n(r->sqFlags, __ATOMIC_RELAXED) & IORING_SQ_NEED_WAKEUP)
+            flags |= IORING_ENTER_SQ_WAKEUP;
+        else if (waitNr == 0)
+            return toSubmit;
+    }
+    if (waitNr > 0) flags |= IORING_ENTER_GETEVENTS;
+    if (toSubmit == 0 && flags == 0) return 0;
+
+    int ret;
+    do
+    {
+        ret = uring_enter__(r->fd, toSubmit, waitNr, flags);
+    } while (ret < 0 && errno == EINTR);
+    return ret;
+}
+static inline io_uring_cqe* uring_peek_cqe(uring_t *r)
+{
+    unsigned head = *r->cqHead;
+    if (head == __atomic_load_n(r->cqTail, __ATOMIC_ACQUIRE)) return 0;
+    return &r->cqes[head & *r->cqMask];
+}
+static inline void uring_cqe_seen(uring_t *r)
+{
+    __atomic_store_n(r->cqHead, *r->cqHead + 1, __ATOMIC_RELEASE);
+}
+static inline void uring_recycle_buffer(uring_t *r, unsigned short bid)
+{
+    /// not bufRing->bufs[], in c++ the empty struct of __DECLARE_FLEX_ARRAY
+    /// moves it 8 bytes away from where kernel reads the entries
+    io_uring_buf *buf = (io_uring_buf*)r->bufRing + (r->bufTail & (GECO_IO_URING_BUFFERS - 1));
+    buf->addr = (unsigned long long)(r->bufs + bid * r->bufSize);
+    buf->len = r->bufSize;
+    buf->bid = bid;
+    r->bufTail++;
+}
+static inline void uring_publish_buffers(uring_t *r)
+{
+    __atomic_store_n(&r->bufRing->tail, r->bufTail, __ATOMIC_RELEASE);
+}
+static bool uring_init_buffers(uring_t *r, ushort maxMTUSize)
+{
+    r->bufSize = GECO_IO_URING_BUFFER_HEADROOM + maxMTUSize;
+    r->bufRingSize = GECO_IO_URING_BUFFERS * sizeof(io_uring_buf);
+    r->bufRing = (io_uring_buf_ring*)mmap(0, r->bufRingSize, PROT_READ | PROT_WRITE,
+        MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+    if (r->bufRing == MAP_FAILED)
+    {
+        r->bufRing = 0;
+        return false;
+    }
+    r->bufs = (char*)mmap(0, GECO_IO_URING_BUFFERS * r->bufSize, PROT_READ | PROT_WRITE,
+        MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+    if (r->bufs == MAP_FAILED)
+    {
+        r->bufs = 0;
+        return false;
+    }
+
+    io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (unsigned long long)r->bufRing;
+    reg.ring_entries = GECO_IO_URING_BUFFERS;
+    reg.bgid = 0;
+    if (uring_register__(r->fd, IORING_REGISTER_PBUF_RING, &reg, 1) != 0)
+    {
+        munmap(r->bufRing, r->bufRingSize);
+        r->bufRing = 0;
+        return false;
+    }
+
+    r->bufTail = 0;
+    for (unsigned short bid = 0; bid < GECO_IO_URING_BUFFERS; bid++)
+        uring_recycle_buffer(r, bid);
+    uring_publish_buffers(r);
+
+    /// kernel only reads namelen and controllen of this template
+    memset(&r->recvMsg, 0, sizeof(r->recvMsg));
+    r->recvMsg.msg_namelen = sizeof(sockaddr_storage);
+    return true;
+}
+static bool uring_arm_recv(uring_t *r, int sock)
+{
+    io_uring_sqe *sqe = uring_get_sqe(r);
+    if (sqe == 0) return false;
+    sqe->opcode = IORING_OP_RECVMSG;
+    sqe->fd = sock;
+    sqe->addr = (unsigned long long)&r->recvMsg;
+    sqe->len = 1;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = 0;
+    if (uring_submit(r, 0) < 0) return false;
+    r->isRecvArmed = true;
+    return true;
+}
+static void uring_free(uring_t *&r)
+{
+    if (r == 0) return;
+    uring_close(r);
+    geco::ultils::OP_DELETE(r, TRACKE_MALLOC);
+    r = 0;
+}
+
+uring_socket_t::uring_socket_t() : recvRing(0), sendRing(0), sendBanks(0), sendBank(0),
+    ownSendsData(0), sendErrors(0), datagramsTooBig(0)
+{
+}
+uring_socket_t::~uring_socket_t()
+{
+    /// rings go first, closing them cancels the multishot recv still on rns2Socket
+    CloseRings();
+}
+bool uring_socket_t::IsSupported(void)
+{
+    /// 0 not probed yet, 1 supported, 2 not supported
+    static int supported = 0;
+    if (supported == 0)
+    {
+        supported = 2;
+
+        /// provided buffer rings came with 5.19 but multishot recvmsg only with 6.0,
+        /// there is no cheaper way to tell the latter than the kernel version
+        utsname un;
+        int major = 0, minor = 0;
+        if (uname(&un) == 0 && sscanf(un.release, "%d.%d", &major, &minor) == 2 && major >= 6)
+        {
+            uring_t r;
+            if (uring_init(&r, 2, 0, 0))
+            {
+                if (uring_init_buffers(&r, MAXIMUM_MTU_SIZE)) supported = 1;
+                uring_close(&r);
+            }
+        }
+    }
+    return supported == 1;
+}
+bool uring_socket_t::SetupRings(void)
+{
+    CloseRings();
+
+    /// multishot recv posts one cqe per datagram and stops at ENOBUFS,
+    /// so twice the buffer count of cqes can never overflow
+    recvRing = geco::ultils::OP_NEW<uring_t>(TRACKE_MALLOC);
+    if (!uring_init(recvRing, 4, GECO_IO_URING_BUFFERS * 2, 0) || !uring_init_buffers(recvRing, maxMTUSize))
+    {
+        fprintf(stderr, "JISUring::SetupRings()::recv ring::failed with errno code (%d-%s)\n", errno, strerror(errno));
+        CloseRings();
+        return false;
+    }
+
+    unsigned flags = 0;
+#if GECO_IO_URING_SQPOLL == 1
+    flags |= IORING_SETUP_SQPOLL;
+#endif
+    /// every bank can be in flight at once, cq must hold all their completions
+    sendRing = geco::ultils::OP_NEW<uring_t>(TRACKE_MALLOC);
+    if (!uring_init(sendRing, GECO_SEND_BATCH_SIZE, GECO_IO_URING_SEND_BANKS * GECO_SEND_BATCH_SIZE, flags))
+    {
+        fprintf(stderr, "JISUring::SetupRings()::send ring::failed with errno code (%d-%s)\n", errno, strerror(errno));
+        CloseRings();
+        return false;
+    }
+
+    /// bank 0 takes over queuedSendsData, the own one comes back at CloseSendRing()
+    assert(queuedSendsSize == 0);
+    sendBanks = geco::ultils::OP_NEW_ARRAY<uring_send_bank_t>(GECO_IO_URING_SEND_BANKS, TRACKE_MALLOC);
+    for (int i = 0; i < GECO_IO_URING_SEND_BANKS; i++)
+    {
+        sendBanks[i].data = geco::ultils::OP_NEW_ARRAY<char>(GECO_SEND_BATCH_SIZE * maxMTUSize, TRACKE_MALLOC);
+        sendBanks[i].inFlight = 0;
+    }
+    sendBank = 0;
+    ownSendsData = queuedSendsData;
+    queuedSendsData = sendBanks[0].data;
+    return true;
+}
+void uring_socket_t::CloseRings(void)
+{
+    uring_free(recvRing);
+    CloseSendRing(true);
+}
+void uring_socket_t::CloseSendRing(bool waitInFlight)
+{
+    if (sendRing != 0 && waitInFlight)
+    {
+        /// kernel may still read payloads of the banks, let it finish before they go
+        for (int i = 0; i < GECO_IO_URING_SEND_BANKS && sendBanks != 0; i++)
+        {
+            while (sendBanks[i].inFlight > 0)
+            {
+                if (ReapSendCompletions() == 0 && uring_submit(sendRing, 1) < 0) break;
+            }
+        }
+    }
+    uring_free(sendRing);
+
+    if (sendBanks != 0)
+    {
+        /// whatever is queued now moves back to the own buffer, QueueSend() may
+        /// never have allocated it
+        if (ownSendsData == 0 && queuedSendsSize > 0)
+            ownSendsData = geco::ultils::OP_NEW_ARRAY<char>(GECO_SEND_BATCH_SIZE * maxMTUSize, TRACKE_MALLOC);
+        if (queuedSendsBytes > 0) memcpy(ownSendsData, queuedSendsData, queuedSendsBytes);
+        for (int i = 0; i < queuedSendsSize; i++)
+            queuedSends[i].data = ownSendsData + (queuedSends[i].data - queuedSendsData);
+        queuedSendsData = ownSendsData;
+        ownSendsData = 0;
+        for (int i = 0; i < GECO_IO_URING_SEND_BANKS; i++)
+            geco::ultils::OP_DELETE_ARRAY(sendBanks[i].data, TRACKE_MALLOC);
+        geco::ultils::OP_DELETE_ARRAY(sendBanks, TRACKE_MALLOC);
+        sendBanks = 0;
+    }
+}
+int uring_socket_t::ReapSendCompletions(void)
+{
+    if (sendRing == 0) return 0;
+
+    int reaped = 0;
+    io_uring_cqe *cqe;
+    while ((cqe = uring_peek_cqe(sendRing)) != 0)
+    {
+        uring_send_bank_t& bank = sendBanks[cqe->user_data >> 16];
+        /// datagrams are gone by now, a failed one is lost like on a congested wire
+        /// and reliability layer resends it, only report what is not just a full buffer
+        if (cqe->res < 0 && cqe->res != -EAGAIN && cqe->res != -EINTR && cqe->res != -ENOBUFS)
+        {
+            sendErrors++;
+            fprintf(stderr, "JISUring::ReapSendCompletions()::sendmsg cqe::failed with errno code (%d-%s)\n",
+                -cqe->res, strerror(-cqe->res));
+        }
+        assert(bank.inFlight > 0);
+        bank.inFlight--;
+        uring_cqe_seen(sendRing);
+        reaped++;
+    }
+    return reaped;
+}
+socket_fd_t uring_socket_t::GetPollFd(void) const
+{
+    /// ring fd turns readable as soon as its cq has something
+    return recvRing != 0 ? recvRing->fd : rns2Socket;
+}
+bool uring_socket_t::EnableGRO(void)
+{
+    if (recvRing != 0) return false;
+    return berkley_socket_t::EnableGRO();
+}
+int uring_socket_t::RecvFromBatch(recv_params_t **recvFromStructs, int count)
+{
+    assert(recvFromStructs != 0);
+    assert(count > 0 && count <= GECO_RECV_BATCH_SIZE);
+
+    if (recvRing == 0 || jst != 0)
+        return berkley_socket_t::RecvFromBatch(recvFromStructs, count);
+
+    uring_t *r = recvRing;
+    /// kernel reserves this much room for cmsgs in front of every payload
+    r->recvMsg.msg_controllen = (isRecvTimestampEnabled ? GECO_TIMESTAMP_CMSG_SPACE : 0) +
+        (isPktInfoEnabled ? GECO_PKTINFO_CMSG_SPACE : 0) + (isRxqOvflEnabled ? GECO_RXQ_OVFL_CMSG_SPACE : 0) +
+        (isEcnEnabled ? GECO_ECN_CMSG_SPACE : 0);
+    if (!r->isRecvArmed && !uring_arm_recv(r, rns2Socket))
+    {
+        fprintf(stderr, "JISUring::RecvFromBatch()::uring_arm_recv()::failed with errno code (%d-%s)\n", errno, strerror(errno));
+        return -1;
+    }
+
+    int filled = 0;
+    TimeUS timeRead = 0;
+    TimeUS realTimeRead = 0;
+    while (filled < count)
+    {
+        io_uring_cqe *cqe = uring_peek_cqe(r);
+        if (cqe == 0)
+        {
+            if (filled > 0) break;
+            if (binding.isNonBlocking)
+            {
+                errno = EAGAIN;
+                return -1;
+            }
+            /// blocking socket, sleep in kernel until next datagram comes in
+            if (uring_submit(r, 1) < 0)
+            {
+                fprintf(stderr, "JISUring::RecvFromBatch()::uring_submit()::failed with errno code (%d-%s)\n", errno, strerror(errno));
+                return -1;
+            }
+            continue;
+        }
+
+        int res = cqe->res;
+        unsigned cqeFlags = cqe->flags;
+        uring_cqe_seen(r);
+
+        if (cqeFlags & IORING_CQE_F_BUFFER)
+        {
+            unsigned short bid = (unsigned short)(cqeFlags >> IORING_CQE_BUFFER_SHIFT);
+            char *buf = r->bufs + bid * r->bufSize;
+            io_uring_recvmsg_out *out = (io_uring_recvmsg_out*)buf;
+            char *name = buf + sizeof(io_uring_recvmsg_out);
+            char *payload = name + r->recvMsg.msg_namelen + r->recvMsg.msg_controllen;
+
+            /// see RecvFromIPV4(), we never accept empty or truncated datagram
+            if (res >= 0 && out->payloadlen > 0 && (out->flags & MSG_TRUNC) == 0)
+            {
+                recv_params_t *recvFromStruct = recvFromStructs[filled++];
+                memcpy(recvFromStruct->data, payload, out->payloadlen);
+                recvFromStruct->bytesRead = out->payloadlen;
+                if (timeRead == 0)
+                {
+                    timeRead = Get64BitsTimeUS();
+#if GECO_RECV_TIMESTAMP_SUPPORTED == 1
+                    realTimeRead = GetRealTimeUS();
+#endif
+                }
+                recvFromStruct->timeRead = timeRead;
+#if GECO_RECV_CMSG_SUPPORTED
+                if (out->controllen > 0)
+                {
+                    msghdr control;
+                    memset(&control, 0, sizeof(msghdr));
+                    control.msg_control = name + r->recvMsg.msg_namelen;
+                    control.msg_controllen = out->controllen;
+#if GECO_RECV_TIMESTAMP_SUPPORTED == 1
+                    if (isRecvTimestampEnabled)
+                        recvFromStruct->timeRead = GetKernelTimeRead(&control, timeRead, realTimeRead);
+#endif
+#if GECO_PKTINFO_SUPPORTED == 1
+                    if (isPktInfoEnabled)
+                        GetPktInfoAddress(&control, boundAddress, recvFromStruct->receiverINetAddress);
+#endif
+#if GECO_RXQ_OVFL_SUPPORTED == 1
+                    if (isRxqOvflEnabled)
+                        GetRxqOvflCounter(&control, kernelDropped);
+#endif
+#if GECO_ECN_SUPPORTED == 1
+                    if (isEcnEnabled)
+                        recvFromStruct->ecn = GetEcnCodepoint(&control);
+#endif
+                }
+#endif
+                unsigned int namelen = out->namelen < r->recvMsg.msg_namelen ?
+                    out->namelen : r->recvMsg.msg_namelen;
+#if NET_SUPPORT_IPV6 ==1
+                memcpy(&recvFromStruct->senderINetAddress.address.sa_stor, name, namelen);
+#ifdef _DEBUG
+                if (recvFromStruct->senderINetAddress.address.sa_stor.ss_family == AF_INET6)
+                    recvFromStruct->senderINetAddress.debugPort = ntohs(recvFromStruct->senderINetAddress.address.addr6.sin6_port);
+                else
+                    recvFromStruct->senderINetAddress.debugPort = ntohs(((sockaddr_in*)&recvFromStruct->senderINetAddress.address.sa_stor)->sin_port);
+#endif
+#else
+                memcpy(&recvFromStruct->senderINetAddress.address.addr4, name,
+                    namelen < sizeof(sockaddr_in) ? namelen : sizeof(sockaddr_in));
+#ifdef _DEBUG
+                recvFromStruct->senderINetAddress.debugPort = ntohs(recvFromStruct->senderINetAddress.address.addr4.sin_port);
+#endif
+#endif
+            }
+            else if (res >= 0 && out->payloadlen > 0)
+            {
+                /// the remote sends a bigger datagram than our max mtu
+                datagramsTooBig++;
+            }
+            uring_recycle_buffer(r, bid);
+        }
+
+        if (cqeFlags & IORING_CQE_F_MORE) continue;
+
+        /// multishot ended, ENOBUFS just means we were too slow giving buffers back
+        r->isRecvArmed = false;
+        if (res < 0 && res != -ENOBUFS)
+        {
+            /// kernel cannot do it after all, carry on as a berkley socket. ring fd is gone
+            /// from every poller with it, GetPollFd() now hands out rns2Socket instead
+            fprintf(stderr, "JISUring::RecvFromBatch()::multishot recvmsg::failed with errno code (%d-%s)\n", -res, strerror(-res));
+            uring_free(recvRing);
+            break;
+        }
+        uring_publish_buffers(r);
+        if (!uring_arm_recv(r, rns2Socket))
+        {
+            fprintf(stderr, "JISUring::RecvFromBatch()::uring_arm_recv()::failed with errno code (%d-%s)\n", errno, strerror(errno));
+            break;
+        }
+    }
+    if (recvRing != 0) uring_publish_buffers(r);
+    return filled;
+}
+int uring_socket_t::FlushQueuedSends(const char *file, unsigned int line)
+{
+    if (sendRing == 0 || jst != 0 || queuedSendsSize == 0)
+        return berkley_socket_t::FlushQueuedSends(file, line);
+
+    /// completions of earlier flushes, never waited for
+    ReapSendCompletions();
+
+    /// the bank after this one has to be free to take the next batch, otherwise
+    /// kernel is behind and this batch goes out the plain way from where it is
+    unsigned nextBank = (sendBank + 1) % GECO_IO_URING_SEND_BANKS;
+    if (sendBanks[nextBank].inFlight > 0)
+        return berkley_socket_t::FlushQueuedSends(file, line);
+
+    uring_t *r = sendRing;
+    uring_send_bank_t& bank = sendBanks[sendBank];
+    int submitted = 0;
+    for (int i = 0; i < queuedSendsSize; i++)
+    {
+        send_params_t& queued = queuedSends[i];
+        /// datagrams with ttl need setsockopt() around them, berkley path sends
+        /// that one and all behind it so they keep their order
+        if (queued.ttl > 0) break;
+
+        io_uring_sqe *sqe = uring_get_sqe(r);
+        if (sqe == 0) break;
+
+        /// queued.data already points into bank.data, only the headers are copied
+        bank.iovs[i].iov_base = queued.data;
+        bank.iovs[i].iov_len = queued.length;
+        msghdr& msg = bank.msgs[i];
+        memset(&msg, 0, sizeof(msghdr));
+        msg.msg_iov = &bank.iovs[i];
+        msg.msg_iovlen = 1;
+#if NET_SUPPORT_IPV6 ==1
+        msg.msg_namelen = queued.receiverINetAddress.address.sa_stor.ss_family == AF_INET6 ?
+            sizeof(sockaddr_in6) : sizeof(sockaddr_in);
+#else
+        msg.msg_namelen = sizeof(sockaddr_in);
+#endif
+        memcpy(&bank.names[i], &queued.receiverINetAddress.address, msg.msg_namelen);
+        msg.msg_name = &bank.names[i];
+#if GECO_SEND_CMSG_SUPPORTED
+        if (isPktInfoEnabled || isTxTimeEnabled)
+        {
+            msg.msg_controllen = PutSendControls(bank.controls[i], queued, isPktInfoEnabled, isTxTimeEnabled);
+            if (msg.msg_controllen > 0) msg.msg_control = bank.controls[i];
+        }
+#endif
+        sqe->opcode = IORING_OP_SENDMSG;
+        sqe->fd = rns2Socket;
+        sqe->addr = (unsigned long long)&msg;
+        sqe->len = 1;
+        sqe->user_data = ((unsigned long long)sendBank << 16) | (unsigned)i;
+        /// results come later, the sqe is as good as sent from the caller's view
+        queued.bytesWritten = queued.length;
+        submitted++;
+    }
+
+    int sent = 0;
+    if (submitted > 0)
+    {
+        if (uring_submit(r, 0) < 0)
+        {
+            /// can not tell which sqes kernel still holds, drop the ring and let
+            /// berkley path send those this flush has not handed over for sure
+            fprintf(stderr, "JISUring::FlushQueuedSends()::uring_submit()::failed with errno code (%d-%s)\n", errno, strerror(errno));
+            for (int i = 0; i < queuedSendsSize; i++)
+                queuedSends[i].bytesWritten = 0;
+            CloseSendRing(false);
+            return berkley_socket_t::FlushQueuedSends(file, line);
+        }
+        bank.inFlight += submitted;
+        sent = submitted;
+    }
+
+    /// from the first ttl one or the first without an sqe on, still sent from this bank before it moves on
+    sent += berkley_socket_t::FlushQueuedSends(file, line);
+    if (submitted > 0)
+    {
+        sendBank = nextBank;
+        queuedSendsData = sendBanks[sendBank].data;
+    }
+    return sent;
+}
+void uring_socket_t::Print(void)
+{
+    berkley_socket_t::Print();
+    unsigned inFlight = 0;
+    for (int i = 0; i < GECO_IO_URING_SEND_BANKS && sendBanks != 0; i++)
+        inFlight += sendBanks[i].inFlight;
+    printf("JISUring::virtual print():: recv ring fd %i recv armed %i, send ring fd %i sqpoll %i sends in flight %u send errors %u datagrams too big %u\n",
+        recvRing != 0 ? recvRing->fd : -1, recvRing != 0 && recvRing->isRecvArmed,
+        sendRing != 0 ? sendRing->fd : -1, sendRing != 0 && (sendRing->setupFlags & IORING_SETUP_SQPOLL) != 0,
+        inFlight, sendErrors, datagramsTooBig);
+}
+#endif
+////////////////////////////// JISUring implementations ////////////////////////////
+
 #endif
 
 GECO_NET_END_NSPACE
@@ -1,31 +1,210 @@
 #include "transport_layer_t.h"
 #include "geco_application.h"
+#include "geco-bit-stream.h"
+#include "geco-sliding-windows.h"
 #include <iostream>
 
 using namespace geco::net;
 
+static_assert(SEND_PRIORITIES_SIZE == PRIORITIES_COUNT, "one send buffer per priority");
+static_assert((GECO_DATAGRAM_HISTORY_SIZE & (GECO_DATAGRAM_HISTORY_SIZE - 1)) == 0, "power of 2");
+static_assert((GECO_RELIABLE_WINDOW_SIZE & (GECO_RELIABLE_WINDOW_SIZE - 1)) == 0
+    && GECO_RELIABLE_WINDOW_SIZE >= 32, "power of 2 and multiple of 32");
+
+/// datagram numbers and reliable message indexes are 24 bits
+const uint INDEX_MASK = 0xFFFFFF;
+const uint INDEX_HALF = 0x800000;
+/// isValid, isAck and isNak bits, then datagram number
+const uint DATA_DATAGRAM_HEADER_BITS = 3 + 24;
+/// WriteMini() of a uint takes at most this many bits
+const uint MINI_UINT_MAX_BITS = 1 + 32;
+/// ack ranges kept for repeating, the oldest give way beyond it
+const uint ACK_REPEAT_RANGES_MAX = 64;
+
+/// reliability goes out in 3 bits, RELIABLE_SEQUENCED_WITH_ACK_RECEIPT is never sent
+static inline bool IsReliable(uchar reliability)
+{
+    return reliability == RELIABLE_NOT_ACK_RECEIPT_OF_PACKET
+        || reliability == RELIABLE_ORDERED_NOT_ACK_RECEIPT_OF_PACKET
+        || reliability == RELIABLE_SEQUENCED_NOT_ACK_RECEIPT_OF_PACKET
+        || reliability == RELIABLE_ACK_RECEIPT_OF_PACKET
+        || reliability == RELIABLE_ORDERED_ACK_RECEIPT_OF_PACKET;
+}
+static inline bool IsSequenced(uchar reliability)
+{
+    return reliability == UNRELIABLE_SEQUENCED_NOT_ACK_RECEIPT_OF_PACKET
+        || reliability == RELIABLE_SEQUENCED_NOT_ACK_RECEIPT_OF_PACKET;
+}
+static inline bool IsOrdered(uchar reliability)
+{
+    return reliability == RELIABLE_ORDERED_NOT_ACK_RECEIPT_OF_PACKET
+        || reliability == RELIABLE_ORDERED_ACK_RECEIPT_OF_PACKET;
+}
+/// @a was sent before @b on their channel, @base is the ordering index it expects next
+static inline bool IsOrderingBefore(const packet_fixed_t& a, const packet_fixed_t& b, uint base)
+{
+    uint aheadA = (a.orderingIndex.val - base) & INDEX_MASK;
+    uint aheadB = (b.orderingIndex.val - base) & INDEX_MASK;
+    if (aheadA != aheadB) return aheadA < aheadB;
+    /// sequenced messages share the ordering index of the ordered one sent after them
+    if (IsSequenced(a.reliability) != IsSequenced(b.reliability)) return IsSequenced(a.reliability);
+    return IsSequenced(a.reliability) &&
+        ((b.sequencingIndex.val - a.sequencingIndex.val) & INDEX_MASK) - 1 < INDEX_HALF - 1;
+}
+
 transport_layer_t::transport_layer_t()
 {
+    ecnCEReceived = ecnCEEchoed = ecnCongestionEvents = 0;
+    malformedDropped = 0;
+#if USE_SLIDING_WINDOW_CONGESTION_CONTROL == 1
+    congestionController = geco::ultils::OP_NEW<JackieSlidingWindows>(TRACKE_MALLOC);
+#else
+    congestionController = 0;
+#endif
+    congestionWindow = 0;
+    smoothedRtt = nextTxTime = 0;
+    ResetRto();
+    SetPathMtuBase(MAXIMUM_MTU_SIZE);
+    sendBufferBits = 0;
+    sendBufferTime = 0;
+    sendBufferFlush = false;
+    sendBufferBlocked = false;
+    sendCapacityBits = BYTES_TO_BITS(MAXIMUM_MTU_SIZE - UDP_HEADER_SIZE);
+    reliableWriteIndex = 0;
+    memset(orderedWriteIndex, 0, sizeof(orderedWriteIndex));
+    memset(sequencedWriteIndex, 0, sizeof(sequencedWriteIndex));
+    for (uint i = 0; i < GECO_DATAGRAM_HISTORY_SIZE; i++)
+    {
+        sentDatagrams[i].inUse = false;
+        sentDatagrams[i].reliables = 0;
+    }
+    ResetAcks();
+    ResetOrdering();
 }
 
 transport_layer_t::~transport_layer_t()
 {
+    ClearSendBuffer();
+    ResetAcks();
+    ResetOrdering();
+    geco::ultils::OP_DELETE(congestionController, TRACKE_MALLOC);
 }
 
 void transport_layer_t::ApplyNetworkSimulator(double _packetloss, unsigned short _minExtraPing, unsigned short _extraPingVariance)
 {
-    std::cout << " JackieReliabler::ApplyNetworkSimulator is not implemented.";
+    /// no simulator in the connected path yet, settings are ignored
+    (void)_packetloss;
+    (void)_minExtraPing;
+    (void)_extraPingVariance;
 }
 
-bool transport_layer_t::ProcessOneConnectedRecvParams(network_application_t* serverApp, recv_params_t* recvParams, unsigned mtuSize)
+bool transport_layer_t::ProcessOneConnectedRecvParams(network_application_t* serverApp,
+    recv_params_t* recvParams, remote_system_t* remoteSystem)
 {
-    std::cout << " JackieReliabler::ProcessOneConnectedRecvParams is not implemented.";
+    if (recvParams->ecn == ECN_CE) ecnCEReceived++;
+
+    geco_bit_stream_t bitStream((uchar*)recvParams->data, recvParams->bytesRead, false);
+    bool isValid, hasAcks, hasNaks;
+    bitStream.Read(isValid);
+    bitStream.Read(hasAcks);
+    bitStream.Read(hasNaks);
+    if (!isValid) return false;
+    if (hasAcks || hasNaks)
+    {
+        if (ProcessAcksAndNaks(recvParams, hasAcks, hasNaks)) return true;
+        malformedDropped++;
+        return false;
+    }
+
+    uint24_t datagramNumber;
+    if (bitStream.get_payloads() < 24)
+    {
+        malformedDropped++;
+        return false;
+    }
+    bitStream.Read(datagramNumber);
+    OnDatagramReceived(datagramNumber.val, recvParams->timeRead);
+
+    packet_fixed_t header;
+    network_packet_t* packet;
+    /// a datagram ends with less than a byte of padding after its last message
+    while (bitStream.get_payloads() >= 8)
+    {
+        if (!ReadMessageHeader(bitStream, header))
+        {
+            malformedDropped++;
+            return false;
+        }
+        bool isDuplicate = IsReliable(header.reliability) && IsReliableDuplicate(header.packetIndex.val);
+        bool isOrdering = IsOrdered(header.reliability) || IsSequenced(header.reliability);
+
+        bitStream.align_readable_bit_pos();
+        uint bytes = BITS_TO_BYTES(header.dataBitLength);
+        if (bitStream.get_payloads() < BYTES_TO_BITS(bytes))
+        {
+            malformedDropped++;
+            return false;
+        }
+        if (isDuplicate || (isOrdering && IsOrderingStale(header)))
+        {
+            /// resent after a nak that reordering caused, first copy got through,
+            /// or sequenced behind a newer one of its channel
+            bitStream.skip_read_bytes(bytes);
+            continue;
+        }
+        if (isOrdering && IsOrderingAhead(header))
+        {
+            internal_packet_t* held = HoldOrdering(header);
+            if (held != 0) bitStream.ReadAlignedBytes(held->data, bytes);
+            else bitStream.skip_read_bytes(bytes);
+            continue;
+        }
+        packet = serverApp->AllocPacket(bytes);
+        bitStream.ReadAlignedBytes(packet->data, bytes);
+        packet->bitSize = header.dataBitLength;
+        packet->systemAddress = recvParams->senderINetAddress;
+        packet->guid = remoteSystem->guid;
+        bool ret = serverApp->allocPacketQ.PushTail(packet);
+        assert(ret == true);
+        if (!isOrdering) continue;
+
+        /// it may be the one the held ones of its channel waited for
+        OnOrderingDelivered(header);
+        internal_packet_t* msg;
+        while ((msg = PopOrderingReady(header.orderingChannel)) != 0)
+        {
+            bytes = BITS_TO_BYTES(msg->dataBitLength);
+            packet = serverApp->AllocPacket(bytes);
+            memcpy(packet->data, msg->data, bytes);
+            packet->bitSize = msg->dataBitLength;
+            packet->systemAddress = recvParams->senderINetAddress;
+            packet->guid = remoteSystem->guid;
+            ret = serverApp->allocPacketQ.PushTail(packet);
+            assert(ret == true);
+            FreeInternalPacket(msg);
+        }
+    }
     return true;
 }
 
 void transport_layer_t::Reset(bool param1, int MTUSize, bool client_has_security)
 {
-    std::cout << " JackieReliabler::Reset is not implemented.";
+    (void)param1;
+    (void)client_has_security;
+    ecnCEReceived = ecnCEEchoed = ecnCongestionEvents = 0;
+    malformedDropped = 0;
+    congestionWindow = 0;
+    smoothedRtt = nextTxTime = 0;
+    ResetRto();
+    ClearSendBuffer();
+    reliableWriteIndex = 0;
+    memset(orderedWriteIndex, 0, sizeof(orderedWriteIndex));
+    memset(sequencedWriteIndex, 0, sizeof(sequencedWriteIndex));
+    ResetAcks();
+    ResetOrdering();
+    SetPathMtuBase((ushort)MTUSize);
+    sendCapacityBits = BYTES_TO_BITS(MTUSize - UDP_HEADER_SIZE);
+    if (congestionController != 0) congestionController->Reset(MTUSize);
 }
 
 void transport_layer_t::SetSplitMessageProgressInterval(int splitMessageProgressInterval)
@@ -43,12 +222,789 @@ void transport_layer_t::SetTimeoutTime(TimeMS defaultTimeoutTime)
     std::cout << " JackieReliabler::SetTimeoutTime is not implemented.";
 }
 
+bool transport_layer_t::OnEcnCEEchoed(uint ceEchoed)
+{
+    /// echoes are totals, a lost or reordered ack never counts a mark twice
+    if ((int)(ceEchoed - ecnCEEchoed) <= 0) return false;
+    ecnCEEchoed = ceEchoed;
+    ecnCongestionEvents++;
+    return true;
+}
+
+void transport_layer_t::SetCongestionController(congestion_controller_t* controller, ushort mtu)
+{
+    if (controller == congestionController) return;
+    geco::ultils::OP_DELETE(congestionController, TRACKE_MALLOC);
+    congestionController = controller;
+    if (congestionController != 0) congestionController->Reset(mtu);
+    UpdatePacingState();
+}
+
+void transport_layer_t::UpdatePacingState(void)
+{
+    if (congestionController == 0) SetPacingState(0, 0);
+    else SetPacingState(congestionController->GetCongestionWindow(), congestionController->GetSmoothedRtt());
+}
+
+void transport_layer_t::SetPacingState(uint cwnd, TimeUS srtt)
+{
+    congestionWindow = cwnd;
+    smoothedRtt = srtt;
+}
+
+TimeUS transport_layer_t::GetPacedTxTime(int bytes, TimeUS timeUS)
+{
+    if (congestionWindow == 0 || smoothedRtt == 0) return 0;
+
+    /// idle time earns no credit, a burst after it is spread like any other
+    if (nextTxTime < timeUS) nextTxTime = timeUS;
+    if (nextTxTime > timeUS + GECO_TXTIME_HORIZON_US) nextTxTime = timeUS + GECO_TXTIME_HORIZON_US;
+
+    TimeUS txTime = nextTxTime;
+    nextTxTime += bytes * smoothedRtt * 100 / ((TimeUS)congestionWindow * GECO_TXTIME_PACING_GAIN_PERCENT);
+    return txTime == timeUS ? 0 : txTime;
+}
+
+uint transport_layer_t::GetMessageHeaderBits(const packet_fixed_t* header)
+{
+    /// reliability, hasSplitPacket and dataBitLength
+    uint bits = 3 + 1 + 16;
+    if (IsReliable(header->reliability)) bits += 24;
+    if (IsSequenced(header->reliability)) bits += 24;
+    if (IsOrdered(header->reliability) || IsSequenced(header->reliability)) bits += 24 + 5;
+    return bits;
+}
+
+uint transport_layer_t::GetMessageMaxBits(const internal_packet_t* msg)
+{
+    return msg->headerLength + 7 + BYTES_TO_BITS(BITS_TO_BYTES(msg->dataBitLength));
+}
+
+void transport_layer_t::WriteMessageHeader(geco_bit_stream_t& bitStream, const packet_fixed_t& header)
+{
+    uchar reliability = (uchar)header.reliability;
+    bitStream.WriteBits(&reliability, 3, true);
+    bitStream.Write(false); /// hasSplitPacket
+    bitStream.Write((ushort)header.dataBitLength);
+    if (IsReliable(header.reliability)) bitStream.Write(header.packetIndex);
+    if (IsSequenced(header.reliability)) bitStream.Write(header.sequencingIndex);
+    if (IsOrdered(header.reliability) || IsSequenced(header.reliability))
+    {
+        bitStream.Write(header.orderingIndex);
+        bitStream.WriteBits(&header.orderingChannel, 5, true);
+    }
+}
+
+bool transport_layer_t::ReadMessageHeader(geco_bit_stream_t& bitStream, packet_fixed_t& header)
+{
+    if (bitStream.get_payloads() < 3 + 1 + 16) return false;
+    uchar reliability = 0;
+    bool hasSplitPacket;
+    ushort dataBitLength;
+    bitStream.ReadBits(&reliability, 3, true);
+    bitStream.Read(hasSplitPacket);
+    bitStream.Read(dataBitLength);
+    /// split messages are never sent yet, the rest cannot be trusted
+    if (reliability >= RELIABLE_SEQUENCED_WITH_ACK_RECEIPT || hasSplitPacket || dataBitLength == 0)
+        return false;
+
+    header.reliability = (packet_reliability_t)reliability;
+    header.dataBitLength = dataBitLength;
+    header.splitPacketCount = 0;
+    if (bitStream.get_payloads() < GetMessageHeaderBits(&header) - (3 + 1 + 16)) return false;
+    if (IsReliable(header.reliability)) bitStream.Read(header.packetIndex);
+    if (IsSequenced(header.reliability)) bitStream.Read(header.sequencingIndex);
+    if (IsOrdered(header.reliability) || IsSequenced(header.reliability))
+    {
+        bitStream.Read(header.orderingIndex);
+        header.orderingChannel = 0;
+        bitStream.ReadBits(&header.orderingChannel, 5, true);
+    }
+    return true;
+}
+
+void transport_layer_t::FreeInternalPacket(internal_packet_t* msg)
+{
+    if (msg->allocationScheme == internal_packet_t::NORMAL)
+        gFreeEx(msg->data, TRACKE_MALLOC);
+    internalPacketPool.Reclaim(msg);
+}
+
+void transport_layer_t::ClearSendBuffer(void)
+{
+    internal_packet_t* msg;
+    for (uint priority = 0; priority < SEND_PRIORITIES_SIZE; priority++)
+    {
+        while (sendBuffer[priority].PopHead(msg))
+            FreeInternalPacket(msg);
+    }
+    sendBufferBits = 0;
+    sendBufferTime = 0;
+    sendBufferFlush = false;
+    sendBufferBlocked = false;
+}
+
 bool transport_layer_t::Send(reliable_send_params_t& sendParams)
 {
-    //remoteSystemList[sendList[sendListIndex]].reliabilityLayer.Send(data, numberOfBitsToSend, priority, reliability, orderingChannel, useData == false, remoteSystemList[sendList[sendListIndex]].MTUSize, currentTime, receipt);
-    std::cout <<
-        "Not implemented JackieReliabler::Send(ReliableSendParams& sendParams)";
+    /// dataBitLength goes out in 16 bits
+    if (sendParams.bitsSize == 0 || sendParams.bitsSize > 0xFFFF
+        || sendParams.packetReliability >= RELIABLE_SEQUENCED_WITH_ACK_RECEIPT
+        || sendParams.sendPriority >= PRIORITIES_COUNT
+        || (uchar)sendParams.orderingChannel >= ORDERING_CHANNELS_SIZE)
+        return false;
+
+    internal_packet_t* msg = internalPacketPool.Allocate();
+    msg->reliability = sendParams.packetReliability;
+    msg->priority = sendParams.sendPriority;
+    msg->orderingChannel = sendParams.orderingChannel;
+    msg->dataBitLength = sendParams.bitsSize;
+    msg->splitPacketCount = 0;
+    msg->creationTime = sendParams.currentTime;
+    msg->sendReceiptSerial = sendParams.receipt;
+    msg->timesTrytoSend = 0;
+    msg->headerLength = GetMessageHeaderBits(msg);
+
+    /// splitting is not there yet, the whole message has to fit behind the datagram header
+    uint maxBits = GetMessageMaxBits(msg);
+    if ((int)(DATA_DATAGRAM_HEADER_BITS + maxBits) > BYTES_TO_BITS(sendParams.mtu - UDP_HEADER_SIZE))
+    {
+        fprintf(stderr, "transport_layer_t::Send()::failed, message of %u bits does not fit one datagram of mtu %d\n",
+            (uint)sendParams.bitsSize, sendParams.mtu);
+        internalPacketPool.Reclaim(msg);
+        return false;
+    }
+
+    uint bytes = BITS_TO_BYTES(sendParams.bitsSize);
+    if (!sendParams.makeDataCopy)
+    {
+        msg->data = (uchar*)sendParams.data;
+        msg->allocationScheme = internal_packet_t::NORMAL;
+    }
+    else if (bytes <= sizeof(msg->stackData))
+    {
+        /// small messages are the common case, keep them off the heap
+        msg->data = msg->stackData;
+        msg->allocationScheme = internal_packet_t::STACK;
+        memcpy(msg->data, sendParams.data, bytes);
+    }
+    else
+    {
+        msg->data = (uchar*)gMallocEx(bytes, TRACKE_MALLOC);
+        msg->allocationScheme = internal_packet_t::NORMAL;
+        memcpy(msg->data, sendParams.data, bytes);
+    }
+
+    if (IsReliable(msg->reliability))
+    {
+        msg->packetIndex = reliableWriteIndex;
+        reliableWriteIndex = (reliableWriteIndex + 1) & INDEX_MASK;
+    }
+    if (IsSequenced(msg->reliability))
+    {
+        /// sequenced messages share the ordering index of the next ordered one
+        msg->orderingIndex = orderedWriteIndex[msg->orderingChannel];
+        msg->sequencingIndex = sequencedWriteIndex[msg->orderingChannel]++;
+    }
+    else if (IsOrdered(msg->reliability))
+    {
+        msg->orderingIndex = orderedWriteIndex[msg->orderingChannel]++;
+        sequencedWriteIndex[msg->orderingChannel] = 0;
+    }
+
+    if (sendBufferBits == 0) sendBufferTime = sendParams.currentTime != 0 ? sendParams.currentTime : Get64BitsTimeUS();
+    sendBufferBits += maxBits;
+    if (msg->priority == UNBUFFERED_IMMEDIATELY_SEND) sendBufferFlush = true;
+    if (!IsReliable(msg->reliability)) sendBufferBlocked = false;
+    bool ret = sendBuffer[msg->priority].PushTail(msg);
+    assert(ret == true);
     return true;
 }
 
+bool transport_layer_t::IsHistoryFull(void) const
+{
+    return ((datagramWriteNumber - oldestUnackedNumber) & INDEX_MASK) >= GECO_DATAGRAM_HISTORY_SIZE - 1;
+}
+
+TimeUS transport_layer_t::GetRto(void) const
+{
+    return congestionController != 0 ? congestionController->GetRto() : rto;
+}
+
+void transport_layer_t::OnRttSample(TimeUS rtt)
+{
+    if (rtt == 0) rtt = 1; /// srtt of 0 means no sample
+    if (rtoSrtt == 0)
+    {
+        rtoSrtt = rtt;
+        rtoRttVar = rtt / 2;
+    }
+    else
+    {
+        TimeUS delta = rtoSrtt > rtt ? rtoSrtt - rtt : rtt - rtoSrtt;
+        rtoRttVar = (3 * rtoRttVar + delta) / 4;
+        rtoSrtt = (7 * rtoSrtt + rtt) / 8;
+    }
+    /// a fresh sample also undoes the back off of timeouts
+    rto = rtoSrtt + 4 * rtoRttVar;
+    if (rto < GECO_CC_MIN_RTO_US) rto = GECO_CC_MIN_RTO_US;
+    if (rto > GECO_CC_MAX_RTO_US) rto = GECO_CC_MAX_RTO_US;
+}
+
+void transport_layer_t::ResetRto(void)
+{
+    rtoSrtt = rtoRttVar = 0;
+    rto = GECO_CC_INITIAL_RTO_US;
+}
+
+TimeUS transport_layer_t::GetRetransmissionTime(void) const
+{
+    const sent_datagram_t& sent = sentDatagrams[oldestUnackedNumber & (GECO_DATAGRAM_HISTORY_SIZE - 1)];
+    if (!sent.inUse || sent.number != oldestUnackedNumber) return 0;
+    return sent.sendTime + GetRto();
+}
+
+TimeUS transport_layer_t::GetNextSendTime(void) const
+{
+    TimeUS ackTime = 0;
+    if (nakRanges.Size() > 0) ackTime = ackRangesTime;
+    else if (ackRanges.Size() > 0) ackTime = ackRangesTime + GECO_ACK_DELAY_US;
+    else if (ackRepeatRanges.Size() > 0) ackTime = ackRepeatTime + GECO_ACK_REPEAT_DELAY_US;
+    TimeUS rtoTime = GetRetransmissionTime();
+    if (rtoTime != 0 && (ackTime == 0 || rtoTime < ackTime)) ackTime = rtoTime;
+    /// a full window waits for acks, which wake us up anyway, or the timeout.
+    /// same size Update() asks CanSend() for, a smaller one may fit where it does not
+    uint bits = DATA_DATAGRAM_HEADER_BITS + sendBufferBits;
+    if (sendBufferBits == 0 || sendBufferBlocked || IsHistoryFull() || (congestionController != 0
+        && !congestionController->CanSend(UDP_HEADER_SIZE +
+        BITS_TO_BYTES(bits < sendCapacityBits ? bits : sendCapacityBits))))
+        return ackTime;
+    /// a full datagram does not wait for more to aggregate either, as in Update()
+    TimeUS sendTime = sendBufferFlush || bits >= sendCapacityBits ? sendBufferTime :
+        sendBufferTime + GECO_SEND_AGGREGATION_DELAY_US;
+    return ackTime != 0 && ackTime < sendTime ? ackTime : sendTime;
+}
+
+void transport_layer_t::Update(network_application_t* serverApp, remote_system_t* remoteSystem, TimeUS timeUS)
+{
+    /// holes are nak'ed at once so the sender resends without waiting for a timeout
+    /// no more datagrams coming in means no ack to carry the repeats, the last ones
+    /// of a burst are what a sender with a full window waits on
+    if (nakRanges.Size() > 0 ||
+        (ackRanges.Size() > 0 && timeUS - ackRangesTime >= GECO_ACK_DELAY_US) ||
+        (ackRepeatRanges.Size() > 0 && timeUS - ackRepeatTime >= GECO_ACK_REPEAT_DELAY_US))
+        SendAcksAndNaks(serverApp, remoteSystem, timeUS);
+
+    /// datagrams in flight that got no ack nor nak within rto are resent. measured
+    /// against the rto before the first of them doubles it, or the rest of a full
+    /// window would each wait for a doubled rto behind a window of one mtu
+    TimeUS timeout = GetRto();
+    uint oldest = oldestUnackedNumber;
+    uint number = oldest;
+    while (number != datagramWriteNumber)
+    {
+        sent_datagram_t& sent = sentDatagrams[number & (GECO_DATAGRAM_HISTORY_SIZE - 1)];
+        if (sent.inUse && sent.number == number && timeUS - sent.sendTime < timeout) break;
+        number = (number + 1) & INDEX_MASK;
+    }
+    if (number != oldest)
+    {
+        /// once per timeout, as congestion control backs off its own
+        rto = rto * 2 < GECO_CC_MAX_RTO_US ? rto * 2 : GECO_CC_MAX_RTO_US;
+    }
+    /// newest first, every resend goes to the head of the send buffer
+    bool bigTimedOut = false;
+    while (number != oldest)
+    {
+        number = (number - 1) & INDEX_MASK;
+        sent_datagram_t& sent = sentDatagrams[number & (GECO_DATAGRAM_HISTORY_SIZE - 1)];
+        if (!sent.inUse || sent.number != number) continue;
+        if (sent.bytes > pathMtuBase) bigTimedOut = true;
+        OnDatagramLost(sent, timeUS, true);
+    }
+    if (bigTimedOut) bigTimeouts++;
+
+    if (sendBufferBits == 0) return;
+    uint capacity = BYTES_TO_BITS(remoteSystem->MTUSize - UDP_HEADER_SIZE);
+    sendCapacityBits = capacity;
+    /// hold small messages back a little so more of them share one datagram
+    if (!sendBufferFlush && DATA_DATAGRAM_HEADER_BITS + sendBufferBits < capacity
+        && timeUS - sendBufferTime < GECO_SEND_AGGREGATION_DELAY_US)
+        return;
+
+    internal_packet_t* msg;
+    send_params_t jsp;
+    while (sendBufferBits > 0)
+    {
+        /// window is full, the rest waits for acks or losses to free it
+        uint bits = DATA_DATAGRAM_HEADER_BITS + sendBufferBits;
+        if (IsHistoryFull() || (congestionController != 0 && !congestionController->CanSend(
+            UDP_HEADER_SIZE + BITS_TO_BYTES(bits < capacity ? bits : capacity))))
+            break;
+
+        sent_datagram_t& sent = sentDatagrams[datagramWriteNumber & (GECO_DATAGRAM_HISTORY_SIZE - 1)];
+        assert(!sent.inUse);
+
+        geco_bit_stream_t bitStream;
+        bitStream.Write(true); /// isValid, what tells a connected datagram from an offline one
+        bitStream.Write(false); /// hasAcks
+        bitStream.Write(false); /// hasNaks
+        bitStream.Write(uint24_t(datagramWriteNumber));
+
+        /// higher priorities first, lower ones fill up what is left
+        for (uint priority = 0; priority < SEND_PRIORITIES_SIZE; priority++)
+        {
+            JackieArraryQueue<internal_packet_t*>& queue = sendBuffer[priority];
+            while (queue.Size() > 0)
+            {
+                msg = queue.Head();
+                /// lower priorities may still hold the older indexes it waits for
+                if (IsReliable(msg->reliability) &&
+                    ((msg->packetIndex.val - reliableAckBase) & INDEX_MASK) >= GECO_RELIABLE_WINDOW_SIZE)
+                    break;
+                uint maxBits = GetMessageMaxBits(msg);
+                if (DATA_DATAGRAM_HEADER_BITS + maxBits > capacity)
+                {
+                    /// path mtu shrank since it was buffered, a black hole dropped it back.
+                    /// a reliable one must not hold the window of the ones after it
+                    fprintf(stderr, "transport_layer_t::Update()::drop message of %u bits, it no longer fits mtu %d\n",
+                        msg->dataBitLength, remoteSystem->MTUSize);
+                    if (IsReliable(msg->reliability)) OnReliableAcked(msg->packetIndex.val);
+                }
+                else if (bitStream.get_written_bits() + maxBits > capacity)
+                {
+                    break;
+                }
+                else
+                {
+                    WriteMessageHeader(bitStream, *msg);
+                    bitStream.write_aligned_bytes(msg->data, BITS_TO_BYTES(msg->dataBitLength));
+                    if (IsReliable(msg->reliability))
+                    {
+                        /// kept until the datagram is acked
+                        queue.PopHead(msg);
+                        sendBufferBits -= maxBits;
+                        msg->resendNext = sent.reliables;
+                        sent.reliables = msg;
+                        continue;
+                    }
+                }
+                queue.PopHead(msg);
+                sendBufferBits -= maxBits;
+                FreeInternalPacket(msg);
+            }
+        }
+        if (bitStream.get_written_bits() == DATA_DATAGRAM_HEADER_BITS)
+        {
+            /// what is left is too far ahead of the oldest reliable index unacked
+            sendBufferBlocked = sendBufferBits > 0;
+            break;
+        }
+
+        /// unreliable only datagrams are kept too, their acks free the window
+        sent.number = datagramWriteNumber;
+        sent.sendTime = timeUS;
+        sent.bytes = UDP_HEADER_SIZE + bitStream.get_written_bytes();
+        sent.inUse = true;
+        datagramWriteNumber = (datagramWriteNumber + 1) & INDEX_MASK;
+        if (congestionController != 0) congestionController->OnSend(sent.bytes, timeUS);
+
+        jsp.data = bitStream.char_data();
+        jsp.length = bitStream.get_written_bytes();
+        jsp.receiverINetAddress = remoteSystem->systemAddress;
+        jsp.senderINetAddress = remoteSystem->address2use;
+        serverApp->SendPaced(remoteSystem, &jsp);
+    }
+    if (sendBufferBits == 0)
+    {
+        sendBufferTime = 0;
+        sendBufferFlush = false;
+    }
+}
+
+
+
+void transport_layer_t::ResetAcks(void)
+{
+    for (uint i = 0; i < GECO_DATAGRAM_HISTORY_SIZE; i++)
+    {
+        internal_packet_t* msg = sentDatagrams[i].reliables;
+        while (msg != 0)
+        {
+            internal_packet_t* next = msg->resendNext;
+            FreeInternalPacket(msg);
+            msg = next;
+        }
+        sentDatagrams[i].reliables = 0;
+        sentDatagrams[i].inUse = false;
+    }
+    datagramWriteNumber = oldestUnackedNumber = 0;
+    reliableAckBase = 0;
+    memset(reliableAckMask, 0, sizeof(reliableAckMask));
+    ackRanges.Clear();
+    nakRanges.Clear();
+    ackRepeatRanges.Clear();
+    ackRepeatTime = 0;
+    ackRangesTime = 0;
+    datagramReadNumber = 0;
+    reliableReadBase = 0;
+    memset(reliableReadMask, 0, sizeof(reliableReadMask));
+}
+
+void transport_layer_t::AddRange(JackieArraryQueue<datagram_range_t>& ranges, uint start, uint end)
+{
+    /// in order arrivals only ever grow the last range
+    if (ranges.Size() > 0)
+    {
+        datagram_range_t& last = ranges[ranges.Size() - 1];
+        if (((last.end + 1) & INDEX_MASK) == start)
+        {
+            last.end = end;
+            return;
+        }
+    }
+    datagram_range_t range;
+    range.start = start;
+    range.end = end;
+    bool ret = ranges.PushTail(range);
+    assert(ret == true);
+}
+
+void transport_layer_t::OnDatagramReceived(uint number, TimeUS timeUS)
+{
+    if (ackRanges.Size() == 0 && nakRanges.Size() == 0) ackRangesTime = timeUS;
+    AddRange(ackRanges, number, number);
+
+    uint ahead = (number - datagramReadNumber) & INDEX_MASK;
+    /// behind is a reordered one, its number was nak'ed already
+    if (ahead >= INDEX_HALF) return;
+    if (ahead > 0) AddRange(nakRanges, datagramReadNumber, (number - 1) & INDEX_MASK);
+    datagramReadNumber = (number + 1) & INDEX_MASK;
+}
+
+bool transport_layer_t::IsReliableDuplicate(uint index)
+{
+    uint ahead = (index - reliableReadBase) & INDEX_MASK;
+    if (ahead >= INDEX_HALF) return true;
+    /// too far ahead to keep track of, let it through
+    if (ahead >= GECO_RELIABLE_WINDOW_SIZE) return false;
+
+    uint bit = index & (GECO_RELIABLE_WINDOW_SIZE - 1);
+    if (reliableReadMask[bit >> 5] & (1u << (bit & 31))) return true;
+    reliableReadMask[bit >> 5] |= 1u << (bit & 31);
+
+    /// slide the window over the run now complete
+    bit = reliableReadBase & (GECO_RELIABLE_WINDOW_SIZE - 1);
+    while (reliableReadMask[bit >> 5] & (1u << (bit & 31)))
+    {
+        reliableReadMask[bit >> 5] &= ~(1u << (bit & 31));
+        reliableReadBase = (reliableReadBase + 1) & INDEX_MASK;
+        bit = reliableReadBase & (GECO_RELIABLE_WINDOW_SIZE - 1);
+    }
+    return false;
+}
+
+bool transport_layer_t::IsOrderingStale(const packet_fixed_t& header) const
+{
+    uint ahead = (header.orderingIndex.val - orderedReadIndex[header.orderingChannel]) & INDEX_MASK;
+    if (ahead >= INDEX_HALF) return true;
+    return ahead == 0 && IsSequenced(header.reliability) &&
+        ((header.sequencingIndex.val - sequencedReadIndex[header.orderingChannel]) & INDEX_MASK) >= INDEX_HALF;
+}
+
+bool transport_layer_t::IsOrderingAhead(const packet_fixed_t& header) const
+{
+    return header.orderingIndex.val != orderedReadIndex[header.orderingChannel];
+}
+
+internal_packet_t* transport_layer_t::HoldOrdering(const packet_fixed_t& header)
+{
+    JackieArraryQueue<internal_packet_t*>& held = orderingHeld[header.orderingChannel];
+    /// reliable ones are never further ahead than the reliable window, only a burst
+    /// of unreliable sequenced ones or a misbehaving sender gets here
+    if (held.Size() >= GECO_RELIABLE_WINDOW_SIZE) return 0;
+
+    internal_packet_t* msg = internalPacketPool.Allocate();
+    packet_fixed_t& fixed = *msg;
+    fixed = header;
+    uint bytes = BITS_TO_BYTES(header.dataBitLength);
+    if (bytes <= sizeof(msg->stackData))
+    {
+        msg->data = msg->stackData;
+        msg->allocationScheme = internal_packet_t::STACK;
+    }
+    else
+    {
+        msg->data = (uchar*)gMallocEx(bytes, TRACKE_MALLOC);
+        msg->allocationScheme = internal_packet_t::NORMAL;
+    }
+
+    /// from the back, reordering seldom moves a message far
+    uint pos = held.Size();
+    while (pos > 0 && IsOrderingBefore(*msg, *held[pos - 1], orderedReadIndex[header.orderingChannel]))
+        pos--;
+    /// InsertAtIndex() reports false for a queue that was empty
+    bool ret = pos == held.Size() ? held.PushTail(msg) : held.InsertAtIndex(msg, pos);
+    assert(ret == true);
+    return msg;
+}
+
+void transport_layer_t::OnOrderingDelivered(const packet_fixed_t& header)
+{
+    uint channel = header.orderingChannel;
+    if (IsSequenced(header.reliability))
+    {
+        sequencedReadIndex[channel] = (header.sequencingIndex.val + 1) & INDEX_MASK;
+        return;
+    }
+    orderedReadIndex[channel] = (orderedReadIndex[channel] + 1) & INDEX_MASK;
+    sequencedReadIndex[channel] = 0;
+}
+
+internal_packet_t* transport_layer_t::PopOrderingReady(uint channel)
+{
+    JackieArraryQueue<internal_packet_t*>& held = orderingHeld[channel];
+    internal_packet_t* msg = 0;
+    while (held.Size() > 0 && held.Head()->orderingIndex.val == orderedReadIndex[channel])
+    {
+        held.PopHead(msg);
+        if (!IsOrderingStale(*msg))
+        {
+            OnOrderingDelivered(*msg);
+            return msg;
+        }
+        FreeInternalPacket(msg);
+    }
+    return 0;
+}
+
+void transport_layer_t::ResetOrdering(void)
+{
+    internal_packet_t* msg;
+    for (uint channel = 0; channel < ORDERING_CHANNELS_SIZE; channel++)
+    {
+        while (orderingHeld[channel].Size() > 0)
+        {
+            orderingHeld[channel].PopHead(msg);
+            FreeInternalPacket(msg);
+        }
+    }
+    memset(orderedReadIndex, 0, sizeof(orderedReadIndex));
+    memset(sequencedReadIndex, 0, sizeof(sequencedReadIndex));
+}
+
+void transport_layer_t::ResendDatagram(sent_datagram_t& sent, TimeUS timeUS)
+{
+    /// chain is newest first, inserting each at the head restores the order sent
+    internal_packet_t* msg = sent.reliables;
+    while (msg != 0)
+    {
+        internal_packet_t* next = msg->resendNext;
+        JackieArraryQueue<internal_packet_t*>& queue = sendBuffer[msg->priority];
+        /// InsertAtIndex() reports false for a queue that was empty
+        bool ret = queue.Size() == 0 ? queue.PushTail(msg) : queue.InsertAtIndex(msg, 0);
+        assert(ret == true);
+        if (sendBufferBits == 0) sendBufferTime = timeUS;
+        sendBufferBits += GetMessageMaxBits(msg);
+        sendBufferBlocked = false;
+        msg->timesTrytoSend++;
+        msg = next;
+    }
+    sent.reliables = 0;
+    sent.inUse = false;
+}
+
+void transport_layer_t::OnDatagramAcked(uint number, TimeUS timeUS)
+{
+    sent_datagram_t& sent = sentDatagrams[number & (GECO_DATAGRAM_HISTORY_SIZE - 1)];
+    if (!sent.inUse || sent.number != number) return;
+    /// resent messages go out in new datagrams, every sample is unambiguous
+    if (timeUS >= sent.sendTime) OnRttSample(timeUS - sent.sendTime);
+    if (sent.bytes > pathMtuBase) bigTimeouts = 0;
+    if (congestionController != 0)
+    {
+        congestionController->OnAck(sent.bytes, sent.sendTime, timeUS);
+        UpdatePacingState();
+    }
+    internal_packet_t* msg = sent.reliables;
+    while (msg != 0)
+    {
+        internal_packet_t* next = msg->resendNext;
+        OnReliableAcked(msg->packetIndex.val);
+        FreeInternalPacket(msg);
+        msg = next;
+    }
+    sent.reliables = 0;
+    sent.inUse = false;
+    AdvanceOldestUnacked();
+}
+
+void transport_layer_t::OnReliableAcked(uint index)
+{
+    /// a message is only ever in one datagram in flight, never acked twice
+    uint bit = index & (GECO_RELIABLE_WINDOW_SIZE - 1);
+    reliableAckMask[bit >> 5] |= 1u << (bit & 31);
+
+    bit = reliableAckBase & (GECO_RELIABLE_WINDOW_SIZE - 1);
+    while (reliableAckMask[bit >> 5] & (1u << (bit & 31)))
+    {
+        reliableAckMask[bit >> 5] &= ~(1u << (bit & 31));
+        reliableAckBase = (reliableAckBase + 1) & INDEX_MASK;
+        bit = reliableAckBase & (GECO_RELIABLE_WINDOW_SIZE - 1);
+        sendBufferBlocked = false;
+    }
+}
+
+void transport_layer_t::AdvanceOldestUnacked(void)
+{
+    while (oldestUnackedNumber != datagramWriteNumber
+        && !sentDatagrams[oldestUnackedNumber & (GECO_DATAGRAM_HISTORY_SIZE - 1)].inUse)
+        oldestUnackedNumber = (oldestUnackedNumber + 1) & INDEX_MASK;
+}
 
+void transport_layer_t::OnDatagramNaked(uint number, TimeUS timeUS)
+{
+    sent_datagram_t& sent = sentDatagrams[number & (GECO_DATAGRAM_HISTORY_SIZE - 1)];
+    if (!sent.inUse || sent.number != number) return;
+    OnDatagramLost(sent, timeUS, false);
+    sendBufferFlush = true;
+}
+
+void transport_layer_t::OnDatagramLost(sent_datagram_t& sent, TimeUS timeUS, bool timedOut)
+{
+    if (congestionController != 0)
+    {
+        congestionController->OnLoss(sent.bytes, sent.sendTime, timeUS, timedOut);
+        UpdatePacingState();
+    }
+    ResendDatagram(sent, timeUS);
+    AdvanceOldestUnacked();
+}
+
+void transport_layer_t::WriteRanges(geco_bit_stream_t& bitStream, JackieArraryQueue<datagram_range_t>& ranges,
+    uint maxBits, JackieArraryQueue<repeat_range_t>* repeats)
+{
+    /// count, then start and length - 1 of every range, all WriteMini() compressed.
+    /// a run of any length costs a few bytes, so ack size follows loss, not throughput
+    uint room = 0;
+    if (maxBits > MINI_UINT_MAX_BITS) room = (maxBits - MINI_UINT_MAX_BITS) / (2 * MINI_UINT_MAX_BITS);
+    uint count = room < ranges.Size() ? room : ranges.Size();
+    /// every repeat has repeats left, the ones run out are removed right after writing
+    uint repeatCount = 0;
+    if (repeats != 0) repeatCount = room - count < repeats->Size() ? room - count : repeats->Size();
+    bitStream.WriteMini(count + repeatCount);
+
+    /// newest repeats first, the oldest have been out the most often already
+    uint i;
+    for (i = 0; i < repeatCount; i++)
+    {
+        repeat_range_t& repeat = (*repeats)[repeats->Size() - 1 - i];
+        bitStream.WriteMini(repeat.range.start);
+        bitStream.WriteMini((repeat.range.end - repeat.range.start) & INDEX_MASK);
+        repeat.repeats--;
+    }
+    /// from the back, removing one leaves the index of the ones before it alone
+    uint size = repeatCount > 0 ? repeats->Size() : 0;
+    for (i = size; i > size - repeatCount; i--)
+    {
+        if ((*repeats)[i - 1].repeats == 0) repeats->RemoveAtIndex(i - 1);
+    }
+    repeat_range_t done;
+
+    repeat_range_t repeat;
+    repeat.repeats = GECO_ACK_REPEATS;
+    for (i = 0; i < count; i++)
+    {
+        ranges.PopHead(repeat.range);
+        bitStream.WriteMini(repeat.range.start);
+        bitStream.WriteMini((repeat.range.end - repeat.range.start) & INDEX_MASK);
+        if (repeats == 0 || GECO_ACK_REPEATS == 0) continue;
+        if (repeats->Size() >= ACK_REPEAT_RANGES_MAX) repeats->PopHead(done);
+        bool ret = repeats->PushTail(repeat);
+        assert(ret == true);
+    }
+}
+
+void transport_layer_t::SendAcksAndNaks(network_application_t* serverApp, remote_system_t* remoteSystem,
+    TimeUS timeUS)
+{
+    uint capacity = BYTES_TO_BITS(remoteSystem->MTUSize - UDP_HEADER_SIZE);
+    send_params_t jsp;
+    do
+    {
+        bool hasAcks = ackRanges.Size() > 0 || ackRepeatRanges.Size() > 0;
+        bool hasNaks = nakRanges.Size() > 0;
+        geco_bit_stream_t bitStream;
+        bitStream.Write(true); /// isValid
+        bitStream.Write(hasAcks);
+        bitStream.Write(hasNaks);
+        /// naks first, they are what the sender acts on straight away
+        if (hasNaks) WriteRanges(bitStream, nakRanges, capacity - bitStream.get_written_bits(), 0);
+        if (hasAcks)
+        {
+            /// every ack echoes the CE marks received so far
+            bitStream.WriteMini(ecnCEReceived);
+            WriteRanges(bitStream, ackRanges, capacity - bitStream.get_written_bits(), &ackRepeatRanges);
+        }
+
+        jsp.data = bitStream.char_data();
+        jsp.length = bitStream.get_written_bytes();
+        jsp.receiverINetAddress = remoteSystem->systemAddress;
+        jsp.senderINetAddress = remoteSystem->address2use;
+        serverApp->SendPaced(remoteSystem, &jsp);
+    } while (ackRanges.Size() > 0 || nakRanges.Size() > 0);
+    ackRangesTime = 0;
+    ackRepeatTime = timeUS;
+}
+
+bool transport_layer_t::ProcessAcksAndNaks(recv_params_t* recvParams, bool hasAcks, bool hasNaks)
+{
+    if (recvParams->bytesRead > GECO_MAX_JUMBO_MTU_SIZE) return false;
+    /// ReadMini() trusts the stream, give it zeroed room to run over into and
+    /// check where it ended up instead
+    uchar data[GECO_MAX_JUMBO_MTU_SIZE + 2 * sizeof(uint) + 2];
+    memcpy(data, recvParams->data, recvParams->bytesRead);
+    memset(data + recvParams->bytesRead, 0, sizeof(data) - recvParams->bytesRead);
+    geco_bit_stream_t bitStream(data, sizeof(data), false);
+    bit_size_t endBits = BYTES_TO_BITS(recvParams->bytesRead);
+    bitStream.skip_read_bits(3);
+
+    uint count, start, length, number;
+    for (int pass = 0; pass < 2; pass++)
+    {
+        bool isNak = pass == 0;
+        if (isNak ? !hasNaks : !hasAcks) continue;
+        if (!isNak)
+        {
+            uint ceEchoed;
+            bitStream.ReadMini(ceEchoed);
+            if (bitStream.readable_bit_pos() > endBits) return false;
+            if (OnEcnCEEchoed(ceEchoed) && congestionController != 0)
+            {
+                congestionController->OnCongestionEvent(recvParams->timeRead);
+                UpdatePacingState();
+            }
+        }
+        bitStream.ReadMini(count);
+        if (bitStream.readable_bit_pos() > endBits) return false;
+        for (uint i = 0; i < count; i++)
+        {
+            bitStream.ReadMini(start);
+            bitStream.ReadMini(length);
+            if (bitStream.readable_bit_pos() > endBits || start > INDEX_MASK || length > INDEX_MASK)
+                return false;
+            if (length >= GECO_DATAGRAM_HISTORY_SIZE)
+            {
+                /// only the newest end of a long run can still be in the history
+                start = (start + length - (GECO_DATAGRAM_HISTORY_SIZE - 1)) & INDEX_MASK;
+                length = GECO_DATAGRAM_HISTORY_SIZE - 1;
+            }
+            for (uint j = 0; j <= length; j++)
+            {
+                number = (start + j) & INDEX_MASK;
+                if (isNak) OnDatagramNaked(number, recvParams->timeRead);
+                else OnDatagramAcked(number, recvParams->timeRead);
+            }
+        }
+    }
+    return true;
+}
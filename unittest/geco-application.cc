@@ -10,6 +10,8 @@
 #include "geco-secure-hand-shake.h"
 #include "network_socket_t.h"
 #include "geco-net-type.h"
+#include "JackieBytesRing.h"
+#include "geco-virtual-network.h"
 using namespace geco::net;
 static const unsigned char OFFLINE_MESSAGE_DATA_ID[16] =
 { 0x00, 0xFF, 0xFF, 0x00, 0xFE, 0xFE, 0xFE, 0xFE, 0xFD, 0xFD, 0xFD, 0xFD, 0x12,
@@ -192,4 +194,211 @@ TEST(JISBerkleyTests, test_GetMyIPBerkley)
         printf("(%s)\n", addr[i].ToString());
     }
 }
+TEST(JackieBytesRingTests, records_are_packed_and_released_out_of_order)
+{
+    JackieBytesRing<1024> ring;
+    EXPECT_TRUE(ring.HasRoomFor(4, 200));
+
+    char* a = ring.Allocate(40);
+    char* b = ring.Allocate(40);
+    char* c = ring.Allocate(40);
+    ASSERT_TRUE(a != 0 && b != 0 && c != 0);
+    /// small records sit back to back, only an 8 bytes header in between
+    EXPECT_EQ(48, b - a);
+    EXPECT_EQ(48, c - b);
+
+    /// releasing the middle one does not move release cursor
+    ring.Release(b);
+    EXPECT_EQ(144u, ring.Size());
+    ring.Release(a);
+    EXPECT_EQ(48u, ring.Size());
+    ring.Release(c);
+    EXPECT_TRUE(ring.IsEmpty());
+}
+TEST(JackieBytesRingTests, wraps_with_padding_and_refuses_when_full)
+{
+    JackieBytesRing<1024> ring;
+    char* a = ring.Allocate(600);
+    char* b = ring.Allocate(300);
+    ASSERT_TRUE(a != 0 && b != 0);
+    EXPECT_TRUE(ring.Allocate(200) == 0);
+    EXPECT_FALSE(ring.HasRoomFor(1, 200));
+
+    /// front is free again, next record wraps to the start of slab
+    ring.Release(a);
+    EXPECT_TRUE(ring.HasRoomFor(1, 200));
+    char* c = ring.Allocate(200);
+    EXPECT_TRUE(c == a);
+    ring.Release(b);
+    ring.Release(c);
+    EXPECT_TRUE(ring.IsEmpty());
+}
+TEST(JackieBytesRingTests, shrink_gives_tail_back_to_write_cursor)
+{
+    JackieBytesRing<1024> ring;
+    char* a = ring.Allocate(200);
+    char* b = ring.Allocate(200);
+    char* c = ring.Allocate(200);
+    ASSERT_TRUE(a != 0 && b != 0 && c != 0);
+
+    /// latest first, unfilled c and the tail of b go back to write cursor
+    ring.Shrink(c, 0);
+    ring.Shrink(b, 40);
+    EXPECT_EQ(208u + 48u, ring.Size());
+    EXPECT_TRUE(ring.Allocate(8) == b + 48);
+
+    /// a is not the latest one, its tail stays behind as padding
+    ring.Shrink(a, 40);
+    EXPECT_EQ(208u + 48u + 16u, ring.Size());
+    ring.Release(a);
+    EXPECT_EQ(48u + 16u, ring.Size());
+    ring.Release(b);
+    ring.Release(b + 48);
+    EXPECT_TRUE(ring.IsEmpty());
+}
+TEST(JackieBytesRingTests, repack_packs_a_recv_batch_back_to_back)
+{
+    /// a recv batch, every record allocated at mtu, only two datagrams arrived
+    JackieBytesRing<8192> ring;
+    char* datas[4];
+    unsigned int sizes[4] = { 100, 60, 0, 0 };
+    for (int i = 0; i < 4; i++)
+    {
+        datas[i] = ring.Allocate(1500);
+        ASSERT_TRUE(datas[i] != 0);
+        memset(datas[i], 'a' + i, sizes[i]);
+    }
+    EXPECT_EQ(4u * 1512u, ring.Size());
+
+    ring.Repack(datas, sizes, 4);
+    EXPECT_EQ(112u + 72u, ring.Size());
+    EXPECT_TRUE(datas[1] == datas[0] + 112);
+    EXPECT_TRUE(datas[2] == 0 && datas[3] == 0);
+    EXPECT_EQ('a', datas[0][99]);
+    EXPECT_EQ('b', datas[1][0]);
+    EXPECT_EQ('b', datas[1][59]);
+    EXPECT_TRUE(ring.Allocate(8) == datas[1] + 72);
+}
+TEST(JackieBytesRingTests, repack_moves_a_wrapped_batch_back_before_the_wrap)
+{
+    JackieBytesRing<8192> ring;
+    char* x = ring.Allocate(2000);
+    char* y = ring.Allocate(1000);
+    ASSERT_TRUE(x != 0 && y != 0);
+    ring.Release(x);
+
+    /// the last record does not fit at the end of slab and wraps to the front
+    char* datas[4];
+    unsigned int sizes[4] = { 100, 200, 300, 50 };
+    for (int i = 0; i < 4; i++)
+    {
+        datas[i] = ring.Allocate(1500);
+        ASSERT_TRUE(datas[i] != 0);
+        memset(datas[i], 'a' + i, sizes[i]);
+    }
+    EXPECT_TRUE(datas[3] == x);
+
+    ring.Repack(datas, sizes, 4);
+    EXPECT_EQ(1008u + 112u + 208u + 312u + 64u, ring.Size());
+    EXPECT_TRUE(datas[0] == y + 1008);
+    EXPECT_TRUE(datas[3] == datas[2] + 312);
+    for (int i = 0; i < 4; i++)
+    {
+        EXPECT_EQ('a' + i, datas[i][0]);
+        EXPECT_EQ('a' + i, datas[i][sizes[i] - 1]);
+    }
+
+    ring.Release(y);
+    for (int i = 0; i < 4; i++) ring.Release(datas[i]);
+    EXPECT_TRUE(ring.IsEmpty());
+}
+TEST(VirtualNetworkTests, routes_by_address_and_drops_unknown_receiver)
+{
+    virtual_network_t network;
+    network_address_t serverAddr("127.0.0.1|9000");
+    network_address_t clientAddr("127.0.0.1|0");
+    virtual_transceiver_t* server = network.Attach(serverAddr, true);
+    virtual_transceiver_t* client = network.Attach(clientAddr, true);
+    ASSERT_TRUE(server != 0 && client != 0);
+    /// port 0 gets a free one, the same address can not be taken twice
+    EXPECT_NE(0, clientAddr.GetPortHostOrder());
+    EXPECT_TRUE(network.Attach(serverAddr, true) == 0);
+
+    char data[MAXIMUM_MTU_SIZE];
+    network_address_t sender;
+    EXPECT_EQ(5, client->JackieINetSendTo("hello", 5, serverAddr));
+    EXPECT_EQ(5, server->JackieINetRecvFrom(data, sizeof(data), &sender, false));
+    EXPECT_EQ(0, memcmp(data, "hello", 5));
+    EXPECT_TRUE(sender == clientAddr);
+    EXPECT_EQ(0, server->JackieINetRecvFrom(data, sizeof(data), &sender, false));
 
+    /// like udp, nobody bound there is not an error for the sender
+    EXPECT_EQ(5, client->JackieINetSendTo("hello", 5, network_address_t("127.0.0.1|9001")));
+    EXPECT_EQ(1u, network.GetDatagramsDelivered());
+    EXPECT_EQ(1u, network.GetDatagramsDropped());
+
+    network.Detach(client);
+    network.Detach(server);
+    EXPECT_EQ(0u, network.GetEndpointsSize());
+}
+#if defined(__linux__) && !defined(ANDROID)
+static void send_raw(int fd, const unsigned char *data, int length, const network_address_t &to)
+{
+    EXPECT_EQ(length, (int)sendto(fd, data, length, 0, (const sockaddr*)&to.address.addr4, sizeof(sockaddr_in)));
+}
+TEST(JISBerkleyTests, recv_prefilter_keeps_wakeup_connected_and_valid_offline_only)
+{
+    berkley_socket_t server;
+    berkley_socket_binding_params_t bp;
+    memset(&bp, 0, sizeof(bp));
+    bp.hostAddress = (char*)"127.0.0.1";
+    bp.addressFamily = AF_INET;
+    bp.type = SOCK_DGRAM;
+    bp.isNonBlocking = true;
+    ASSERT_EQ(JISBindResult_SUCCESS, server.Bind(&bp, TRACKE_MALLOC));
+    ASSERT_TRUE(server.AttachRecvPrefilter(OFFLINE_MESSAGE_DATA_ID));
+
+    network_address_t to = server.GetBoundAddress();
+    int client = socket(AF_INET, SOCK_DGRAM, 0);
+    ASSERT_NE(-1, client);
+    /// every kept one has its own length so the order they come in tells them apart
+    unsigned char data[64];
+    const int offset = sizeof(msg_id_t);
+
+    data[0] = ID_RECV_WAKEUP;
+    send_raw(client, data, 1, to);
+    /// short junk
+    data[0] = 5;
+    send_raw(client, data, 1, to);
+    /// connected, isValid bit set
+    memset(data, 0, sizeof(data));
+    data[0] = 0x80;
+    send_raw(client, data, 10, to);
+    /// valid magic
+    data[0] = ID_OPEN_CONNECTION_REQUEST_1;
+    memcpy(data + offset, OFFLINE_MESSAGE_DATA_ID, sizeof(OFFLINE_MESSAGE_DATA_ID));
+    send_raw(client, data, 30, to);
+    /// wrong magic
+    data[offset + 15] ^= 1;
+    send_raw(client, data, 31, to);
+    data[offset + 15] ^= 1;
+    /// magic cut short
+    send_raw(client, data, offset + 12, to);
+    /// not an offline id, the magic does not make it one
+    data[0] = ID_CONNECTED_PING;
+    send_raw(client, data, 32, to);
+    close(client);
+    GecoSleep(10);
+
+    int kept[8];
+    int keptSize = 0;
+    unsigned char in[64];
+    int len;
+    while (keptSize < 8 && (len = (int)recv(server.GetSocket(), in, sizeof(in), MSG_DONTWAIT)) > 0)
+        kept[keptSize++] = len;
+    ASSERT_EQ(3, keptSize);
+    EXPECT_EQ(1, kept[0]);
+    EXPECT_EQ(10, kept[1]);
+    EXPECT_EQ(30, kept[2]);
+}
+#endif
@@ -415,3 +415,29 @@ TEST(GecoMemoryStreamTestCase, test_all_reads_and_writes_un_compressed)
         s9.reset();
     }
 }
+
+TEST(GecoMemoryStreamTestCase, test_mini_round_trips_values_with_high_bits_in_low_byte)
+{
+    /// low byte 0xF0-0xFF once came back as the low nibble only
+    const uint values[] = { 0, 0x0F, 0xF0, 0xF5, 0xFF, 0x1F0, 0xFFF5, 0xFFFFF0, 0xFFFFFFFF };
+    geco_bit_stream_t s;
+    for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++)
+    {
+        s.WriteMini(values[i]);
+        s.WriteMini((ushort)values[i]);
+        s.WriteMini((uchar)values[i]);
+    }
+    for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++)
+    {
+        uint u32 = 0;
+        ushort u16 = 0;
+        uchar u8 = 0;
+        s.ReadMini(u32);
+        s.ReadMini(u16);
+        s.ReadMini(u8);
+        EXPECT_EQ(values[i], u32);
+        EXPECT_EQ((ushort)values[i], u16);
+        EXPECT_EQ((uchar)values[i], u8);
+    }
+    EXPECT_EQ(0u, s.get_payloads());
+}
@@ -0,0 +1,143 @@
+#include "gtest/gtest.h"
+#include "geco-shm-transport.h"
+#include "geco-msg-ids.h"
+
+#if GECO_ENABLE_SHM_TRANSPORT == 1
+#include <unistd.h>
+#include <sys/socket.h>
+
+using namespace geco::net;
+
+/// both ends in one process, @udp is where either would ring the doorbell
+class ShmTransportTests : public ::testing::Test
+{
+    protected:
+    berkley_socket_t udp;
+    network_address_t remote;
+    guid_t low;
+    guid_t high;
+    char path[128];
+
+    virtual void SetUp()
+    {
+        berkley_socket_binding_params_t bp;
+        memset(&bp, 0, sizeof(bp));
+        bp.hostAddress = (char*)"127.0.0.1";
+        bp.addressFamily = AF_INET;
+        bp.type = SOCK_DGRAM;
+        bp.isNonBlocking = true;
+        ASSERT_EQ(JISBindResult_SUCCESS, udp.Bind(&bp, TRACKE_MALLOC));
+        remote = udp.GetBoundAddress();
+        low = guid_t(getpid() * 2ULL);
+        high = guid_t(getpid() * 2ULL + 1);
+        snprintf(path, sizeof(path), "/dev/shm/geco-shm-%llx-%llx",
+            (unsigned long long)low.g, (unsigned long long)high.g);
+    }
+    /// what came in on @udp, 0 if nothing
+    int RecvUdp(char *data)
+    {
+        int len = (int)recv(udp.GetSocket(), data, MAXIMUM_MTU_SIZE, MSG_DONTWAIT);
+        return len > 0 ? len : 0;
+    }
+};
+
+TEST_F(ShmTransportTests, datagrams_round_trip_both_ways)
+{
+    shm_transceiver_t a, b;
+    ASSERT_TRUE(a.Open(low, high, remote, &udp, MAXIMUM_MTU_SIZE));
+    EXPECT_FALSE(a.IsRemoteAttached());
+    ASSERT_TRUE(b.Open(high, low, remote, &udp, MAXIMUM_MTU_SIZE));
+    EXPECT_TRUE(a.IsRemoteAttached());
+    EXPECT_TRUE(b.IsRemoteAttached());
+
+    char data[MAXIMUM_MTU_SIZE];
+    network_address_t sender;
+    EXPECT_EQ(5, a.JackieINetSendTo("hello", 5, remote));
+    EXPECT_EQ(5, b.JackieINetRecvFrom(data, sizeof(data), &sender, false));
+    EXPECT_EQ(0, memcmp(data, "hello", 5));
+    EXPECT_TRUE(sender == remote);
+    EXPECT_EQ(0, b.JackieINetRecvFrom(data, sizeof(data), &sender, false));
+
+    EXPECT_EQ(2, b.JackieINetSendTo("hi", 2, remote));
+    EXPECT_EQ(2, a.JackieINetRecvFrom(data, sizeof(data), &sender, false));
+    EXPECT_EQ(0, memcmp(data, "hi", 2));
+    /// nothing went the udp way
+    EXPECT_EQ(0, RecvUdp(data));
+}
+
+TEST_F(ShmTransportTests, full_ring_drops_and_too_big_is_counted)
+{
+    shm_transceiver_t a, b;
+    ASSERT_TRUE(a.Open(low, high, remote, &udp, MAXIMUM_MTU_SIZE));
+    ASSERT_TRUE(b.Open(high, low, remote, &udp, 100));
+
+    char data[MAXIMUM_MTU_SIZE] = { 0 };
+    network_address_t sender;
+    for (int i = 0; i < GECO_SHM_TRANSPORT_SLOTS; i++)
+        EXPECT_EQ(10, a.JackieINetSendTo(data, 10, remote));
+    EXPECT_EQ(0u, a.GetDatagramsDropped());
+    EXPECT_EQ(10, a.JackieINetSendTo(data, 10, remote));
+    EXPECT_EQ(1u, a.GetDatagramsDropped());
+    for (int i = 0; i < GECO_SHM_TRANSPORT_SLOTS; i++)
+        EXPECT_EQ(10, b.JackieINetRecvFrom(data, sizeof(data), &sender, false));
+    EXPECT_EQ(0, b.JackieINetRecvFrom(data, sizeof(data), &sender, false));
+
+    /// longer than the mtu of b, then than what the caller has room for
+    EXPECT_EQ(200, a.JackieINetSendTo(data, 200, remote));
+    EXPECT_EQ(0, b.JackieINetRecvFrom(data, sizeof(data), &sender, false));
+    EXPECT_EQ(1u, b.GetDatagramsTooBig());
+    EXPECT_EQ(50, a.JackieINetSendTo(data, 50, remote));
+    EXPECT_EQ(0, b.JackieINetRecvFrom(data, 40, &sender, false));
+    EXPECT_EQ(2u, b.GetDatagramsTooBig());
+    /// both left the ring
+    EXPECT_EQ(0, b.JackieINetRecvFrom(data, sizeof(data), &sender, false));
+}
+
+TEST_F(ShmTransportTests, doorbell_is_not_armed_with_data_pending)
+{
+    shm_transceiver_t a, b;
+    ASSERT_TRUE(a.Open(low, high, remote, &udp, MAXIMUM_MTU_SIZE));
+    ASSERT_TRUE(b.Open(high, low, remote, &udp, MAXIMUM_MTU_SIZE));
+
+    char data[MAXIMUM_MTU_SIZE];
+    network_address_t sender;
+    EXPECT_EQ(5, a.JackieINetSendTo("hello", 5, remote));
+    EXPECT_FALSE(b.ArmDoorbell());
+    /// not armed, no doorbell on the next send
+    EXPECT_EQ(5, a.JackieINetSendTo("hello", 5, remote));
+    GecoSleep(10);
+    EXPECT_EQ(0, RecvUdp(data));
+    EXPECT_EQ(5, b.JackieINetRecvFrom(data, sizeof(data), &sender, false));
+    EXPECT_EQ(5, b.JackieINetRecvFrom(data, sizeof(data), &sender, false));
+
+    /// empty ring arms, the next send rings once
+    EXPECT_TRUE(b.ArmDoorbell());
+    EXPECT_EQ(5, a.JackieINetSendTo("hello", 5, remote));
+    EXPECT_EQ(5, a.JackieINetSendTo("hello", 5, remote));
+    GecoSleep(10);
+    EXPECT_EQ(1, RecvUdp(data));
+    EXPECT_EQ((char)ID_RECV_WAKEUP, data[0]);
+    EXPECT_EQ(0, RecvUdp(data));
+}
+
+TEST_F(ShmTransportTests, last_close_unlinks_the_segment)
+{
+    shm_transceiver_t a, b;
+    ASSERT_TRUE(a.Open(low, high, remote, &udp, MAXIMUM_MTU_SIZE));
+    ASSERT_TRUE(b.Open(high, low, remote, &udp, MAXIMUM_MTU_SIZE));
+    EXPECT_EQ(0, access(path, F_OK));
+
+    a.Close();
+    EXPECT_FALSE(a.IsOpen());
+    EXPECT_FALSE(b.IsRemoteAttached());
+    EXPECT_EQ(0, access(path, F_OK));
+    /// without the other end it goes the udp way
+    char data[MAXIMUM_MTU_SIZE];
+    EXPECT_EQ(5, b.JackieINetSendTo("hello", 5, remote));
+    GecoSleep(10);
+    EXPECT_EQ(5, RecvUdp(data));
+
+    b.Close();
+    EXPECT_NE(0, access(path, F_OK));
+}
+#endif
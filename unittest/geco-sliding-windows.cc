@@ -0,0 +1,164 @@
+#include "gtest/gtest.h"
+#include "geco-sliding-windows.h"
+
+using namespace geco::net;
+
+static const ushort MTU = 1000;
+
+TEST(SlidingWindowsTests, slow_start_grows_cwnd_by_every_byte_acked)
+{
+    JackieSlidingWindows cc;
+    cc.Reset(MTU);
+    EXPECT_EQ((uint)GECO_CC_INITIAL_WINDOW * MTU, cc.GetCongestionWindow());
+    EXPECT_TRUE(cc.IsInSlowStart());
+
+    for (uint i = 0; i < GECO_CC_INITIAL_WINDOW; i++)
+    {
+        EXPECT_TRUE(cc.CanSend(MTU));
+        cc.OnSend(MTU, 0);
+    }
+    EXPECT_FALSE(cc.CanSend(MTU));
+    EXPECT_EQ((uint)GECO_CC_INITIAL_WINDOW * MTU, cc.GetBytesInFlight());
+
+    /// a whole window acked doubles it
+    for (uint i = 0; i < GECO_CC_INITIAL_WINDOW; i++)
+        cc.OnAck(MTU, 0, 100000);
+    EXPECT_EQ(2u * GECO_CC_INITIAL_WINDOW * MTU, cc.GetCongestionWindow());
+    EXPECT_EQ(0u, cc.GetBytesInFlight());
+}
+
+TEST(SlidingWindowsTests, empty_pipe_takes_one_datagram_whatever_cwnd)
+{
+    JackieSlidingWindows cc;
+    cc.Reset(MTU);
+    EXPECT_TRUE(cc.CanSend(100 * MTU));
+    cc.OnSend(100 * MTU, 0);
+    EXPECT_FALSE(cc.CanSend(1));
+}
+
+TEST(SlidingWindowsTests, congestion_avoidance_grows_one_mtu_per_window_acked)
+{
+    JackieSlidingWindows cc;
+    cc.Reset(MTU);
+    for (uint i = 0; i < GECO_CC_INITIAL_WINDOW; i++)
+        cc.OnSend(MTU, 0);
+    cc.OnLoss(MTU, 0, 1000, false);
+    uint cwnd = cc.GetCongestionWindow();
+    EXPECT_EQ(cwnd, cc.GetSsthresh());
+    EXPECT_FALSE(cc.IsInSlowStart());
+
+    /// sent after the back off, so they count toward growth
+    for (uint acked = MTU; acked < cwnd; acked += MTU)
+    {
+        cc.OnSend(MTU, 2000);
+        cc.OnAck(MTU, 2000, 102000);
+        EXPECT_EQ(cwnd, cc.GetCongestionWindow());
+    }
+    cc.OnSend(MTU, 2000);
+    cc.OnAck(MTU, 2000, 102000);
+    EXPECT_EQ(cwnd + MTU, cc.GetCongestionWindow());
+}
+
+TEST(SlidingWindowsTests, losses_of_one_window_back_off_once)
+{
+    JackieSlidingWindows cc;
+    cc.Reset(MTU);
+    /// 16 mtu in slow start
+    for (uint i = 0; i < 12; i++)
+    {
+        cc.OnSend(MTU, 0);
+        cc.OnAck(MTU, 0, 100000);
+    }
+    EXPECT_EQ(16u * MTU, cc.GetCongestionWindow());
+
+    for (uint i = 0; i < 16; i++)
+        cc.OnSend(MTU, 200000);
+    cc.OnLoss(MTU, 200000, 300000, false);
+    EXPECT_EQ(8u * MTU, cc.GetCongestionWindow());
+    EXPECT_EQ(8u * MTU, cc.GetSsthresh());
+
+    /// the rest of the burst was sent before the back off
+    cc.OnLoss(MTU, 200000, 310000, false);
+    cc.OnLoss(MTU, 200000, 320000, true);
+    cc.OnCongestionEvent(320000);
+    EXPECT_EQ(8u * MTU, cc.GetCongestionWindow());
+    /// nor do their acks grow cwnd back
+    cc.OnAck(MTU, 200000, 330000);
+    EXPECT_EQ(8u * MTU, cc.GetCongestionWindow());
+
+    /// a datagram sent after it opens the next period
+    cc.OnSend(MTU, 400000);
+    cc.OnLoss(MTU, 400000, 500000, false);
+    EXPECT_EQ(4u * MTU, cc.GetCongestionWindow());
+}
+
+TEST(SlidingWindowsTests, ssthresh_never_drops_below_two_mtu)
+{
+    JackieSlidingWindows cc;
+    cc.Reset(MTU);
+    cc.OnSend(MTU, 0);
+    cc.OnLoss(MTU, 0, 1000, false);
+    cc.OnSend(MTU, 2000);
+    cc.OnLoss(MTU, 2000, 3000, false);
+    EXPECT_EQ(2u * MTU, cc.GetSsthresh());
+    EXPECT_EQ(2u * MTU, cc.GetCongestionWindow());
+}
+
+TEST(SlidingWindowsTests, timeout_reenters_slow_start_and_doubles_rto)
+{
+    JackieSlidingWindows cc;
+    cc.Reset(MTU);
+    EXPECT_EQ((TimeUS)GECO_CC_INITIAL_RTO_US, cc.GetRto());
+
+    for (uint i = 0; i < GECO_CC_INITIAL_WINDOW; i++)
+        cc.OnSend(MTU, 0);
+    cc.OnLoss(MTU, 0, GECO_CC_INITIAL_RTO_US, true);
+    EXPECT_EQ((uint)MTU, cc.GetCongestionWindow());
+    EXPECT_EQ(2u * MTU, cc.GetSsthresh());
+    EXPECT_TRUE(cc.IsInSlowStart());
+    EXPECT_EQ((TimeUS)2 * GECO_CC_INITIAL_RTO_US, cc.GetRto());
+
+    /// the rest of the window timing out with it is the same event
+    cc.OnLoss(MTU, 0, GECO_CC_INITIAL_RTO_US, true);
+    EXPECT_EQ((TimeUS)2 * GECO_CC_INITIAL_RTO_US, cc.GetRto());
+
+    /// repeated timeouts double it up to the cap
+    TimeUS now = GECO_CC_INITIAL_RTO_US;
+    for (int i = 0; i < 10; i++)
+    {
+        now += cc.GetRto();
+        cc.OnSend(MTU, now);
+        cc.OnLoss(MTU, now, now + cc.GetRto(), true);
+    }
+    EXPECT_EQ((TimeUS)GECO_CC_MAX_RTO_US, cc.GetRto());
+}
+
+TEST(SlidingWindowsTests, rtt_estimation_follows_rfc_6298)
+{
+    JackieSlidingWindows cc;
+    cc.Reset(MTU);
+    EXPECT_EQ(0u, cc.GetSmoothedRtt());
+
+    cc.OnSend(MTU, 0);
+    cc.OnAck(MTU, 0, 200000);
+    /// first sample: srtt = r, rttvar = r / 2, rto = srtt + 4 * rttvar
+    EXPECT_EQ((TimeUS)200000, cc.GetSmoothedRtt());
+    EXPECT_EQ((TimeUS)600000, cc.GetRto());
+
+    cc.OnSend(MTU, 1000000);
+    cc.OnAck(MTU, 1000000, 1120000);
+    /// rttvar = 3/4 * 100000 + 1/4 * 80000, srtt = 7/8 * 200000 + 1/8 * 120000
+    EXPECT_EQ((TimeUS)190000, cc.GetSmoothedRtt());
+    EXPECT_EQ((TimeUS)(190000 + 4 * 95000), cc.GetRto());
+
+    /// a fresh sample undoes the back off of a timeout, never below the minimum
+    cc.OnSend(MTU, 2000000);
+    cc.OnLoss(MTU, 2000000, 3000000, true);
+    EXPECT_EQ((TimeUS)2 * (190000 + 4 * 95000), cc.GetRto());
+    for (int i = 0; i < 50; i++)
+    {
+        cc.OnSend(MTU, 4000000);
+        cc.OnAck(MTU, 4000000, 4001000);
+    }
+    EXPECT_EQ((TimeUS)GECO_CC_MIN_RTO_US, cc.GetRto());
+}
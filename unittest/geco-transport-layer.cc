@@ -0,0 +1,436 @@
+#include "gtest/gtest.h"
+#include "geco-bit-stream.h"
+#include "geco-net-type.h"
+#include "geco-sliding-windows.h"
+#include "network_socket_t.h"
+#include "transport_layer_t.h"
+#include <vector>
+
+using namespace geco::net;
+
+static packet_fixed_t make_header(packet_reliability_t reliability)
+{
+    packet_fixed_t header;
+    header.reliability = reliability;
+    header.dataBitLength = 12345;
+    header.packetIndex = 0xABCDEF;
+    header.sequencingIndex = 0x123456;
+    header.orderingIndex = 0x654321;
+    header.orderingChannel = 31;
+    header.splitPacketCount = 0;
+    return header;
+}
+
+TEST(TransportLayerTests, message_header_round_trips_for_every_reliability)
+{
+    for (int r = UNRELIABLE_NOT_ACK_RECEIPT_OF_PACKET; r <= RELIABLE_SEQUENCED_NOT_ACK_RECEIPT_OF_PACKET; r++)
+    {
+        packet_fixed_t written = make_header((packet_reliability_t)r);
+        geco_bit_stream_t bitStream;
+        transport_layer_t::WriteMessageHeader(bitStream, written);
+        EXPECT_EQ(transport_layer_t::GetMessageHeaderBits(&written), bitStream.get_written_bits());
+
+        packet_fixed_t read;
+        EXPECT_TRUE(transport_layer_t::ReadMessageHeader(bitStream, read));
+        EXPECT_EQ(written.reliability, read.reliability);
+        EXPECT_EQ(written.dataBitLength, read.dataBitLength);
+        bool reliable = r >= RELIABLE_NOT_ACK_RECEIPT_OF_PACKET;
+        bool sequenced = r == UNRELIABLE_SEQUENCED_NOT_ACK_RECEIPT_OF_PACKET ||
+            r == RELIABLE_SEQUENCED_NOT_ACK_RECEIPT_OF_PACKET;
+        if (reliable)
+            EXPECT_EQ(written.packetIndex.val, read.packetIndex.val);
+        if (sequenced)
+            EXPECT_EQ(written.sequencingIndex.val, read.sequencingIndex.val);
+        if (sequenced || r == RELIABLE_ORDERED_NOT_ACK_RECEIPT_OF_PACKET)
+        {
+            EXPECT_EQ(written.orderingIndex.val, read.orderingIndex.val);
+            EXPECT_EQ(written.orderingChannel, read.orderingChannel);
+        }
+        EXPECT_EQ(0u, bitStream.get_payloads());
+    }
+}
+
+TEST(TransportLayerTests, message_header_read_rejects_truncated_split_and_empty)
+{
+    packet_fixed_t written = make_header(RELIABLE_ORDERED_NOT_ACK_RECEIPT_OF_PACKET);
+    packet_fixed_t read;
+
+    geco_bit_stream_t full;
+    transport_layer_t::WriteMessageHeader(full, written);
+    /// every cut short of the whole header
+    for (uint bytes = 0; bytes < full.get_written_bytes() - 1; bytes++)
+    {
+        geco_bit_stream_t cut(full.uchar_data(), bytes, false);
+        EXPECT_FALSE(transport_layer_t::ReadMessageHeader(cut, read));
+    }
+
+    uchar reliability = (uchar)RELIABLE_NOT_ACK_RECEIPT_OF_PACKET;
+    geco_bit_stream_t split;
+    split.WriteBits(&reliability, 3, true);
+    split.Write(true);
+    split.Write((ushort)8);
+    split.Write(uint24_t(1));
+    EXPECT_FALSE(transport_layer_t::ReadMessageHeader(split, read));
+
+    geco_bit_stream_t empty;
+    empty.WriteBits(&reliability, 3, true);
+    empty.Write(false);
+    empty.Write((ushort)0);
+    empty.Write(uint24_t(1));
+    EXPECT_FALSE(transport_layer_t::ReadMessageHeader(empty, read));
+}
+
+static reliable_send_params_t make_send_params(char* data, uint bytes, packet_send_priority_t priority)
+{
+    reliable_send_params_t sp;
+    memset(&sp, 0, sizeof(sp));
+    sp.data = data;
+    sp.bitsSize = BYTES_TO_BITS(bytes);
+    sp.makeDataCopy = true;
+    sp.sendPriority = priority;
+    sp.packetReliability = UNRELIABLE_NOT_ACK_RECEIPT_OF_PACKET;
+    sp.currentTime = 5000;
+    sp.mtu = 1400;
+    return sp;
+}
+
+TEST(TransportLayerTests, send_rejects_what_one_datagram_can_not_carry)
+{
+    char data[1400] = { 0 };
+    transport_layer_t layer;
+    layer.Reset(true, 1400, false);
+
+    reliable_send_params_t sp = make_send_params(data, 20, BUFFERED_FIRSTLY_SEND);
+    sp.bitsSize = 0;
+    EXPECT_FALSE(layer.Send(sp));
+
+    sp = make_send_params(data, 20, BUFFERED_FIRSTLY_SEND);
+    sp.packetReliability = RELIABLE_SEQUENCED_WITH_ACK_RECEIPT;
+    EXPECT_FALSE(layer.Send(sp));
+
+    sp = make_send_params(data, 20, BUFFERED_FIRSTLY_SEND);
+    sp.orderingChannel = ORDERING_CHANNELS_SIZE;
+    EXPECT_FALSE(layer.Send(sp));
+
+    /// the biggest one behind the udp, datagram and message headers
+    uint room = 1400 - UDP_HEADER_SIZE - 4 - 3;
+    sp = make_send_params(data, room + 1, BUFFERED_FIRSTLY_SEND);
+    EXPECT_FALSE(layer.Send(sp));
+    sp = make_send_params(data, room, BUFFERED_FIRSTLY_SEND);
+    EXPECT_TRUE(layer.Send(sp));
+}
+
+TEST(TransportLayerTests, small_messages_wait_for_more_until_the_datagram_is_full)
+{
+    char data[40] = { 0 };
+    transport_layer_t layer;
+    layer.Reset(true, 1400, false);
+    EXPECT_EQ(0u, layer.GetNextSendTime());
+
+    reliable_send_params_t sp = make_send_params(data, sizeof(data), BUFFERED_FIRSTLY_SEND);
+    EXPECT_TRUE(layer.Send(sp));
+    EXPECT_EQ(5000u + GECO_SEND_AGGREGATION_DELAY_US, layer.GetNextSendTime());
+
+    /// 33 of them fill one datagram of mtu 1400
+    for (int i = 0; i < 32; i++)
+    {
+        sp = make_send_params(data, sizeof(data), BUFFERED_FIRSTLY_SEND);
+        EXPECT_TRUE(layer.Send(sp));
+    }
+    EXPECT_EQ(5000u, layer.GetNextSendTime());
+}
+
+TEST(TransportLayerTests, immediate_message_flushes_what_is_buffered)
+{
+    char data[40] = { 0 };
+    transport_layer_t layer;
+    layer.Reset(true, 1400, false);
+
+    reliable_send_params_t sp = make_send_params(data, sizeof(data), BUFFERED_SECONDLY_SEND);
+    EXPECT_TRUE(layer.Send(sp));
+    EXPECT_EQ(5000u + GECO_SEND_AGGREGATION_DELAY_US, layer.GetNextSendTime());
+
+    sp = make_send_params(data, sizeof(data), UNBUFFERED_IMMEDIATELY_SEND);
+    sp.currentTime = 5300;
+    EXPECT_TRUE(layer.Send(sp));
+    /// from when the oldest was buffered
+    EXPECT_EQ(5000u, layer.GetNextSendTime());
+}
+
+/// reaches the ack bookkeeping transport_layer_t keeps to itself
+class transport_layer_probe_t : public transport_layer_t
+{
+    public:
+    using transport_layer_t::AddRange;
+    using transport_layer_t::IsReliableDuplicate;
+    using transport_layer_t::IsOrderingStale;
+    using transport_layer_t::IsOrderingAhead;
+    using transport_layer_t::HoldOrdering;
+    using transport_layer_t::OnOrderingDelivered;
+    using transport_layer_t::PopOrderingReady;
+    using transport_layer_t::FreeInternalPacket;
+    using transport_layer_t::GetRto;
+    using transport_layer_t::OnRttSample;
+};
+
+TEST(TransportLayerTests, add_range_merges_only_what_touches_the_last_range)
+{
+    JackieArraryQueue<datagram_range_t> ranges;
+    transport_layer_probe_t::AddRange(ranges, 10, 10);
+    transport_layer_probe_t::AddRange(ranges, 11, 11);
+    transport_layer_probe_t::AddRange(ranges, 12, 20);
+    EXPECT_EQ(1u, ranges.Size());
+    EXPECT_EQ(10u, ranges[0].start);
+    EXPECT_EQ(20u, ranges[0].end);
+
+    /// a hole opens a new one
+    transport_layer_probe_t::AddRange(ranges, 22, 22);
+    EXPECT_EQ(2u, ranges.Size());
+    EXPECT_EQ(22u, ranges[1].start);
+
+    /// datagram numbers are 24 bits and wrap
+    transport_layer_probe_t::AddRange(ranges, 0xFFFFFE, 0xFFFFFF);
+    transport_layer_probe_t::AddRange(ranges, 0, 3);
+    EXPECT_EQ(3u, ranges.Size());
+    EXPECT_EQ(0xFFFFFEu, ranges[2].start);
+    EXPECT_EQ(3u, ranges[2].end);
+}
+
+TEST(TransportLayerTests, reliable_duplicates_are_caught_across_the_index_wrap)
+{
+    transport_layer_probe_t layer;
+    layer.Reset(true, 1400, false);
+    /// half the index space behind the base is what came before it
+    EXPECT_TRUE(layer.IsReliableDuplicate(0xFFFFFF));
+
+    for (uint index = 0; index < 0xFFFFF0; index++)
+        ASSERT_FALSE(layer.IsReliableDuplicate(index));
+
+    /// ahead of the wrap, out of order
+    EXPECT_FALSE(layer.IsReliableDuplicate(5));
+    EXPECT_TRUE(layer.IsReliableDuplicate(5));
+    for (uint index = 0xFFFFF0; index <= 0xFFFFFF; index++)
+        EXPECT_FALSE(layer.IsReliableDuplicate(index));
+    EXPECT_TRUE(layer.IsReliableDuplicate(0xFFFFF5));
+    for (uint index = 0; index < 5; index++)
+        EXPECT_FALSE(layer.IsReliableDuplicate(index));
+    /// base slid over 5 as well
+    EXPECT_TRUE(layer.IsReliableDuplicate(5));
+    EXPECT_FALSE(layer.IsReliableDuplicate(6));
+
+    /// too far ahead to track is let through every time
+    EXPECT_FALSE(layer.IsReliableDuplicate(7 + GECO_RELIABLE_WINDOW_SIZE));
+    EXPECT_FALSE(layer.IsReliableDuplicate(7 + GECO_RELIABLE_WINDOW_SIZE));
+}
+
+static bool process_acks(transport_layer_t& layer, geco_bit_stream_t& bitStream, uint bytesRead)
+{
+    recv_params_t recvParams;
+    recvParams.data = bitStream.char_data();
+    recvParams.bytesRead = bytesRead;
+    recvParams.timeRead = 1000;
+    recvParams.ecn = ECN_NOT_ECT;
+    /// acks and naks never reach the application
+    return layer.ProcessOneConnectedRecvParams(0, &recvParams, 0);
+}
+
+static void write_ack_flags(geco_bit_stream_t& bitStream, bool hasAcks, bool hasNaks)
+{
+    bitStream.Write(true);
+    bitStream.Write(hasAcks);
+    bitStream.Write(hasNaks);
+}
+
+TEST(TransportLayerTests, malformed_acks_and_naks_are_counted_and_dropped)
+{
+    transport_layer_t layer;
+    layer.Reset(true, 1400, false);
+
+    geco_bit_stream_t ok;
+    write_ack_flags(ok, true, true);
+    ok.WriteMini(1u);
+    ok.WriteMini(7u);
+    ok.WriteMini(0u);
+    ok.WriteMini(0u);
+    ok.WriteMini(1u);
+    ok.WriteMini(3u);
+    ok.WriteMini(2u);
+    EXPECT_TRUE(process_acks(layer, ok, ok.get_written_bytes()));
+    EXPECT_EQ(0u, layer.GetMalformedDropped());
+
+    /// flags only, no count
+    geco_bit_stream_t empty;
+    write_ack_flags(empty, false, true);
+    EXPECT_FALSE(process_acks(layer, empty, empty.get_written_bytes()));
+    EXPECT_EQ(1u, layer.GetMalformedDropped());
+
+    /// count says two ranges, one is there
+    geco_bit_stream_t shortOne;
+    write_ack_flags(shortOne, false, true);
+    shortOne.WriteMini(2u);
+    shortOne.WriteMini(7u);
+    shortOne.WriteMini(0u);
+    EXPECT_FALSE(process_acks(layer, shortOne, shortOne.get_written_bytes()));
+    EXPECT_EQ(2u, layer.GetMalformedDropped());
+
+    /// datagram numbers are 24 bits
+    geco_bit_stream_t wide;
+    write_ack_flags(wide, false, true);
+    wide.WriteMini(1u);
+    wide.WriteMini(0x1000000u);
+    wide.WriteMini(0u);
+    EXPECT_FALSE(process_acks(layer, wide, wide.get_written_bytes()));
+    EXPECT_EQ(3u, layer.GetMalformedDropped());
+
+    /// a huge count does not run past the end
+    geco_bit_stream_t huge;
+    write_ack_flags(huge, false, true);
+    huge.WriteMini(0xFFFFFFFFu);
+    EXPECT_FALSE(process_acks(layer, huge, huge.get_written_bytes()));
+    EXPECT_EQ(4u, layer.GetMalformedDropped());
+
+    /// a data datagram cut inside its number
+    geco_bit_stream_t data;
+    write_ack_flags(data, false, false);
+    data.Write((uchar)1);
+    EXPECT_FALSE(process_acks(layer, data, data.get_written_bytes()));
+    EXPECT_EQ(5u, layer.GetMalformedDropped());
+}
+
+/// what ProcessOneConnectedRecvParams() does with an ordered or sequenced message,
+/// @tag stands in for its data and is appended to @delivered when it is handed out
+static void receive_ordering(transport_layer_probe_t& layer, packet_reliability_t reliability,
+    uint orderingIndex, uint sequencingIndex, uint tag, std::vector<uint>& delivered)
+{
+    packet_fixed_t header = make_header(reliability);
+    header.dataBitLength = BYTES_TO_BITS(sizeof(uint));
+    header.orderingIndex = orderingIndex;
+    header.sequencingIndex = sequencingIndex;
+    header.orderingChannel = 3;
+    if (layer.IsOrderingStale(header)) return;
+    if (layer.IsOrderingAhead(header))
+    {
+        internal_packet_t* held = layer.HoldOrdering(header);
+        ASSERT_TRUE(held != 0);
+        memcpy(held->data, &tag, sizeof(uint));
+        return;
+    }
+    delivered.push_back(tag);
+    layer.OnOrderingDelivered(header);
+    internal_packet_t* msg;
+    while ((msg = layer.PopOrderingReady(header.orderingChannel)) != 0)
+    {
+        memcpy(&tag, msg->data, sizeof(uint));
+        delivered.push_back(tag);
+        layer.FreeInternalPacket(msg);
+    }
+}
+
+TEST(TransportLayerTests, ordered_messages_wait_for_the_gap_before_them)
+{
+    transport_layer_probe_t layer;
+    layer.Reset(true, 1400, false);
+    std::vector<uint> delivered;
+
+    receive_ordering(layer, RELIABLE_ORDERED_NOT_ACK_RECEIPT_OF_PACKET, 0, 0, 0, delivered);
+    receive_ordering(layer, RELIABLE_ORDERED_NOT_ACK_RECEIPT_OF_PACKET, 3, 0, 3, delivered);
+    receive_ordering(layer, RELIABLE_ORDERED_NOT_ACK_RECEIPT_OF_PACKET, 2, 0, 2, delivered);
+    ASSERT_EQ(1u, delivered.size());
+
+    receive_ordering(layer, RELIABLE_ORDERED_NOT_ACK_RECEIPT_OF_PACKET, 1, 0, 1, delivered);
+    ASSERT_EQ(4u, delivered.size());
+    for (uint i = 0; i < delivered.size(); i++)
+        EXPECT_EQ(i, delivered[i]);
+
+    /// a copy of one delivered already
+    receive_ordering(layer, RELIABLE_ORDERED_NOT_ACK_RECEIPT_OF_PACKET, 2, 0, 2, delivered);
+    EXPECT_EQ(4u, delivered.size());
+}
+
+TEST(TransportLayerTests, sequenced_messages_older_than_the_newest_are_dropped)
+{
+    transport_layer_probe_t layer;
+    layer.Reset(true, 1400, false);
+    std::vector<uint> delivered;
+
+    receive_ordering(layer, UNRELIABLE_SEQUENCED_NOT_ACK_RECEIPT_OF_PACKET, 0, 0, 10, delivered);
+    receive_ordering(layer, UNRELIABLE_SEQUENCED_NOT_ACK_RECEIPT_OF_PACKET, 0, 2, 12, delivered);
+    receive_ordering(layer, UNRELIABLE_SEQUENCED_NOT_ACK_RECEIPT_OF_PACKET, 0, 1, 11, delivered);
+    receive_ordering(layer, RELIABLE_SEQUENCED_NOT_ACK_RECEIPT_OF_PACKET, 0, 2, 12, delivered);
+    ASSERT_EQ(2u, delivered.size());
+    EXPECT_EQ(10u, delivered[0]);
+    EXPECT_EQ(12u, delivered[1]);
+
+    /// the ordered one sent after them starts sequencing over
+    receive_ordering(layer, RELIABLE_ORDERED_NOT_ACK_RECEIPT_OF_PACKET, 0, 0, 20, delivered);
+    receive_ordering(layer, UNRELIABLE_SEQUENCED_NOT_ACK_RECEIPT_OF_PACKET, 0, 3, 13, delivered);
+    receive_ordering(layer, UNRELIABLE_SEQUENCED_NOT_ACK_RECEIPT_OF_PACKET, 1, 0, 30, delivered);
+    ASSERT_EQ(4u, delivered.size());
+    EXPECT_EQ(20u, delivered[2]);
+    EXPECT_EQ(30u, delivered[3]);
+}
+
+TEST(TransportLayerTests, sequenced_messages_ahead_wait_behind_the_ordered_one_sent_before)
+{
+    transport_layer_probe_t layer;
+    layer.Reset(true, 1400, false);
+    std::vector<uint> delivered;
+
+    /// sent as O0 S(1,0) S(1,1) O1 S(2,0), O0 is late
+    receive_ordering(layer, UNRELIABLE_SEQUENCED_NOT_ACK_RECEIPT_OF_PACKET, 1, 1, 2, delivered);
+    receive_ordering(layer, UNRELIABLE_SEQUENCED_NOT_ACK_RECEIPT_OF_PACKET, 2, 0, 4, delivered);
+    receive_ordering(layer, RELIABLE_ORDERED_NOT_ACK_RECEIPT_OF_PACKET, 1, 0, 3, delivered);
+    receive_ordering(layer, UNRELIABLE_SEQUENCED_NOT_ACK_RECEIPT_OF_PACKET, 1, 0, 1, delivered);
+    EXPECT_EQ(0u, delivered.size());
+
+    receive_ordering(layer, RELIABLE_ORDERED_NOT_ACK_RECEIPT_OF_PACKET, 0, 0, 0, delivered);
+    ASSERT_EQ(5u, delivered.size());
+    for (uint i = 0; i < delivered.size(); i++)
+        EXPECT_EQ(i, delivered[i]);
+}
+
+TEST(TransportLayerTests, ordering_holds_at_most_a_reliable_window_per_channel)
+{
+    transport_layer_probe_t layer;
+    layer.Reset(true, 1400, false);
+    packet_fixed_t header = make_header(RELIABLE_ORDERED_NOT_ACK_RECEIPT_OF_PACKET);
+    header.dataBitLength = 8;
+    header.orderingChannel = 0;
+    for (uint i = 1; i <= GECO_RELIABLE_WINDOW_SIZE; i++)
+    {
+        header.orderingIndex = i;
+        ASSERT_TRUE(layer.HoldOrdering(header) != 0);
+    }
+    header.orderingIndex = GECO_RELIABLE_WINDOW_SIZE + 1;
+    EXPECT_TRUE(layer.HoldOrdering(header) == 0);
+    /// other channels are not affected
+    header.orderingChannel = 1;
+    EXPECT_TRUE(layer.HoldOrdering(header) != 0);
+    /// Reset() frees what is held
+    layer.Reset(true, 1400, false);
+    EXPECT_TRUE(layer.PopOrderingReady(0) == 0);
+}
+
+TEST(TransportLayerTests, retransmission_timer_runs_without_congestion_control)
+{
+    transport_layer_probe_t layer;
+    layer.Reset(true, 1400, false);
+    layer.SetCongestionController(0, 1400);
+    EXPECT_EQ((TimeUS)GECO_CC_INITIAL_RTO_US, layer.GetRto());
+
+    /// srtt + 4 * rttvar of the first sample, never below the minimum
+    layer.OnRttSample(50000);
+    EXPECT_EQ(150000u, layer.GetRto());
+    /// srtt 43750, rttvar 31249
+    layer.OnRttSample(1);
+    EXPECT_EQ(168746u, layer.GetRto());
+
+    /// congestion control keeps its own once there is one
+    layer.SetCongestionController(geco::ultils::OP_NEW<JackieSlidingWindows>(TRACKE_MALLOC), 1400);
+    EXPECT_EQ(layer.GetCongestionController()->GetRto(), layer.GetRto());
+
+    /// Reset() starts over from the initial rto
+    layer.SetCongestionController(0, 1400);
+    layer.Reset(true, 1400, false);
+    EXPECT_EQ((TimeUS)GECO_CC_INITIAL_RTO_US, layer.GetRto());
+}
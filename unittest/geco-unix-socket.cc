@@ -0,0 +1,146 @@
+#include "gtest/gtest.h"
+#include "geco-unix-socket.h"
+
+#if GECO_ENABLE_UNIX_SOCKETS == 1
+#include <stdlib.h>
+#include <unistd.h>
+
+using namespace geco::net;
+
+/// fresh dir per test, removed with what is left in it
+class UnixSocketTests : public ::testing::Test
+{
+    protected:
+    char dir[64];
+
+    virtual void SetUp()
+    {
+        strcpy(dir, "/tmp/geco-unix-XXXXXX");
+        ASSERT_TRUE(mkdtemp(dir) != 0);
+    }
+    virtual void TearDown()
+    {
+        char cmd[128];
+        snprintf(cmd, sizeof(cmd), "rm -rf %s", dir);
+        EXPECT_EQ(0, system(cmd));
+    }
+    /// plain AF_UNIX socket bound at @path, -1 on failure
+    int BindRaw(const char *path)
+    {
+        int fd = socket(AF_UNIX, SOCK_DGRAM, 0);
+        sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        strcpy(addr.sun_path, path);
+        if (bind(fd, (sockaddr*)&addr, sizeof(addr)) != 0)
+        {
+            close(fd);
+            return -1;
+        }
+        return fd;
+    }
+    void SendRaw(int fd, const char *data, int length, ushort port)
+    {
+        sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        snprintf(addr.sun_path, sizeof(addr.sun_path), "%s/%u", dir, (uint)port);
+        EXPECT_EQ(length, (int)sendto(fd, data, length, 0, (sockaddr*)&addr, sizeof(addr)));
+    }
+};
+
+TEST_F(UnixSocketTests, path_in_dir_maps_to_the_port_of_the_sender)
+{
+    unix_transceiver_t a, b;
+    network_address_t aAddr, bAddr;
+    aAddr.FromString(GECO_UNIX_SOCKET_HOST, (ushort)0);
+    bAddr.FromString(GECO_UNIX_SOCKET_HOST, (ushort)0);
+    ASSERT_EQ(JISBindResult_SUCCESS, a.Bind(dir, aAddr, true, MAXIMUM_MTU_SIZE));
+    ASSERT_EQ(JISBindResult_SUCCESS, b.Bind(dir, bAddr, true, MAXIMUM_MTU_SIZE));
+    /// port 0 takes the first free one
+    EXPECT_EQ(GECO_UNIX_SOCKET_FIRST_PORT, aAddr.GetPortHostOrder());
+    EXPECT_EQ(GECO_UNIX_SOCKET_FIRST_PORT + 1, bAddr.GetPortHostOrder());
+
+    char data[MAXIMUM_MTU_SIZE];
+    network_address_t sender;
+    EXPECT_EQ(5, a.JackieINetSendTo("hello", 5, bAddr));
+    EXPECT_EQ(5, b.JackieINetRecvFrom(data, sizeof(data), &sender, false));
+    EXPECT_EQ(0, memcmp(data, "hello", 5));
+    EXPECT_TRUE(sender == aAddr);
+    EXPECT_EQ(0, b.JackieINetRecvFrom(data, sizeof(data), &sender, false));
+
+    /// the reply goes back by the address it came from
+    EXPECT_EQ(2, b.JackieINetSendTo("hi", 2, sender));
+    EXPECT_EQ(2, a.JackieINetRecvFrom(data, sizeof(data), &sender, false));
+    EXPECT_TRUE(sender == bAddr);
+}
+
+TEST_F(UnixSocketTests, stale_path_is_reused_and_live_one_is_not)
+{
+    char path[128];
+    snprintf(path, sizeof(path), "%s/5000", dir);
+    /// crashed process leaves its path behind
+    int fd = BindRaw(path);
+    ASSERT_NE(-1, fd);
+    close(fd);
+    ASSERT_EQ(0, access(path, F_OK));
+
+    unix_transceiver_t a, b;
+    network_address_t address;
+    address.FromString(GECO_UNIX_SOCKET_HOST, (ushort)5000);
+    EXPECT_EQ(JISBindResult_SUCCESS, a.Bind(dir, address, true, MAXIMUM_MTU_SIZE));
+    EXPECT_EQ(5000, address.GetPortHostOrder());
+    /// a still reads it
+    EXPECT_EQ(JISBindResult_FAILED_BIND_SOCKET, b.Bind(dir, address, true, MAXIMUM_MTU_SIZE));
+}
+
+TEST_F(UnixSocketTests, sending_to_a_missing_peer_is_a_lost_datagram)
+{
+    unix_transceiver_t a;
+    network_address_t address;
+    address.FromString(GECO_UNIX_SOCKET_HOST, (ushort)0);
+    ASSERT_EQ(JISBindResult_SUCCESS, a.Bind(dir, address, true, MAXIMUM_MTU_SIZE));
+
+    network_address_t missing;
+    missing.FromString(GECO_UNIX_SOCKET_HOST, (ushort)6000);
+    EXPECT_EQ(5, a.JackieINetSendTo("hello", 5, missing));
+    /// other hosts are out of reach as well
+    EXPECT_EQ(5, a.JackieINetSendTo("hello", 5, network_address_t("127.0.0.1|6000")));
+}
+
+TEST_F(UnixSocketTests, foreign_path_and_oversized_datagrams_are_counted)
+{
+    unix_transceiver_t a;
+    network_address_t address;
+    address.FromString(GECO_UNIX_SOCKET_HOST, (ushort)0);
+    ASSERT_EQ(JISBindResult_SUCCESS, a.Bind(dir, address, true, 100));
+
+    char outside[128];
+    snprintf(outside, sizeof(outside), "%s-outside", dir);
+    int fd = BindRaw(outside);
+    ASSERT_NE(-1, fd);
+    char data[MAXIMUM_MTU_SIZE] = { 0 };
+    network_address_t sender;
+    SendRaw(fd, data, 10, address.GetPortHostOrder());
+    EXPECT_EQ(0, a.JackieINetRecvFrom(data, sizeof(data), &sender, false));
+    EXPECT_EQ(1u, a.GetDatagramsDropped());
+    close(fd);
+    unlink(outside);
+
+    char inside[128];
+    snprintf(inside, sizeof(inside), "%s/7000", dir);
+    fd = BindRaw(inside);
+    ASSERT_NE(-1, fd);
+    SendRaw(fd, data, 200, address.GetPortHostOrder());
+    EXPECT_EQ(0, a.JackieINetRecvFrom(data, sizeof(data), &sender, false));
+    EXPECT_EQ(2u, a.GetDatagramsDropped());
+    /// caller capacity below mtu caps it as well
+    SendRaw(fd, data, 50, address.GetPortHostOrder());
+    EXPECT_EQ(0, a.JackieINetRecvFrom(data, 40, &sender, false));
+    EXPECT_EQ(3u, a.GetDatagramsDropped());
+    SendRaw(fd, data, 50, address.GetPortHostOrder());
+    EXPECT_EQ(50, a.JackieINetRecvFrom(data, sizeof(data), &sender, false));
+    EXPECT_EQ(7000, sender.GetPortHostOrder());
+    close(fd);
+}
+#endif